@@ -0,0 +1,573 @@
+// LibMemPool 分配负载基准：多种真实分布的负载下，对比若干内存池配置与系统 malloc。
+// 每个（负载, 分配器）组合在独立的子进程中运行，峰值 RSS 取子进程的 ru_maxrss，互不污染。
+// 结果以 JSON 数组输出到 stdout：吞吐、延迟分位数、峰值 RSS 与碎片率。
+//
+// 用法: bench [--quick] [--workload NAME] [--allocator NAME]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "../include/memory_pool.h"
+
+#define KB(x) ((size_t)(x) * 1024)
+#define MB(x) ((size_t)(x) * 1024 * 1024)
+
+// 每 LAT_SAMPLE 次操作计时一次：逐次计时的 clock_gettime 开销会淹没小分配本身
+#define LAT_SAMPLE 8
+#define LAT_BUCKETS 304
+
+// ---- 计时与延迟直方图（与库内直方图相同的对数-线性分桶） ----
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+typedef struct histogram {
+    uint64_t count;
+    uint64_t max_ns;
+    uint64_t buckets[LAT_BUCKETS];
+} histogram_t;
+
+static inline void hist_add(histogram_t* h, uint64_t ns) {
+    int idx;
+    if (ns < 8) {
+        idx = (int)ns;
+    } else {
+        int msb = 63 - __builtin_clzll(ns);
+        idx = (msb - 2) * 8 + (int)((ns >> (msb - 3)) & 7);
+        if (idx >= LAT_BUCKETS) idx = LAT_BUCKETS - 1;
+    }
+    h->buckets[idx]++;
+    h->count++;
+    if (ns > h->max_ns) h->max_ns = ns;
+}
+
+static void hist_merge(histogram_t* dst, const histogram_t* src) {
+    dst->count += src->count;
+    if (src->max_ns > dst->max_ns) dst->max_ns = src->max_ns;
+    for (int i = 0; i < LAT_BUCKETS; i++) dst->buckets[i] += src->buckets[i];
+}
+
+static uint64_t hist_percentile(const histogram_t* h, double q) {
+    if (!h->count) return 0;
+    uint64_t rank = (uint64_t)(q * (double)h->count);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen < rank) continue;
+        if (i < 8) return (uint64_t)i;
+        int msb = i / 8 + 2;
+        uint64_t hi = ((uint64_t)(8 + i % 8) << (msb - 3)) + ((uint64_t)1 << (msb - 3)) - 1;
+        return hi < h->max_ns ? hi : h->max_ns;
+    }
+    return h->max_ns;
+}
+
+// ---- 随机数（xorshift64*，每个线程独立状态，结果可复现） ----
+static inline uint64_t rng_next(uint64_t* s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1DULL;
+}
+
+static inline double rng_unit(uint64_t* s) {
+    return (double)(rng_next(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline size_t rng_range(uint64_t* s, size_t lo, size_t hi) {
+    return lo + (size_t)(rng_next(s) % (hi - lo + 1));
+}
+
+// 幂律尺寸：Pareto(alpha) 缩放到 [lo, hi]，绝大多数请求很小、少数很大
+static inline size_t rng_power_law(uint64_t* s, size_t lo, size_t hi, double alpha) {
+    double u = rng_unit(s);
+    double v = (double)lo / pow(1.0 - u, 1.0 / alpha);
+    return v > (double)hi ? hi : (size_t)v;
+}
+
+// ---- 分配器抽象 ----
+typedef struct allocator {
+    const char* name;
+    memory_pool_t* pool;           // NULL = 系统 malloc
+    bool thread_safe;
+} allocator_t;
+
+static inline void* a_alloc(allocator_t* a, size_t n) {
+    return a->pool ? memory_pool_alloc(a->pool, n) : malloc(n);
+}
+
+static inline void a_free(allocator_t* a, void* p) {
+    if (a->pool) memory_pool_free(a->pool, p);
+    else free(p);
+}
+
+static inline void* a_realloc(allocator_t* a, void* p, size_t n) {
+    return a->pool ? memory_pool_realloc(a->pool, p, n) : realloc(p, n);
+}
+
+static inline void* a_alloc_aligned(allocator_t* a, size_t n, size_t align) {
+    if (a->pool) return memory_pool_alloc_aligned(a->pool, n, align);
+    void* p = NULL;
+    return posix_memalign(&p, align, n) == 0 ? p : NULL;
+}
+
+static inline void* a_alloc_fixed(allocator_t* a, size_t n) {
+    return a->pool ? memory_pool_alloc_fixed(a->pool, n) : malloc(n);
+}
+
+static inline void a_free_fixed(allocator_t* a, void* p) {
+    if (a->pool) memory_pool_free_fixed(a->pool, p);
+    else free(p);
+}
+
+static size_t g_fixed_sizes[] = { 32, 64, 128, 256 };
+#define NUM_FIXED (sizeof(g_fixed_sizes) / sizeof(g_fixed_sizes[0]))
+
+typedef struct allocator_spec {
+    const char* name;
+    bool use_pool;
+    pool_config_t cfg;
+} allocator_spec_t;
+
+static const allocator_spec_t g_allocators[] = {
+    { "malloc", false, { 0 } },
+    { "mempool", true, {
+        .pool_size = MB(16), .thread_safe = true, .alignment = 16,
+    } },
+    { "mempool-classes", true, {
+        .pool_size = MB(16), .thread_safe = true, .alignment = 16,
+        .enable_size_classes = true, .size_class_sizes = g_fixed_sizes, .num_size_classes = NUM_FIXED,
+        .adaptive_sizing = true, .release_idle_children = true,
+    } },
+    { "mempool-thp", true, {
+        .pool_size = MB(16), .thread_safe = true, .alignment = 16,
+        .huge_pages = MP_HUGE_PAGES_TRANSPARENT, .adaptive_sizing = true,
+    } },
+};
+#define NUM_ALLOCATORS (sizeof(g_allocators) / sizeof(g_allocators[0]))
+
+// ---- 负载 ----
+typedef struct run_result {
+    uint64_t ops;
+    uint64_t elapsed_ns;
+    histogram_t hist;
+    double fragmentation;          // < 0 表示不可用（系统 malloc）
+    size_t segments;
+    size_t live_bytes;             // 稳态（释放前）存活的请求字节数
+    bool failed;
+} run_result_t;
+
+// 稳态快照：在负载释放全部对象前调用
+static void snapshot_pool(allocator_t* a, run_result_t* r) {
+    r->fragmentation = -1.0;
+    if (!a->pool) return;
+    mp_memory_report_t rep;
+    if (memory_pool_get_memory_report(a->pool, &rep)) {
+        r->fragmentation = rep.fragmentation;
+        r->segments = rep.segments;
+    }
+}
+
+#define TIMED(r, i, expr) do { \
+        if (((i) % LAT_SAMPLE) == 0) { \
+            uint64_t t0_ = now_ns(); \
+            expr; \
+            hist_add(&(r)->hist, now_ns() - t0_); \
+        } else { \
+            expr; \
+        } \
+    } while (0)
+
+// 随机替换工作集中的槽位：每次释放一个旧对象并分配一个新对象
+static void churn(allocator_t* a, run_result_t* r, size_t ops, size_t slots,
+                  size_t (*next_size)(uint64_t*)) {
+    void** live = calloc(slots, sizeof(void*));
+    size_t* sizes = calloc(slots, sizeof(size_t));
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < ops; i++) {
+        size_t k = (size_t)(rng_next(&seed) % slots);
+        if (live[k]) {
+            TIMED(r, i, a_free(a, live[k]));
+            r->live_bytes -= sizes[k];
+        }
+        size_t n = next_size(&seed);
+        TIMED(r, i, live[k] = a_alloc(a, n));
+        if (!live[k]) { r->failed = true; break; }
+        ((char*)live[k])[0] = (char)i; // 触碰首字节，避免只测元数据
+        sizes[k] = n;
+        r->live_bytes += n;
+        r->ops += 2;
+    }
+    snapshot_pool(a, r);
+    for (size_t k = 0; k < slots; k++) if (live[k]) a_free(a, live[k]);
+    free(live);
+    free(sizes);
+}
+
+static size_t size_uniform_small(uint64_t* s) { return rng_range(s, 16, 256); }
+static size_t size_power_law(uint64_t* s) { return rng_power_law(s, 16, KB(64), 1.2); }
+
+static void wl_uniform_small(allocator_t* a, run_result_t* r, size_t scale) {
+    churn(a, r, 1000000 * scale, 8192, size_uniform_small);
+}
+
+static void wl_power_law(allocator_t* a, run_result_t* r, size_t scale) {
+    churn(a, r, 500000 * scale, 8192, size_power_law);
+}
+
+// 生产者/消费者：生产者分配并写入，经单生产者单消费者环形队列交给消费者线程释放（跨线程释放）
+#define RING_SIZE 1024
+typedef struct ring {
+    void* slots[RING_SIZE];
+    size_t head;                   // 生产者写入位置
+    size_t tail;                   // 消费者读取位置
+} ring_t;
+
+typedef struct pc_job {
+    allocator_t* a;
+    ring_t* ring;
+    size_t count;
+    uint64_t seed;
+    histogram_t hist;
+    bool failed;
+} pc_job_t;
+
+static void* pc_producer(void* arg) {
+    pc_job_t* j = (pc_job_t*)arg;
+    for (size_t i = 0; i < j->count; i++) {
+        size_t n = rng_range(&j->seed, 32, 512);
+        void* p;
+        if (i % LAT_SAMPLE == 0) {
+            uint64_t t0 = now_ns();
+            p = a_alloc(j->a, n);
+            hist_add(&j->hist, now_ns() - t0);
+        } else {
+            p = a_alloc(j->a, n);
+        }
+        if (!p) { j->failed = true; p = (void*)1; } // 仍需占位，保证消费者能退出
+        else memset(p, (int)i, n < 64 ? n : 64);
+        size_t h = j->ring->head;
+        while (h - __atomic_load_n(&j->ring->tail, __ATOMIC_ACQUIRE) >= RING_SIZE) sched_yield();
+        j->ring->slots[h % RING_SIZE] = p;
+        __atomic_store_n(&j->ring->head, h + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void* pc_consumer(void* arg) {
+    pc_job_t* j = (pc_job_t*)arg;
+    for (size_t i = 0; i < j->count; i++) {
+        size_t t = j->ring->tail;
+        while (__atomic_load_n(&j->ring->head, __ATOMIC_ACQUIRE) == t) sched_yield();
+        void* p = j->ring->slots[t % RING_SIZE];
+        __atomic_store_n(&j->ring->tail, t + 1, __ATOMIC_RELEASE);
+        if (p == (void*)1) continue;
+        if (i % LAT_SAMPLE == 0) {
+            uint64_t t0 = now_ns();
+            a_free(j->a, p);
+            hist_add(&j->hist, now_ns() - t0);
+        } else {
+            a_free(j->a, p);
+        }
+    }
+    return NULL;
+}
+
+static void wl_producer_consumer(allocator_t* a, run_result_t* r, size_t scale) {
+    enum { PAIRS = 2 };
+    size_t per_pair = 500000 * scale;
+    ring_t* rings = calloc(PAIRS, sizeof(ring_t));
+    pc_job_t* jobs = calloc(PAIRS * 2, sizeof(pc_job_t));
+    pthread_t tids[PAIRS * 2];
+    for (int i = 0; i < PAIRS * 2; i++) {
+        jobs[i].a = a;
+        jobs[i].ring = &rings[i / 2];
+        jobs[i].count = per_pair;
+        jobs[i].seed = 0x1234567ULL + (uint64_t)i * 7919;
+    }
+    for (int i = 0; i < PAIRS * 2; i++) {
+        pthread_create(&tids[i], NULL, (i % 2) ? pc_consumer : pc_producer, &jobs[i]);
+    }
+    for (int i = 0; i < PAIRS * 2; i++) {
+        pthread_join(tids[i], NULL);
+        hist_merge(&r->hist, &jobs[i].hist);
+        r->failed |= jobs[i].failed;
+    }
+    r->ops = per_pair * PAIRS * 2;
+    snapshot_pool(a, r);
+    free(rings);
+    free(jobs);
+}
+
+// 字符串拼接：逐段 append，按 1.5 倍容量 realloc，直到约 64 KiB 后释放重来
+static void wl_realloc_string(allocator_t* a, run_result_t* r, size_t scale) {
+    uint64_t seed = 42;
+    enum { LIVE = 64 };
+    char* bufs[LIVE] = { 0 };
+    size_t len[LIVE] = { 0 }, cap[LIVE] = { 0 };
+    size_t ops = 1000000 * scale;
+    for (size_t i = 0; i < ops; i++) {
+        size_t k = (size_t)(rng_next(&seed) % LIVE);
+        size_t add = rng_range(&seed, 1, 64);
+        if (len[k] + add > cap[k]) {
+            size_t ncap = cap[k] ? cap[k] + cap[k] / 2 : 32;
+            if (ncap < len[k] + add) ncap = len[k] + add;
+            char* nb;
+            TIMED(r, i, nb = a_realloc(a, bufs[k], ncap));
+            if (!nb) { r->failed = true; break; }
+            bufs[k] = nb;
+            cap[k] = ncap;
+            r->ops++;
+        }
+        memset(bufs[k] + len[k], 'a' + (int)(i % 26), add);
+        len[k] += add;
+        if (len[k] > KB(64)) {
+            TIMED(r, i, a_free(a, bufs[k]));
+            bufs[k] = NULL;
+            len[k] = cap[k] = 0;
+            r->ops++;
+        }
+    }
+    for (int k = 0; k < LIVE; k++) r->live_bytes += len[k];
+    snapshot_pool(a, r);
+    for (int k = 0; k < LIVE; k++) if (bufs[k]) a_free(a, bufs[k]);
+}
+
+// 固定大小类抖动：几种结构体尺寸成批分配、随机释放一半
+static void wl_fixed_churn(allocator_t* a, run_result_t* r, size_t scale) {
+    enum { SLOTS = 16384 };
+    void** live = calloc(SLOTS, sizeof(void*));
+    size_t* sizes = calloc(SLOTS, sizeof(size_t));
+    uint64_t seed = 7;
+    size_t ops = 1000000 * scale;
+    for (size_t i = 0; i < ops; i++) {
+        size_t k = (size_t)(rng_next(&seed) % SLOTS);
+        if (live[k]) {
+            TIMED(r, i, a_free_fixed(a, live[k]));
+            r->live_bytes -= sizes[k];
+        }
+        size_t n = g_fixed_sizes[rng_next(&seed) % NUM_FIXED] - (size_t)(rng_next(&seed) % 16);
+        TIMED(r, i, live[k] = a_alloc_fixed(a, n));
+        if (!live[k]) { r->failed = true; break; }
+        ((char*)live[k])[n - 1] = 1;
+        sizes[k] = n;
+        r->live_bytes += n;
+        r->ops += 2;
+    }
+    snapshot_pool(a, r);
+    for (size_t k = 0; k < SLOTS; k++) if (live[k]) a_free_fixed(a, live[k]);
+    free(live);
+    free(sizes);
+}
+
+// 对齐缓冲区：DMA / SIMD 风格，对齐 64..4096、尺寸 100..8000
+static void wl_aligned(allocator_t* a, run_result_t* r, size_t scale) {
+    enum { SLOTS = 1024 };
+    void** live = calloc(SLOTS, sizeof(void*));
+    size_t* sizes = calloc(SLOTS, sizeof(size_t));
+    uint64_t seed = 99;
+    size_t ops = 50000 * scale;
+    for (size_t i = 0; i < ops; i++) {
+        size_t k = (size_t)(rng_next(&seed) % SLOTS);
+        if (live[k]) {
+            TIMED(r, i, a_free(a, live[k]));
+            r->live_bytes -= sizes[k];
+        }
+        size_t align = (size_t)64 << (rng_next(&seed) % 7);
+        size_t n = rng_range(&seed, 100, 8000);
+        TIMED(r, i, live[k] = a_alloc_aligned(a, n, align));
+        if (!live[k] || ((uintptr_t)live[k] & (align - 1))) { r->failed = true; break; }
+        ((char*)live[k])[0] = 1;
+        sizes[k] = n;
+        r->live_bytes += n;
+        r->ops += 2;
+    }
+    snapshot_pool(a, r);
+    for (size_t k = 0; k < SLOTS; k++) if (live[k]) a_free(a, live[k]);
+    free(live);
+    free(sizes);
+}
+
+// 长时间碎片浸泡：多轮交错分配长寿（约 5%）与短命对象，短命对象每轮结束全部释放，
+// 长寿对象逐轮累积并随机淘汰；结束时堆里散布着被长寿对象钉住的空洞
+static void wl_fragmentation_soak(allocator_t* a, run_result_t* r, size_t scale) {
+    enum { LONG_SLOTS = 10000, SHORT_PER_ROUND = 10000 };
+    void** longs = calloc(LONG_SLOTS, sizeof(void*));
+    size_t* long_sizes = calloc(LONG_SLOTS, sizeof(size_t));
+    void** shorts = calloc(SHORT_PER_ROUND, sizeof(void*));
+    uint64_t seed = 2024;
+    size_t rounds = 20 * scale;
+    size_t i = 0;
+    for (size_t round = 0; round < rounds && !r->failed; round++) {
+        size_t ns = 0;
+        for (size_t j = 0; j < SHORT_PER_ROUND; j++, i++) {
+            size_t n = rng_power_law(&seed, 16, KB(16), 1.1);
+            if (rng_next(&seed) % 20 == 0) {
+                size_t k = (size_t)(rng_next(&seed) % LONG_SLOTS);
+                if (longs[k]) {
+                    TIMED(r, i, a_free(a, longs[k]));
+                    r->live_bytes -= long_sizes[k];
+                    r->ops++;
+                }
+                TIMED(r, i, longs[k] = a_alloc(a, n));
+                if (!longs[k]) { r->failed = true; break; }
+                long_sizes[k] = n;
+                r->live_bytes += n;
+            } else {
+                TIMED(r, i, shorts[ns] = a_alloc(a, n));
+                if (!shorts[ns]) { r->failed = true; break; }
+                ns++;
+            }
+            r->ops++;
+        }
+        for (size_t j = 0; j < ns; j++, i++) {
+            TIMED(r, i, a_free(a, shorts[j]));
+            r->ops++;
+        }
+    }
+    snapshot_pool(a, r);
+    for (size_t k = 0; k < LONG_SLOTS; k++) if (longs[k]) a_free(a, longs[k]);
+    free(longs);
+    free(long_sizes);
+    free(shorts);
+}
+
+typedef struct workload {
+    const char* name;
+    void (*run)(allocator_t* a, run_result_t* r, size_t scale);
+    bool needs_thread_safe;
+} workload_t;
+
+static const workload_t g_workloads[] = {
+    { "uniform_small", wl_uniform_small, false },
+    { "power_law", wl_power_law, false },
+    { "producer_consumer", wl_producer_consumer, true },
+    { "realloc_string", wl_realloc_string, false },
+    { "fixed_churn", wl_fixed_churn, false },
+    { "aligned", wl_aligned, false },
+    { "fragmentation_soak", wl_fragmentation_soak, false },
+};
+#define NUM_WORKLOADS (sizeof(g_workloads) / sizeof(g_workloads[0]))
+
+// ---- 驱动 ----
+// 子进程：建池、跑负载、把结果写回管道
+static void run_child(const workload_t* w, const allocator_spec_t* spec, size_t scale, int fd) {
+    run_result_t r;
+    memset(&r, 0, sizeof(r));
+    allocator_t a = { .name = spec->name, .pool = NULL, .thread_safe = true };
+    if (spec->use_pool) {
+        a.pool = memory_pool_create_with_config(&spec->cfg);
+        if (!a.pool) r.failed = true;
+        a.thread_safe = spec->cfg.thread_safe;
+    }
+    if (!r.failed) {
+        uint64_t t0 = now_ns();
+        w->run(&a, &r, scale);
+        r.elapsed_ns = now_ns() - t0;
+    }
+    if (a.pool) memory_pool_destroy(a.pool);
+    ssize_t off = 0;
+    while (off < (ssize_t)sizeof(r)) {
+        ssize_t n = write(fd, (char*)&r + off, sizeof(r) - (size_t)off);
+        if (n <= 0) _exit(1);
+        off += n;
+    }
+    _exit(0);
+}
+
+static bool run_one(const workload_t* w, const allocator_spec_t* spec, size_t scale, bool first) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        run_child(w, spec, scale, fds[1]);
+    }
+    close(fds[1]);
+    run_result_t r;
+    size_t got = 0;
+    while (got < sizeof(r)) {
+        ssize_t n = read(fds[0], (char*)&r + got, sizeof(r) - got);
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fds[0]);
+    int status = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+    wait4(pid, &status, 0, &ru);
+    bool ok = got == sizeof(r) && WIFEXITED(status) && WEXITSTATUS(status) == 0 && !r.failed;
+
+    double secs = (double)r.elapsed_ns / 1e9;
+    printf("%s  {\"workload\": \"%s\", \"allocator\": \"%s\", \"ok\": %s", first ? "" : ",\n",
+           w->name, spec->name, ok ? "true" : "false");
+    if (ok) {
+        printf(", \"ops\": %llu, \"seconds\": %.4f, \"ops_per_sec\": %.0f",
+               (unsigned long long)r.ops, secs, secs > 0 ? (double)r.ops / secs : 0.0);
+        printf(", \"latency_ns\": {\"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}",
+               (unsigned long long)hist_percentile(&r.hist, 0.50),
+               (unsigned long long)hist_percentile(&r.hist, 0.90),
+               (unsigned long long)hist_percentile(&r.hist, 0.99),
+               (unsigned long long)hist_percentile(&r.hist, 0.999),
+               (unsigned long long)r.hist.max_ns);
+        printf(", \"peak_rss_bytes\": %llu, \"live_bytes\": %zu",
+               (unsigned long long)ru.ru_maxrss * 1024ULL, r.live_bytes);
+        if (r.fragmentation >= 0) printf(", \"fragmentation\": %.4f, \"segments\": %zu", r.fragmentation, r.segments);
+        else printf(", \"fragmentation\": null, \"segments\": null");
+    }
+    printf("}");
+    return ok;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [--quick] [--workload NAME] [--allocator NAME]\n", prog);
+    fprintf(stderr, "workloads:");
+    for (size_t i = 0; i < NUM_WORKLOADS; i++) fprintf(stderr, " %s", g_workloads[i].name);
+    fprintf(stderr, "\nallocators:");
+    for (size_t i = 0; i < NUM_ALLOCATORS; i++) fprintf(stderr, " %s", g_allocators[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char** argv) {
+    size_t scale = 4;
+    const char* only_workload = NULL;
+    const char* only_allocator = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) scale = 1;
+        else if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc) only_workload = argv[++i];
+        else if (strcmp(argv[i], "--allocator") == 0 && i + 1 < argc) only_allocator = argv[++i];
+        else { usage(argv[0]); return 2; }
+    }
+
+    bool first = true;
+    bool all_ok = true;
+    printf("[\n");
+    for (size_t w = 0; w < NUM_WORKLOADS; w++) {
+        if (only_workload && strcmp(only_workload, g_workloads[w].name) != 0) continue;
+        for (size_t a = 0; a < NUM_ALLOCATORS; a++) {
+            if (only_allocator && strcmp(only_allocator, g_allocators[a].name) != 0) continue;
+            if (g_workloads[w].needs_thread_safe && g_allocators[a].use_pool && !g_allocators[a].cfg.thread_safe) continue;
+            all_ok &= run_one(&g_workloads[w], &g_allocators[a], scale, first);
+            first = false;
+        }
+    }
+    printf("\n]\n");
+    if (first) {
+        usage(argv[0]);
+        return 2;
+    }
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,361 @@
+// LibMemPool 分配轨迹重放：读取 memory_pool_trace_start 记录的轨迹，按记录顺序在单线程中
+// 重新执行全部调用（多线程轨迹同样按实际执行顺序串行化），用命令行给出的池配置替代原配置。
+// 结果以一个 JSON 对象输出到 stdout：耗时、碎片率与峰值内存，用于离线调优 pool_config_t。
+//
+// 用法: replay TRACE [选项]
+//   --malloc                对照：改用系统 malloc 重放
+//   --pool-size BYTES       初始段大小（默认取轨迹头部记录的值；可带 K/M/G 后缀）
+//   --alignment N           对齐字节数（默认 16）
+//   --classes A,B,...       启用固定大小类
+//   --packed                紧凑固定大小类
+//   --adaptive              自适应扩展
+//   --release-idle          自动回收空闲子池
+//   --huge-pages MODE       none | thp | explicit
+//   --reserve BYTES         预留-提交模式的预留区大小
+//   --memfd                 memfd 原地扩展
+//   --populate              扩展时预先缺页
+//   --soft-limit BYTES / --hard-limit BYTES
+//   --single-threaded       以非线程安全池重放（默认按轨迹头部）
+//   --sample N              每 N 条记录采样一次碎片率（默认 4096，不计入耗时）
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "../include/memory_pool.h"
+
+#define MAX_CLASSES 16
+#define CHUNK_RECORDS 4096
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// 解析带 K/M/G 后缀的字节数
+static bool parse_bytes(const char* s, size_t* out) {
+    char* end = NULL;
+    unsigned long long v = strtoull(s, &end, 0);
+    if (end == s) return false;
+    switch (*end) {
+        case 'k': case 'K': v <<= 10; end++; break;
+        case 'm': case 'M': v <<= 20; end++; break;
+        case 'g': case 'G': v <<= 30; end++; break;
+        default: break;
+    }
+    if (*end) return false;
+    *out = (size_t)v;
+    return true;
+}
+
+// ---- 对象编号表：轨迹中的编号 → 重放时的指针 ----
+typedef struct object {
+    void* ptr;
+    bool request;                  // 位于 MP_HINT_REQUEST arena（reset_requests 时失效）
+} object_t;
+
+typedef struct replay {
+    memory_pool_t* pool;           // NULL = 系统 malloc
+    object_t* objs;
+    size_t cap;
+    uint64_t ops;                  // 实际执行的调用数
+    uint64_t skipped;              // 原调用失败或输入对象未被记录，跳过
+    uint64_t failed;               // 原调用成功而重放失败
+    double max_fragmentation;
+} replay_t;
+
+static object_t* obj_slot(replay_t* r, uint32_t id) {
+    if (id >= r->cap) {
+        size_t cap = r->cap ? r->cap : 1024;
+        while (cap <= id) cap *= 2;
+        object_t* objs = realloc(r->objs, cap * sizeof(*objs));
+        if (!objs) {
+            fprintf(stderr, "replay: out of memory for object table\n");
+            exit(1);
+        }
+        memset(objs + r->cap, 0, (cap - r->cap) * sizeof(*objs));
+        r->objs = objs;
+        r->cap = cap;
+    }
+    return &r->objs[id];
+}
+
+static void obj_set(replay_t* r, uint32_t id, void* ptr, bool request) {
+    if (!id) return;
+    if (!ptr) r->failed++;
+    object_t* o = obj_slot(r, id);
+    o->ptr = ptr;
+    o->request = request;
+}
+
+// 取出并清空输入对象；未记录或已失效时返回 NULL
+static void* obj_take(replay_t* r, uint32_t id, bool* request) {
+    if (!id || id >= r->cap) return NULL;
+    void* ptr = r->objs[id].ptr;
+    if (request) *request = r->objs[id].request;
+    r->objs[id].ptr = NULL;
+    return ptr;
+}
+
+static void release_all(replay_t* r, bool only_request) {
+    for (size_t i = 0; i < r->cap; i++) {
+        if (!r->objs[i].ptr || (only_request && !r->objs[i].request)) continue;
+        if (!r->pool) free(r->objs[i].ptr); // 池对象由 reset / reset_requests 一并回收
+        r->objs[i].ptr = NULL;
+    }
+}
+
+static void touch(void* p) {
+    if (p) *(volatile char*)p = 1; // 触碰首字节，避免只测元数据
+}
+
+static void replay_record(replay_t* r, const mp_trace_record_t* rec) {
+    memory_pool_t* pool = r->pool;
+    void* p = NULL;
+    bool request = false;
+    // 原调用返回 NULL 的分配不重放：失败原因（上限、尺寸）与配置有关，重放成功会留下无法释放的对象
+    bool alloc_op = rec->op == MP_TRACE_ALLOC || rec->op == MP_TRACE_ALLOC_EX || rec->op == MP_TRACE_ALLOC_ALIGNED ||
+                    rec->op == MP_TRACE_CALLOC || rec->op == MP_TRACE_ALLOC_FIXED;
+    if (alloc_op && !rec->id) {
+        r->skipped++;
+        return;
+    }
+    switch (rec->op) {
+    case MP_TRACE_ALLOC:
+        p = pool ? memory_pool_alloc(pool, rec->size) : malloc(rec->size);
+        break;
+    case MP_TRACE_ALLOC_EX:
+        p = pool ? memory_pool_alloc_ex(pool, rec->size, rec->hints) : malloc(rec->size);
+        request = (rec->hints & MP_HINT_REQUEST) != 0;
+        break;
+    case MP_TRACE_ALLOC_ALIGNED: {
+        size_t align = (size_t)1 << rec->align_log2;
+        if (pool) {
+            p = memory_pool_alloc_aligned(pool, rec->size, align);
+        } else if (posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, rec->size) != 0) {
+            p = NULL;
+        }
+        break;
+    }
+    case MP_TRACE_CALLOC:
+        p = pool ? memory_pool_calloc_ex(pool, 1, rec->size, (mp_copy_mode_t)rec->mode) : calloc(1, rec->size);
+        break;
+    case MP_TRACE_ALLOC_FIXED:
+        p = pool ? memory_pool_alloc_fixed(pool, rec->size) : malloc(rec->size);
+        break;
+    case MP_TRACE_REALLOC: {
+        if (!rec->id && rec->size) { // 原调用失败，原对象保持有效
+            r->skipped++;
+            return;
+        }
+        if (rec->arg && (rec->arg >= r->cap || !r->objs[rec->arg].ptr)) { // 输入对象在本次重放中不存在
+            r->skipped++;
+            return;
+        }
+        void* old = obj_take(r, rec->arg, &request);
+        if (pool) p = memory_pool_realloc_ex(pool, old, rec->size, (mp_copy_mode_t)rec->mode);
+        else p = realloc(old, rec->size);
+        if (!rec->id) { // realloc(ptr, 0) 等同于释放
+            r->ops++;
+            return;
+        }
+        if (!p && old) obj_set(r, rec->arg, old, request); // 重放失败时原对象仍然有效
+        break;
+    }
+    case MP_TRACE_FREE:
+    case MP_TRACE_FREE_FIXED: {
+        void* old = obj_take(r, rec->arg, NULL);
+        if (!old) {
+            r->skipped++;
+            return;
+        }
+        if (!pool) free(old);
+        else if (rec->op == MP_TRACE_FREE) memory_pool_free(pool, old);
+        else memory_pool_free_fixed(pool, old);
+        r->ops++;
+        return;
+    }
+    case MP_TRACE_RESET:
+        if (pool) memory_pool_reset(pool);
+        release_all(r, false);
+        r->ops++;
+        return;
+    case MP_TRACE_RESET_REQUESTS:
+        if (pool) memory_pool_reset_requests(pool);
+        release_all(r, true);
+        r->ops++;
+        return;
+    case MP_TRACE_DEFRAGMENT:
+        if (pool) memory_pool_defragment(pool);
+        r->ops++;
+        return;
+    default:
+        r->skipped++;
+        return;
+    }
+    touch(p);
+    obj_set(r, rec->id, p, request);
+    r->ops++;
+}
+
+static void sample_fragmentation(replay_t* r, double* last, size_t* segments) {
+    mp_memory_report_t rep;
+    if (!r->pool || !memory_pool_get_memory_report(r->pool, &rep)) return;
+    if (rep.fragmentation > r->max_fragmentation) r->max_fragmentation = rep.fragmentation;
+    *last = rep.fragmentation;
+    *segments = rep.segments;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s TRACE [--malloc] [--pool-size BYTES] [--alignment N] [--classes A,B,...] [--packed]\n"
+            "       [--adaptive] [--release-idle] [--huge-pages none|thp|explicit] [--reserve BYTES] [--memfd]\n"
+            "       [--populate] [--soft-limit BYTES] [--hard-limit BYTES] [--single-threaded] [--sample N]\n",
+            prog);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        usage(argv[0]);
+        return 2;
+    }
+    const char* path = argv[1];
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return 1;
+    }
+    mp_trace_header_t h;
+    if (fread(&h, sizeof(h), 1, in) != 1 || memcmp(h.magic, MP_TRACE_MAGIC, sizeof(MP_TRACE_MAGIC)) != 0 ||
+        h.version != MP_TRACE_VERSION || h.record_size < sizeof(mp_trace_record_t)) {
+        fprintf(stderr, "%s: not a LibMemPool trace (or unsupported version)\n", path);
+        fclose(in);
+        return 1;
+    }
+
+    pool_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.pool_size = h.pool_size ? (size_t)h.pool_size : 16u * 1024 * 1024;
+    cfg.thread_safe = (h.flags & MP_TRACE_F_THREAD_SAFE) != 0;
+    cfg.alignment = 16;
+    size_t classes[MAX_CLASSES];
+    bool use_malloc = false;
+    size_t sample_every = 4096;
+    for (int i = 2; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        size_t n = 0;
+        if (strcmp(a, "--malloc") == 0) use_malloc = true;
+        else if (strcmp(a, "--packed") == 0) cfg.packed_size_classes = true;
+        else if (strcmp(a, "--adaptive") == 0) cfg.adaptive_sizing = true;
+        else if (strcmp(a, "--release-idle") == 0) cfg.release_idle_children = true;
+        else if (strcmp(a, "--memfd") == 0) cfg.memfd_growth = true;
+        else if (strcmp(a, "--populate") == 0) cfg.populate = true;
+        else if (strcmp(a, "--single-threaded") == 0) cfg.thread_safe = false;
+        else if (!v) { usage(argv[0]); return 2; }
+        else if (strcmp(a, "--pool-size") == 0 && parse_bytes(v, &cfg.pool_size)) i++;
+        else if (strcmp(a, "--alignment") == 0 && parse_bytes(v, &n)) { cfg.alignment = (uint32_t)n; i++; }
+        else if (strcmp(a, "--reserve") == 0 && parse_bytes(v, &cfg.reserve_size)) i++;
+        else if (strcmp(a, "--soft-limit") == 0 && parse_bytes(v, &cfg.soft_limit)) i++;
+        else if (strcmp(a, "--hard-limit") == 0 && parse_bytes(v, &cfg.hard_limit)) i++;
+        else if (strcmp(a, "--sample") == 0 && parse_bytes(v, &sample_every)) i++;
+        else if (strcmp(a, "--huge-pages") == 0) {
+            if (strcmp(v, "none") == 0) cfg.huge_pages = MP_HUGE_PAGES_NONE;
+            else if (strcmp(v, "thp") == 0) cfg.huge_pages = MP_HUGE_PAGES_TRANSPARENT;
+            else if (strcmp(v, "explicit") == 0) cfg.huge_pages = MP_HUGE_PAGES_EXPLICIT;
+            else { usage(argv[0]); return 2; }
+            i++;
+        } else if (strcmp(a, "--classes") == 0) {
+            const char* s = v;
+            while (*s && cfg.num_size_classes < MAX_CLASSES) {
+                char* end = NULL;
+                classes[cfg.num_size_classes++] = (size_t)strtoull(s, &end, 0);
+                if (end == s || (*end && *end != ',')) { usage(argv[0]); return 2; }
+                s = *end ? end + 1 : end;
+            }
+            cfg.enable_size_classes = true;
+            cfg.size_class_sizes = classes;
+            i++;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!sample_every) sample_every = 1;
+
+    replay_t r;
+    memset(&r, 0, sizeof(r));
+    if (!use_malloc) {
+        r.pool = memory_pool_create_with_config(&cfg);
+        if (!r.pool) {
+            fprintf(stderr, "replay: pool creation failed: %s\n",
+                    memory_pool_error_string(memory_pool_get_last_error()));
+            fclose(in);
+            return 1;
+        }
+    }
+
+    // 按块读取，记录步长取头部的 record_size（兼容将来追加字段的轨迹）
+    char* buf = malloc(h.record_size * CHUNK_RECORDS);
+    if (!buf) {
+        fclose(in);
+        return 1;
+    }
+    uint64_t records = 0;
+    uint32_t threads = 0;
+    uint64_t elapsed = 0;
+    uint64_t trace_ns = 0;
+    double fragmentation = 0;
+    size_t segments = 0;
+    size_t got;
+    while ((got = fread(buf, h.record_size, CHUNK_RECORDS, in)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            mp_trace_record_t rec;
+            memcpy(&rec, buf + i * h.record_size, sizeof(rec));
+            if (rec.thread > threads) threads = rec.thread;
+            trace_ns = rec.time_ns;
+            uint64_t t0 = now_ns();
+            replay_record(&r, &rec);
+            elapsed += now_ns() - t0;
+            if (++records % sample_every == 0) sample_fragmentation(&r, &fragmentation, &segments);
+        }
+    }
+    bool read_ok = !ferror(in);
+    fclose(in);
+    free(buf);
+    sample_fragmentation(&r, &fragmentation, &segments); // 轨迹结束时（清理前）的稳态
+
+    mp_pool_stats_t stats;
+    mp_usage_profile_t prof;
+    bool have_stats = r.pool && memory_pool_get_stats(r.pool, &stats) && memory_pool_get_usage_profile(r.pool, &prof);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    double secs = (double)elapsed / 1e9;
+    printf("{\"trace\": \"%s\", \"allocator\": \"%s\", \"ok\": %s", path, use_malloc ? "malloc" : "mempool",
+           read_ok ? "true" : "false");
+    printf(", \"records\": %llu, \"ops\": %llu, \"skipped\": %llu, \"failed\": %llu, \"threads\": %u",
+           (unsigned long long)records, (unsigned long long)r.ops, (unsigned long long)r.skipped,
+           (unsigned long long)r.failed, threads);
+    printf(", \"trace_seconds\": %.4f, \"seconds\": %.4f, \"ops_per_sec\": %.0f", (double)trace_ns / 1e9, secs,
+           secs > 0 ? (double)r.ops / secs : 0.0);
+    printf(", \"peak_rss_bytes\": %llu", (unsigned long long)ru.ru_maxrss * 1024ULL);
+    if (have_stats) {
+        printf(", \"peak_used_bytes\": %zu, \"peak_mapped_bytes\": %zu", stats.peak_bytes, prof.peak_mapped);
+        printf(", \"fragmentation\": %.4f, \"max_fragmentation\": %.4f, \"segments\": %zu", fragmentation,
+               r.max_fragmentation, segments);
+    } else {
+        printf(", \"peak_used_bytes\": null, \"peak_mapped_bytes\": null");
+        printf(", \"fragmentation\": null, \"max_fragmentation\": null, \"segments\": null");
+    }
+    printf("}\n");
+
+    release_all(&r, false);
+    if (r.pool) memory_pool_destroy(r.pool);
+    free(r.objs);
+    return read_ok ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 // Clean, comprehensive example and tests for LibMemPool
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -9,6 +10,10 @@
 #include <unistd.h>
 #include <sys/time.h>
 #include <pthread.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
 #include "../include/memory_pool.h"
 
 #define KB(x) ((size_t)(x) * 1024)
@@ -191,6 +196,1848 @@ static void test_chain_growth(void) {
     printf("[chain] 通过\n");
 }
 
+static void test_release_idle_children(void) {
+    printf("[idle-child] 开始\n");
+    pool_config_t cfg = {
+        .pool_size = KB(64),
+        .thread_safe = true,
+        .alignment = DEFAULT_ALIGNMENT,
+        .release_idle_children = true,
+        .child_idle_ms = 0
+    };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+
+    // 立即回收：子池变空后随 free 一起解除映射
+    void* p = memory_pool_alloc(pool, KB(96));
+    assert(p && pool->next != NULL);
+    memory_pool_free(pool, p);
+    assert(pool->next == NULL);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+
+    // 延迟回收：未到期保留，到期后由 trim 回收
+    cfg.child_idle_ms = 20;
+    pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    p = memory_pool_alloc(pool, KB(96));
+    void* q = memory_pool_alloc(pool, KB(96));
+    assert(p && q && pool->next && pool->next->next);
+    memory_pool_free(pool, p);
+    assert(pool->next != NULL);
+    assert(memory_pool_trim(pool, MP_TRIM_IDLE_CHILDREN) == 0);
+    usleep(30 * 1000);
+    assert(memory_pool_trim(pool, MP_TRIM_IDLE_CHILDREN) > 0);
+    assert(pool->next && pool->next->next == NULL);
+    assert(memory_pool_contains(pool, q));
+    memory_pool_free(pool, q);
+    assert(memory_pool_trim(pool, MP_TRIM_IDLE_CHILDREN | MP_TRIM_FORCE) > 0);
+    assert(pool->next == NULL);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    printf("[idle-child] 通过\n");
+}
+
+static void test_huge_pages(void) {
+    printf("[hugepage] 开始\n");
+    pool_config_t cfg = {
+        .pool_size = MB(3),
+        .thread_safe = true,
+        .alignment = DEFAULT_ALIGNMENT,
+        .huge_pages = MP_HUGE_PAGES_TRANSPARENT
+    };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    assert(((uintptr_t)pool->pool_start % MP_HUGE_PAGE_SIZE) == 0);
+    assert(pool->pool_size == MB(4));
+
+    // 子池同样按大页倍数取整
+    void* big = memory_pool_alloc(pool, MB(5));
+    assert(big && pool->next);
+    assert(pool->next->pool_size % MP_HUGE_PAGE_SIZE == 0);
+    assert(((uintptr_t)pool->next->pool_start % MP_HUGE_PAGE_SIZE) == 0);
+    memset(big, 0x11, MB(5));
+
+    mp_huge_page_stats_t hs;
+    assert(memory_pool_get_huge_page_stats(pool, &hs));
+    assert(hs.segments == 2 && hs.total_bytes == pool->pool_size + pool->next->pool_size);
+    assert(hs.thp_backed_bytes <= hs.thp_advised_bytes);
+    memory_pool_free(pool, big);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+
+    // 显式大页：未预留 hugetlb 时应回退而不是失败
+    cfg.huge_pages = MP_HUGE_PAGES_EXPLICIT;
+    pool = memory_pool_create_with_config(&cfg);
+    assert(pool && pool->pool_size % MP_HUGE_PAGE_SIZE == 0);
+    void* x = memory_pool_alloc(pool, KB(64));
+    assert(x);
+    memory_pool_free(pool, x);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    printf("[hugepage] 通过\n");
+}
+
+static void test_reserve_commit(void) {
+    printf("[reserve] 开始\n");
+    pool_config_t cfg = {
+        .pool_size = KB(64),
+        .thread_safe = true,
+        .alignment = DEFAULT_ALIGNMENT,
+        .reserve_size = MB(64)
+    };
+    // 显式大页无法在预留区内按需提交，组合被拒绝
+    cfg.huge_pages = MP_HUGE_PAGES_EXPLICIT;
+    assert(!memory_pool_create_with_config(&cfg) && memory_pool_get_last_error() == POOL_ERROR_INVALID_SIZE);
+    cfg.huge_pages = MP_HUGE_PAGES_NONE;
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool && pool->reserved_size == MB(64) && pool->pool_size == KB(64));
+
+    // 扩展在预留区内原地提交，不产生子池
+    void* a = memory_pool_alloc(pool, KB(40));
+    void* b = memory_pool_alloc(pool, KB(96));
+    assert(a && b && pool->next == NULL);
+    assert(pool->pool_size > KB(64));
+    assert(memory_pool_contains(pool, a) && memory_pool_contains(pool, b));
+    memset(b, 0x22, KB(96));
+
+    // 释放后跨越原提交边界合并为单个空闲块
+    memory_pool_free(pool, a);
+    memory_pool_free(pool, b);
+    assert(memory_pool_validate(pool));
+    void* whole = memory_pool_alloc(pool, pool->pool_size - 2 * sizeof(memory_block_t));
+    assert(whole && pool->next == NULL);
+    memory_pool_free(pool, whole);
+
+    // 预留区耗尽后回退到子池
+    void* huge = memory_pool_alloc(pool, MB(80));
+    assert(huge && pool->next != NULL);
+    memory_pool_free(pool, huge);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    printf("[reserve] 通过\n");
+}
+
+// 统计 [addr, addr+len) 中驻留物理内存的页数
+// 进程常驻内存（/proc/self/statm 第二列）
+static size_t process_rss(void) {
+    FILE* f = fopen("/proc/self/statm", "r");
+    assert(f);
+    unsigned long size = 0, resident = 0;
+    assert(fscanf(f, "%lu %lu", &size, &resident) == 2);
+    fclose(f);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static size_t resident_pages(void* addr, size_t len) {
+    uintptr_t start = (uintptr_t)addr & ~(uintptr_t)4095;
+    len += (uintptr_t)addr - start;
+    addr = (void*)start;
+    size_t pages = (len + 4095) / 4096;
+    unsigned char* vec = (unsigned char*)malloc(pages);
+    assert(vec && mincore(addr, len, vec) == 0);
+    size_t n = 0;
+    for (size_t i = 0; i < pages; ++i) n += vec[i] & 1;
+    free(vec);
+    return n;
+}
+
+static void test_warmup_options(void) {
+    printf("[warmup] 开始\n");
+    memory_pool_segment_cache_flush(); // 驻留断言需要全新映射
+    memory_pool_t* pool = memory_pool_create(MB(8), true);
+    assert(pool);
+    void* keep = memory_pool_alloc(pool, 1000);
+    assert(keep);
+    memset(keep, 0x5C, 1000);
+
+    // 仅预热前 2MB，4 线程并行
+    mp_warmup_options_t opts = { .max_bytes = MB(2), .threads = 4, .touch_only = false };
+    assert(memory_pool_warmup_ex(pool, &opts));
+    assert(resident_pages(pool->pool_start, MB(2)) == MB(2) / 4096);
+    assert(resident_pages((char*)pool->pool_start + MB(4), MB(4)) == 0);
+
+    // 逐页触摸路径不改写已有数据与块头
+    opts.max_bytes = 0;
+    opts.touch_only = true;
+    assert(memory_pool_warmup_ex(pool, &opts));
+    assert(resident_pages(pool->pool_start, MB(8)) == MB(8) / 4096);
+    assert(((unsigned char*)keep)[0] == 0x5C && ((unsigned char*)keep)[999] == 0x5C);
+    memory_pool_free(pool, keep);
+    assert(memory_pool_validate(pool));
+
+    // 跨多个窗口（每轮之间释放锁）与多个段：子池同样全部预热
+    void* big = memory_pool_alloc(pool, MB(20));
+    assert(big && pool->next);
+    opts.touch_only = false;
+    opts.threads = 2;
+    assert(memory_pool_warmup_ex(pool, &opts));
+    assert(resident_pages(pool->pool_start, pool->pool_size) == pool->pool_size / 4096);
+    assert(resident_pages(pool->next->pool_start, pool->next->pool_size) == pool->next->pool_size / 4096);
+
+    // 中间段被回收后按段序号续接：其后的段仍全部预热
+    void* big2 = memory_pool_alloc(pool, MB(24));
+    assert(big2 && pool->next && pool->next->next);
+    memory_pool_free(pool, big);
+    memory_pool_trim(pool, MP_TRIM_IDLE_CHILDREN | MP_TRIM_FORCE);
+    assert(pool->next && !pool->next->next && pool->next->seg_serial == 2);
+    memory_pool_segment_cache_flush();
+    opts.threads = 3;
+    assert(memory_pool_warmup_ex(pool, &opts));
+    assert(resident_pages(pool->next->pool_start, pool->next->pool_size) == pool->next->pool_size / 4096);
+    assert(memory_pool_validate(pool));
+    memory_pool_free(pool, big2);
+    memory_pool_destroy(pool);
+
+    // 创建时预缺页
+    pool_config_t cfg = { .pool_size = MB(4), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT, .populate = true };
+    pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    assert(resident_pages(pool->pool_start, pool->pool_size) == pool->pool_size / 4096);
+    memory_pool_destroy(pool);
+    printf("[warmup] 通过\n");
+}
+
+static bool all_zero(const unsigned char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) if (p[i]) return false;
+    return true;
+}
+
+static void test_calloc_zero_tracking(void) {
+    printf("[calloc-zero] 开始\n");
+    memory_pool_segment_cache_flush(); // 需要全新映射（缓存段已被写过）
+    memory_pool_t* pool = memory_pool_create(MB(16), true);
+    assert(pool);
+
+    // 新映射尾部：calloc 不写入，页面保持未驻留
+    unsigned char* a = (unsigned char*)memory_pool_calloc(pool, 1, MB(8));
+    assert(a && resident_pages(a + 4096, MB(8) - 8192) < 8);
+    assert(all_zero(a, MB(8)));
+    memset(a, 0xFF, MB(8));
+    memory_pool_free(pool, a);
+
+    // 脏内存必须真正清零
+    unsigned char* b = (unsigned char*)memory_pool_calloc(pool, 1024, 1024);
+    assert(b && all_zero(b, MB(1)));
+    memset(b, 0xEE, MB(1));
+    memory_pool_free(pool, b);
+
+    // DONTNEED 归还的页面：内容为零且 calloc 不再触及
+    assert(memory_pool_trim(pool, MP_TRIM_PAGES) > 0);
+    unsigned char* c = (unsigned char*)memory_pool_calloc(pool, 1, MB(4));
+    assert(c && resident_pages(c + 4096, MB(4) - 8192) < 8);
+    assert(all_zero(c, MB(4)));
+
+    // 普通分配随后写脏，再次释放 / calloc 仍需清零
+    memset(c, 0x77, MB(4));
+    memory_pool_free(pool, c);
+    unsigned char* d = (unsigned char*)memory_pool_calloc(pool, 1, MB(4) + 100);
+    assert(d && all_zero(d, MB(4) + 100));
+    memory_pool_free(pool, d);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    printf("[calloc-zero] 通过\n");
+}
+
+typedef struct {
+    size_t name_off;   // 持久化数据之间用偏移互相引用
+    int count;
+} persist_root_t;
+
+static void test_persistent_pool(void) {
+    printf("[persist] 开始\n");
+    char path[] = "/tmp/mempool_persist_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    memory_pool_t* pool = memory_pool_create_persistent(path, MB(4));
+    assert(pool);
+    persist_root_t* root = (persist_root_t*)memory_pool_alloc(pool, sizeof(*root));
+    char* name = (char*)memory_pool_alloc(pool, 64);
+    void* scratch = memory_pool_alloc(pool, 3000);
+    assert(root && name && scratch);
+    strcpy(name, "warm-cache");
+    root->name_off = memory_pool_ptr_to_offset(pool, name);
+    root->count = 42;
+    memory_pool_free(pool, scratch);
+    assert(memory_pool_set_root(pool, root));
+    assert(memory_pool_sync(pool));
+    void* old_base = pool->map_base;
+    memory_pool_destroy(pool);
+
+    // 原址重开：堆完整可用
+    pool = memory_pool_create_persistent(path, 0);
+    assert(pool && memory_pool_validate(pool));
+    root = (persist_root_t*)memory_pool_get_root(pool);
+    assert(root && root->count == 42);
+    assert(strcmp((char*)memory_pool_offset_to_ptr(pool, root->name_off), "warm-cache") == 0);
+    void* more = memory_pool_alloc(pool, 1000);
+    assert(more);
+    memory_pool_destroy(pool);
+
+    // 占住原地址，迫使重开时整体重定位
+    void* blocker = mmap(old_base, 4096, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    assert(blocker == old_base);
+    pool = memory_pool_create_persistent(path, 0);
+    assert(pool && pool->map_base != old_base);
+    assert(memory_pool_validate(pool));
+    root = (persist_root_t*)memory_pool_get_root(pool);
+    assert(root && root->count == 42);
+    assert(strcmp((char*)memory_pool_offset_to_ptr(pool, root->name_off), "warm-cache") == 0);
+    void* big = memory_pool_alloc(pool, MB(2));
+    assert(big);
+    memory_pool_free(pool, big);
+    // 文件池不链式扩展
+    assert(memory_pool_alloc(pool, MB(8)) == NULL && pool->next == NULL);
+    assert(memory_pool_validate(pool));
+    // 同一文件同时只能打开一次：第二次打开会重定位并改坏正在使用的映射
+    assert(memory_pool_create_persistent(path, 0) == NULL);
+    assert(memory_pool_get_last_error() == POOL_ERROR_IO);
+    memory_pool_destroy(pool);
+    munmap(blocker, 4096);
+
+    // 进程在空闲结构更新中途退出：重开时按块头重建空闲链与红黑树
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        memory_pool_t* cp = memory_pool_create_persistent(path, 0);
+        if (!cp) _exit(1);
+        void* a = memory_pool_alloc(cp, 1000);
+        void* b = memory_pool_alloc(cp, 2000);
+        if (!a || !b) _exit(2);
+        memory_pool_free(cp, a);
+        cp->rb_root = 0;
+        cp->free_list = 0;
+        _exit(0); // 未 destroy：文件保持未正常关闭
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    pool = memory_pool_create_persistent(path, 0);
+    assert(pool && memory_pool_validate(pool));
+    root = (persist_root_t*)memory_pool_get_root(pool);
+    assert(root && root->count == 42);
+    big = memory_pool_alloc(pool, MB(2));
+    assert(big);
+    memory_pool_free(pool, big);
+    memory_pool_destroy(pool);
+
+    // 格式化未完成（魔数为 0）的文件重新格式化
+    fd = open(path, O_WRONLY | O_TRUNC);
+    static const char zeros[4096];
+    assert(fd >= 0 && write(fd, zeros, sizeof(zeros)) == (ssize_t)sizeof(zeros));
+    close(fd);
+    pool = memory_pool_create_persistent(path, MB(1));
+    assert(pool && memory_pool_get_root(pool) == NULL && memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+
+    // 非池文件拒绝打开
+    fd = open(path, O_WRONLY | O_TRUNC);
+    assert(fd >= 0 && write(fd, "garbage", 7) == 7);
+    close(fd);
+    assert(memory_pool_create_persistent(path, MB(1)) == NULL);
+    assert(memory_pool_get_last_error() == POOL_ERROR_CORRUPTION);
+    unlink(path);
+    printf("[persist] 通过\n");
+}
+
+static void test_shared_pool(void) {
+    printf("[shared] 开始\n");
+    // memfd：子进程经 fork 继承映射，直接在同一池中分配
+    int fd = -1;
+    memory_pool_t* pool = memory_pool_create_shared_fd(MB(4), &fd);
+    assert(pool && fd >= 0);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        char* msg = (char*)memory_pool_alloc(pool, 128);
+        if (!msg) _exit(1);
+        strcpy(msg, "from-child");
+        _exit(memory_pool_set_root(pool, msg) ? 0 : 2);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    char* msg = (char*)memory_pool_get_root(pool);
+    assert(msg && strcmp(msg, "from-child") == 0);
+    memory_pool_free(pool, msg);
+    assert(memory_pool_validate(pool));
+
+    // 持锁进程死在空闲结构更新中途：下一个加锁者按块头重建后继续使用
+    void* keep = memory_pool_alloc(pool, 1000);
+    assert(keep);
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->free_list = 0;
+        pool->rb_root = 0;
+        _exit(0);
+    }
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status));
+    void* after = memory_pool_alloc(pool, 4000);
+    assert(after && pool->lock_recoveries == 1 && !pool->poisoned);
+    assert(memory_pool_validate(pool));
+    memory_pool_free(pool, after);
+
+    // 块头已损坏、无法重建：池被标记为 poisoned，此后分配与释放失败
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        pthread_mutex_lock(&pool->mutex);
+        ((memory_block_t*)((char*)keep - sizeof(memory_block_t)))->magic ^= 0xFFFF;
+        _exit(0);
+    }
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status));
+    assert(memory_pool_alloc(pool, 64) == NULL && memory_pool_get_last_error() == POOL_ERROR_CORRUPTION);
+    assert(pool->poisoned && pool->lock_recoveries == 2);
+    memory_pool_free(pool, keep);
+    assert(memory_pool_get_last_error() == POOL_ERROR_CORRUPTION);
+    assert(!memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    close(fd);
+
+    // 具名共享对象：子进程先解除继承的映射，再按名字重新挂接
+    char name[64];
+    snprintf(name, sizeof(name), "/mempool_test_%d", (int)getpid());
+    pool = memory_pool_create_shared(name, MB(2));
+    assert(pool);
+    size_t* counter = (size_t*)memory_pool_alloc(pool, sizeof(size_t));
+    assert(counter);
+    *counter = 0;
+    assert(memory_pool_set_root(pool, counter));
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        memory_pool_destroy(pool);
+        memory_pool_t* att = memory_pool_attach_shared(name);
+        if (!att) _exit(1);
+        size_t* c = (size_t*)memory_pool_get_root(att);
+        for (int i = 0; i < 100; ++i) {
+            void* p = memory_pool_alloc(att, 64 + i);
+            if (!p) _exit(2);
+            memory_pool_free(att, p);
+            (*c)++;
+        }
+        memory_pool_destroy(att);
+        _exit(0);
+    }
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(*counter == 100);
+    assert(memory_pool_validate(pool));
+    // 同一进程再挂接一次：映射在另一地址，两个视图经偏移链接操作同一个堆
+    memory_pool_t* view = memory_pool_attach_shared(name);
+    assert(view && view != pool);
+    size_t* vc = (size_t*)memory_pool_get_root(view);
+    assert(vc && (char*)vc != (char*)counter && *vc == 100);
+    size_t used0 = pool->used_size;
+    void* objs[16];
+    for (int i = 0; i < 16; ++i) {
+        objs[i] = memory_pool_alloc(view, 48 + 16 * i);
+        assert(objs[i]);
+    }
+    for (int i = 0; i < 16; i += 2) {
+        // 在另一个视图中释放：按偏移换算到本映射中的地址
+        size_t off = memory_pool_ptr_to_offset(view, objs[i]);
+        memory_pool_free(pool, memory_pool_offset_to_ptr(pool, off));
+    }
+    assert(memory_pool_validate(pool) && memory_pool_validate(view));
+    for (int i = 1; i < 16; i += 2) memory_pool_free(view, objs[i]);
+    assert(memory_pool_validate(pool) && memory_pool_validate(view));
+    assert(pool->used_size == used0);
+    memory_pool_destroy(view);
+    assert(memory_pool_unlink_shared(name));
+    memory_pool_destroy(pool);
+    printf("[shared] 通过\n");
+}
+
+static void test_locked_pool(void) {
+    printf("[mlock] 开始\n");
+    // 非必需模式：RLIMIT_MEMLOCK 不足时退化为普通段，仅在已锁定时检查常驻
+    pool_config_t cfg = { .pool_size = MB(1), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT,
+                          .reserve_size = MB(2), .lock_memory = true };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    bool locked = (pool->seg_flags & MP_SEG_LOCKED) != 0;
+    if (locked) assert(resident_pages(pool->pool_start, pool->pool_size) == pool->pool_size / 4096);
+
+    // 预留区内原地提交与子池都继承锁定
+    void* a = memory_pool_alloc(pool, KB(512));
+    void* b = memory_pool_alloc(pool, KB(800));
+    void* c = memory_pool_alloc(pool, MB(1));
+    assert(a && b && c && pool->next);
+    if (locked) {
+        assert(pool->pool_size == MB(2));
+        assert(resident_pages(pool->pool_start, pool->pool_size) == pool->pool_size / 4096);
+        assert(pool->next->seg_flags & MP_SEG_LOCKED);
+        assert(resident_pages(pool->next->pool_start, pool->next->pool_size) == pool->next->pool_size / 4096);
+    }
+
+    // 锁定段不被 trim 交还
+    memory_pool_free(pool, a);
+    memory_pool_trim(pool, MP_TRIM_PAGES);
+    if (locked) {
+        assert(resident_pages(pool->pool_start, pool->pool_size) == pool->pool_size / 4096);
+        assert(memory_pool_calloc(pool, 1, KB(64)) != NULL);
+    }
+    memory_pool_free(pool, b);
+    memory_pool_free(pool, c);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+
+    // 必需模式：锁定失败即创建失败，成功则一定已锁定
+    cfg.reserve_size = 0;
+    cfg.lock_required = true;
+    pool = memory_pool_create_with_config(&cfg);
+    assert(!pool || (pool->seg_flags & MP_SEG_LOCKED));
+    if (pool) memory_pool_destroy(pool);
+    printf("[mlock] 通过\n");
+}
+
+static void test_segment_cache(void) {
+    printf("[seg-cache] 开始\n");
+    memory_pool_segment_cache_flush();
+    mp_segment_cache_stats_t st0, st;
+    // 默认关闭：销毁的段直接解除映射
+    memory_pool_t* pool = memory_pool_create(KB(256), true);
+    assert(pool);
+    memory_pool_destroy(pool);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 0 && st.bytes == 0);
+    memory_pool_segment_cache_set_limit(16, MB(64));
+    memory_pool_segment_cache_get_stats(&st0);
+
+    // 销毁后同配置创建复用同一段，池结构体位于段头页
+    pool = memory_pool_create(KB(256), true);
+    assert(pool && (pool->seg_flags & MP_SEG_EMBEDDED));
+    assert((char*)pool + 4096 == (char*)pool->pool_start);
+    void* old_start = pool->pool_start;
+    unsigned char* p = (unsigned char*)memory_pool_alloc(pool, 1000);
+    memset(p, 0xEE, 1000);
+    memory_pool_destroy(pool);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 1 && st.bytes == KB(256) + 4096);
+
+    pool = memory_pool_create(KB(256), true);
+    assert(pool && pool->pool_start == old_start);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.hits == st0.hits + 1 && st.segments == 0);
+    // 复用段是脏的：calloc 必须真正清零
+    unsigned char* z = (unsigned char*)memory_pool_calloc(pool, 1, 1000);
+    assert(z && all_zero(z, 1000));
+    assert(memory_pool_validate(pool));
+
+    // 子池同样进入缓存并被下一个池复用
+    void* big = memory_pool_alloc(pool, KB(300));
+    assert(big && pool->next);
+    memory_pool_destroy(pool);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 2);
+
+    // 尺寸不同不命中
+    pool = memory_pool_create(KB(128), false);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(pool && st.misses == st0.misses + 3 && st.segments == 2); // 首个池、子池、本池
+    memory_pool_destroy(pool);
+
+    // 上限收缩立即淘汰最旧的段；上限为 0 关闭缓存
+    memory_pool_segment_cache_set_limit(1, MB(64));
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 1 && st.bytes == KB(128) + 4096);
+    memory_pool_segment_cache_set_limit(0, 0);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 0 && st.bytes == 0);
+    pool = memory_pool_create(KB(128), false);
+    memory_pool_destroy(pool);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 0);
+
+    // 开启缓存时，空闲子池回收仍然解除映射：内存真正归还系统（检查常驻而不仅是计数）
+    memory_pool_segment_cache_set_limit(16, MB(64));
+    pool = memory_pool_create(KB(256), true);
+    assert(pool);
+    void* huge = memory_pool_alloc(pool, MB(32));
+    assert(huge && pool->next);
+    memset(huge, 0x5A, MB(32));
+    size_t rss_before = process_rss();
+    memory_pool_free(pool, huge);
+    assert(memory_pool_trim(pool, MP_TRIM_IDLE_CHILDREN | MP_TRIM_FORCE) >= MB(32));
+    assert(pool->next == NULL);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 0 && st.bytes == 0);
+    assert(process_rss() + MB(28) <= rss_before);
+    memory_pool_destroy(pool);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 1); // 销毁的 master 段进入缓存
+
+    memory_pool_segment_cache_set_limit(MP_SEGMENT_CACHE_DEFAULT_ENTRIES, MP_SEGMENT_CACHE_DEFAULT_BYTES);
+    memory_pool_segment_cache_get_stats(&st);
+    assert(st.segments == 0 && memory_pool_segment_cache_flush() == 0);
+    printf("[seg-cache] 通过\n");
+}
+
+static void test_packed_size_classes(void) {
+    printf("[packed] 开始\n");
+    size_t sizes[] = { 24, 100 };
+    pool_config_t cfg = { .pool_size = MB(1), .thread_safe = true, .alignment = 16,
+                          .enable_size_classes = true, .size_class_sizes = sizes, .num_size_classes = 2,
+                          .packed_size_classes = true };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+
+    // 对象无块头、首尾相接
+    enum { N = 256 };
+    unsigned char* objs[N];
+    for (int i = 0; i < N; ++i) {
+        objs[i] = (unsigned char*)memory_pool_alloc_fixed(pool, 20);
+        assert(objs[i] && ((uintptr_t)objs[i] & 15) == 0);
+        memset(objs[i], i & 0xFF, 24);
+    }
+    for (int i = 1; i < N; ++i) assert(objs[i] - objs[i - 1] == 32);
+    assert(memory_pool_is_packed(pool, objs[0]));
+    assert(memory_pool_get_block_size(pool, objs[0]) == 32);
+
+    // 释放只写侧表：对象内容与相邻对象都不被改写
+    memory_pool_free(pool, objs[10]);
+    assert(memory_pool_get_last_error() == POOL_OK);
+    for (int j = 9; j <= 11; ++j) assert(objs[j][0] == j && objs[j][23] == j);
+    memory_pool_free(pool, objs[10]);
+    assert(memory_pool_get_last_error() == POOL_ERROR_DOUBLE_FREE);
+    memory_pool_free(pool, objs[11] + 8);
+    assert(memory_pool_get_last_error() == POOL_ERROR_INVALID_POINTER);
+    assert(memory_pool_alloc_fixed(pool, 24) == objs[10]); // LIFO 复用
+
+    // 超过一个 slab 的容量时按需补充新 slab；slab 变空后交还通用堆（类的唯一 slab 除外）
+    size_t slab_objs = pool->size_classes[0].block_count;
+    size_t used_before = pool->used_size;
+    size_t extra = MB(1) / 4 / 32;
+    unsigned char** more = (unsigned char**)malloc(sizeof(*more) * extra);
+    for (size_t i = 0; i < extra; ++i) assert((more[i] = memory_pool_alloc_fixed(pool, 24)) != NULL);
+    assert(pool->size_classes[0].used_count == N + extra);
+    assert(pool->size_classes[0].block_count > slab_objs);
+    // 通用块夹在多个 slab 之间：按块头标记反查 slab，不会误判
+    void* plain = memory_pool_alloc(pool, 40);
+    assert(plain && !memory_pool_is_packed(pool, plain));
+    for (size_t i = 0; i < extra; ++i) {
+        assert(memory_pool_is_packed(pool, more[i]) && memory_pool_get_block_size(pool, more[i]) == 32);
+    }
+    for (size_t i = 0; i < extra; ++i) {
+        memory_pool_free_fixed(pool, more[i]);
+        assert(memory_pool_get_last_error() == POOL_OK);
+    }
+    free(more);
+    memory_pool_free(pool, plain);
+    assert(memory_pool_get_last_error() == POOL_OK);
+    assert(pool->size_classes[0].block_count == slab_objs);
+    assert(pool->used_size == used_before);
+    assert(memory_pool_validate(pool));
+
+    // realloc 从紧凑对象迁到通用块，数据保留
+    unsigned char* r = (unsigned char*)memory_pool_realloc(pool, objs[20], 4000);
+    assert(r && !memory_pool_is_packed(pool, r) && r[0] == 20 && r[23] == 20);
+    memory_pool_free(pool, r);
+
+    // 显式添加紧凑类
+    int ci = memory_pool_add_size_class(pool, 200, 10);
+    assert(ci == 2 && pool->size_classes[ci].block_count == 10 && pool->size_classes[ci].block_size == 208);
+    void* mid = memory_pool_alloc_fixed(pool, 90);
+    void* big = memory_pool_alloc_fixed(pool, 150);
+    assert(mid && memory_pool_get_block_size(pool, mid) == 112);
+    assert(big && memory_pool_get_block_size(pool, big) == 208);
+    memory_pool_free(pool, mid);
+    memory_pool_free(pool, big);
+
+    for (int i = 0; i < N; ++i) if (i != 20) memory_pool_free(pool, objs[i]);
+    assert(pool->size_classes[0].used_count == 0);
+    assert(memory_pool_validate(pool));
+    memory_pool_reset(pool);
+    assert(memory_pool_alloc_fixed(pool, 24) != NULL);
+    // 旧 slab 的块头已随重置作废：覆盖原 slab 区域的通用块按通用路径释放
+    void* cover[32];
+    for (int i = 0; i < 32; ++i) assert((cover[i] = memory_pool_alloc(pool, 4000)) != NULL);
+    for (int i = 0; i < 32; ++i) {
+        assert(!memory_pool_is_packed(pool, cover[i]));
+        memory_pool_free(pool, cover[i]);
+        assert(memory_pool_get_last_error() == POOL_OK);
+    }
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    printf("[packed] 通过\n");
+}
+
+static size_t chain_length(memory_pool_t* pool) {
+    size_t n = 0;
+    for (memory_pool_t* p = pool; p; p = p->next) n++;
+    return n;
+}
+
+static void test_usage_profile(void) {
+    printf("[profile] 开始\n");
+    enum { N = 2048 };
+    void** ptrs = (void**)malloc(sizeof(void*) * N);
+
+    // 固定尺寸链：每次扩展只加一个 pool_size 的子池
+    memory_pool_t* fixed = memory_pool_create(KB(64), true);
+    assert(fixed);
+    for (int i = 0; i < N; ++i) assert((ptrs[i] = memory_pool_alloc(fixed, 1000)) != NULL);
+    mp_usage_profile_t pr;
+    assert(memory_pool_get_usage_profile(fixed, &pr));
+    assert(pr.alloc_requests == N && pr.size_hist[9] == N); // 1000 ∈ [512, 1024)
+    assert(pr.current_used == pr.peak_used && pr.peak_used >= (size_t)N * 1000);
+    assert(pr.segments == chain_length(fixed) && pr.child_pools_created == pr.segments - 1);
+    assert(pr.growth_events == pr.child_pools_created && pr.peak_mapped == pr.mapped_bytes);
+    for (int i = 0; i < N / 2; ++i) memory_pool_free(fixed, ptrs[i]);
+    assert(memory_pool_get_usage_profile(fixed, &pr));
+    assert(pr.current_used < pr.peak_used);
+    size_t fixed_segments = pr.segments;
+
+    // 建议配置覆盖峰值，导出 JSON
+    pool_config_t suggested;
+    assert(memory_pool_suggest_config(fixed, &suggested));
+    assert(suggested.pool_size >= pr.peak_used && suggested.thread_safe);
+    char* json = NULL;
+    size_t json_len = 0;
+    FILE* mem = open_memstream(&json, &json_len);
+    assert(mem && memory_pool_export_profile(fixed, mem));
+    fclose(mem);
+    assert(strstr(json, "\"peak_used\"") && strstr(json, "\"size_classes\": [1024]"));
+    free(json);
+    memory_pool_destroy(fixed);
+
+    // 自适应：子池几何增长，链长明显更短
+    pool_config_t cfg = { .pool_size = KB(64), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT, .adaptive_sizing = true };
+    memory_pool_t* adaptive = memory_pool_create_with_config(&cfg);
+    assert(adaptive);
+    for (int i = 0; i < N; ++i) assert((ptrs[i] = memory_pool_alloc(adaptive, 1000)) != NULL);
+    assert(memory_pool_get_usage_profile(adaptive, &pr));
+    assert(pr.segments * 3 < fixed_segments);
+    for (int i = 0; i < N; ++i) memory_pool_free(adaptive, ptrs[i]);
+    assert(memory_pool_validate(adaptive));
+    memory_pool_destroy(adaptive);
+
+    // 自适应固定大小类：未命中时按已用量批量补充
+    size_t sizes[] = { 48 };
+    pool_config_t ccfg = { .pool_size = MB(1), .thread_safe = true, .alignment = 16,
+                           .enable_size_classes = true, .size_class_sizes = sizes, .num_size_classes = 1,
+                           .adaptive_sizing = true };
+    memory_pool_t* cp = memory_pool_create_with_config(&ccfg);
+    assert(cp);
+    for (int i = 0; i < 512; ++i) assert((ptrs[i] = memory_pool_alloc_fixed(cp, 40)) != NULL);
+    assert(cp->size_classes[0].used_count == 512);
+    assert(cp->size_classes[0].block_count > 0 && cp->size_classes[0].free_blocks);
+    assert(cp->size_classes[0].block_count >= 256); // 多数分配由批量预留的块满足
+    for (int i = 0; i < 512; ++i) memory_pool_free_fixed(cp, ptrs[i]);
+    assert(cp->size_classes[0].used_count == 0);
+    assert(memory_pool_validate(cp));
+    memory_pool_destroy(cp);
+    free(ptrs);
+    printf("[profile] 通过\n");
+}
+
+static void test_memfd_growth(void) {
+    printf("[memfd-grow] 开始\n");
+    pool_config_t cfg = { .pool_size = KB(256), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT, .memfd_growth = true };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool && (pool->seg_flags & MP_SEG_MEMFD) && pool->fd >= 0);
+
+    // 尾部空闲块与 mremap 延长的新空间合并，不产生子池
+    unsigned char* a = (unsigned char*)memory_pool_alloc(pool, KB(200));
+    unsigned char* b = (unsigned char*)memory_pool_alloc(pool, KB(300));
+    assert(a && b && !pool->next && pool->pool_size >= KB(512));
+    assert((char*)b < (char*)pool->pool_start + KB(256)); // 跨越原段尾
+    memset(a, 0xA1, KB(200));
+    memset(b, 0xB2, KB(300));
+
+    // 大请求同样原地满足
+    unsigned char* big = (unsigned char*)memory_pool_alloc(pool, MB(4));
+    assert(big && !pool->next && all_zero(big, MB(4)));
+    mp_usage_profile_t pr;
+    assert(memory_pool_get_usage_profile(pool, &pr));
+    assert(pr.in_place_growths == 2 && pr.child_pools_created == 0 && pr.segments == 1);
+    assert(a[0] == 0xA1 && b[KB(300) - 1] == 0xB2);
+
+    // 全部释放后整段合并为一个空闲块
+    memory_pool_free(pool, a);
+    memory_pool_free(pool, b);
+    memory_pool_free(pool, big);
+    assert(memory_pool_validate(pool));
+    memory_block_t* only = (memory_block_t*)pool->free_list; // 非共享池的链接即块地址
+    assert(only && only->size == pool->pool_size && !only->u.next);
+
+    // 私有映射：trim 后页面读出为零
+    assert(memory_pool_trim(pool, MP_TRIM_PAGES) > 0);
+    unsigned char* z = (unsigned char*)memory_pool_calloc(pool, 1, MB(1));
+    assert(z && all_zero(z, MB(1)));
+    memory_pool_free(pool, z);
+
+    // 预留余量耗尽后回退到子池
+    void* huge = memory_pool_alloc(pool, MB(32));
+    assert(huge && pool->next);
+    memory_pool_free(pool, huge);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    printf("[memfd-grow] 通过\n");
+}
+
+static void test_numa(void) {
+    printf("[numa] 开始\n");
+    int nodes = memory_pool_numa_node_count();
+    assert(nodes >= 1 && nodes <= MP_NUMA_MAX_NODES);
+
+    // BIND 到节点 0：策略在首次缺页前施加，可经 get_mempolicy 核对
+    pool_config_t cfg = { .pool_size = KB(256), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT,
+                          .numa_policy = MP_NUMA_BIND, .numa_node = 0 };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    char* p = (char*)memory_pool_alloc(pool, KB(64));
+    assert(p);
+    memset(p, 0x5A, KB(64));
+    if (pool->seg_flags & MP_SEG_NUMA) {
+        int mode = -1;
+        unsigned long mask = 0;
+        if (syscall(SYS_get_mempolicy, &mode, &mask, sizeof(mask) * 8, p, 2 /* MPOL_F_ADDR */) == 0) {
+            assert(mode == 2 /* MPOL_BIND */ && mask == 1);
+        }
+    }
+    // 子池继承策略
+    void* big = memory_pool_alloc(pool, MB(1));
+    assert(big && pool->next && (pool->next->seg_flags & MP_SEG_NUMA) == (pool->seg_flags & MP_SEG_NUMA));
+    memory_pool_free(pool, big);
+    memory_pool_free(pool, p);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+
+    // 单节点上 INTERLEAVE / LOCAL 不施加策略；不存在的节点退化为无策略，创建不失败
+    mp_numa_policy_t policies[] = { MP_NUMA_INTERLEAVE, MP_NUMA_LOCAL, MP_NUMA_PREFERRED, MP_NUMA_BIND };
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        pool_config_t c = cfg;
+        c.numa_policy = policies[i];
+        c.numa_node = MP_NUMA_MAX_NODES - 1;
+        memory_pool_t* q = memory_pool_create_with_config(&c);
+        assert(q);
+        if (nodes == 1) assert(!(q->seg_flags & MP_SEG_NUMA));
+        void* x = memory_pool_calloc(q, 16, 1024);
+        assert(x);
+        memory_pool_free(q, x);
+        memory_pool_destroy(q);
+    }
+
+    // 节点 arena：任意线程分配的指针都能经 master 释放
+    pool_config_t ac = cfg;
+    ac.numa_policy = MP_NUMA_NONE;
+    ac.numa_arenas = true;
+    memory_pool_t* ap = memory_pool_create_with_config(&ac);
+    assert(ap && ap->config.numa_policy == MP_NUMA_BIND);
+    void* ptrs[64];
+    for (int i = 0; i < 64; i++) {
+        ptrs[i] = (i & 1) ? memory_pool_alloc_aligned(ap, 100 + i, 64) : memory_pool_alloc(ap, 100 + i * 10);
+        assert(ptrs[i] && memory_pool_contains(ap, ptrs[i]));
+    }
+    for (int i = 0; i < MP_NUMA_MAX_NODES; i++) {
+        if (nodes == 1) assert(ap->numa_arenas[i] == NULL);
+    }
+    for (int i = 0; i < 64; i++) memory_pool_free(ap, ptrs[i]);
+    assert(memory_pool_validate(ap));
+    memory_pool_destroy(ap);
+    printf("[numa] 通过\n");
+}
+
+static void test_memory_report(void) {
+    printf("[report] 开始\n");
+    memory_pool_segment_cache_flush(); // 常驻统计需要全新映射
+    pool_config_t cfg = { .pool_size = MB(1), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    mp_memory_report_t r;
+    assert(memory_pool_get_memory_report(pool, &r));
+    assert(r.segments == 1 && r.committed_bytes == pool->pool_size && r.used_bytes == 0);
+    assert(r.free_blocks == 1 && r.largest_free_block == r.free_bytes && r.fragmentation == 0.0);
+    assert(r.resident_bytes < KB(64)); // 仅初始块头所在页被触及
+
+    // 交错释放产生外部碎片
+    void* ptrs[32];
+    for (int i = 0; i < 32; i++) {
+        ptrs[i] = memory_pool_alloc(pool, KB(16));
+        assert(ptrs[i]);
+        memset(ptrs[i], 0x33, KB(16));
+    }
+    for (int i = 0; i < 32; i += 2) memory_pool_free(pool, ptrs[i]);
+    assert(memory_pool_get_memory_report(pool, &r));
+    assert(r.used_bytes + r.free_bytes == r.committed_bytes && r.used_bytes == pool->used_size);
+    assert(r.allocated_blocks == 16 && r.header_bytes == 16 * sizeof(memory_block_t));
+    assert(r.free_blocks == 17 && r.fragmentation > 0.0 && r.fragmentation < 1.0);
+    assert(r.resident_bytes >= KB(512) && r.resident_bytes <= r.committed_bytes);
+
+    // 空闲页交还后常驻下降
+    size_t before = r.resident_bytes;
+    assert(memory_pool_trim(pool, MP_TRIM_PAGES) > 0);
+    assert(memory_pool_get_memory_report(pool, &r));
+    assert(r.resident_bytes < before);
+
+    // size-class 私有空闲链计入预留
+    assert(memory_pool_add_size_class(pool, 64, 32) >= 0);
+    assert(memory_pool_get_memory_report(pool, &r));
+    assert(r.size_class_reserve_bytes >= 32 * 64);
+
+    // 逐段报告：扩展出子池后段数增加
+    void* big = memory_pool_alloc(pool, MB(2));
+    assert(big);
+    mp_segment_report_t segs[8];
+    size_t n = memory_pool_get_segment_reports(pool, segs, 8);
+    assert(n >= 2 && n == memory_pool_get_segment_reports(pool, NULL, 0));
+    size_t committed = 0;
+    for (size_t i = 0; i < n; i++) {
+        assert(segs[i].used_bytes + segs[i].free_bytes == segs[i].committed_bytes);
+        assert(segs[i].resident_bytes <= segs[i].committed_bytes);
+        committed += segs[i].committed_bytes;
+    }
+    assert(segs[0].start == pool->pool_start);
+    assert(memory_pool_get_memory_report(pool, &r) && r.committed_bytes == committed && r.segments == n);
+    memory_pool_destroy(pool);
+    printf("[report] 通过\n");
+}
+
+typedef struct {
+    memory_pool_t* pool;
+    void* cache[8];
+    int cached;
+    int calls;
+    bool saw_hard;
+} pressure_ctx_t;
+
+// 压力回调：丢弃应用层缓存
+static void on_pressure(memory_pool_t* pool, const mp_pressure_info_t* info, void* user) {
+    pressure_ctx_t* ctx = (pressure_ctx_t*)user;
+    assert(pool == ctx->pool && info->soft_limit == MB(1) / 2 && info->requested_bytes > 0);
+    ctx->calls++;
+    if (info->hard) ctx->saw_hard = true;
+    // 回调内分配不会递归触发回调
+    void* tmp = memory_pool_alloc(pool, 1024);
+    if (tmp) memory_pool_free(pool, tmp);
+    while (ctx->cached > 0) memory_pool_free(pool, ctx->cache[--ctx->cached]);
+}
+
+static void test_memory_limits(void) {
+    printf("[limits] 开始\n");
+    pool_config_t cfg = { .pool_size = KB(256), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT,
+                          .adaptive_sizing = true, .soft_limit = KB(512), .hard_limit = MB(1) };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    pressure_ctx_t ctx = { .pool = pool };
+    assert(memory_pool_set_pressure_callback(pool, on_pressure, &ctx));
+    for (int i = 0; i < 3; i++) {
+        ctx.cache[ctx.cached] = memory_pool_alloc(pool, KB(64));
+        assert(ctx.cache[ctx.cached]);
+        ctx.cached++;
+    }
+
+    // 软上限以内正常扩展
+    void* a = memory_pool_alloc(pool, KB(200));
+    assert(a && pool->next && ctx.calls == 0);
+
+    // 将越过软上限：回调释放缓存后无需扩展
+    void* b = memory_pool_alloc(pool, KB(200));
+    assert(b && ctx.calls == 1 && ctx.cached == 0 && !ctx.saw_hard);
+    assert(pool->next && !pool->next->next);
+
+    // 将越过硬上限：快速失败，不新建子池
+    assert(memory_pool_alloc(pool, KB(600)) == NULL);
+    assert(memory_pool_get_last_error() == POOL_ERROR_OUT_OF_MEMORY);
+    assert(ctx.calls == 2 && ctx.saw_hard && !pool->next->next);
+
+    // 硬上限以内仍可扩展，但不再按自适应步长放大
+    void* c = memory_pool_alloc(pool, KB(300));
+    assert(c && ctx.calls == 3);
+    mp_usage_profile_t pr;
+    assert(memory_pool_get_usage_profile(pool, &pr));
+    assert(pr.mapped_bytes <= MB(1) && pr.segments == 3);
+    assert(pr.pressure_events == 3 && pr.hard_limit_rejections == 1);
+
+    // 余量耗尽后任何扩展都被拒绝
+    assert(memory_pool_alloc(pool, KB(256)) == NULL);
+    memory_pool_free(pool, a);
+    memory_pool_free(pool, b);
+    memory_pool_free(pool, c);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+
+    // 提示 arena 不设自己的上限，映射计入 master 的硬上限
+    pool_config_t budget_cfg = { .pool_size = KB(256), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT,
+                                 .hard_limit = MB(1) };
+    pool = memory_pool_create_with_config(&budget_cfg);
+    assert(pool);
+    void* short_objs[32];
+    int n = 0;
+    while (n < 32 && (short_objs[n] = memory_pool_alloc_ex(pool, KB(100), MP_HINT_SHORT_LIVED)) != NULL) n++;
+    assert(n > 0 && n < 32 && memory_pool_get_last_error() == POOL_ERROR_OUT_OF_MEMORY);
+    memory_pool_t* arena = pool->short_arena;
+    assert(arena && arena->config.soft_limit == 0 && arena->config.hard_limit == 0);
+    size_t mapped = 0;
+    for (memory_pool_t* p = pool; p; p = p->next) mapped += p->pool_size;
+    for (memory_pool_t* p = arena; p; p = p->next) mapped += p->pool_size;
+    assert(mapped <= MB(1));
+    // 预算已被 arena 用去：master 不能再越过硬上限，新 arena 的初始段也放不下
+    assert(memory_pool_alloc(pool, KB(600)) == NULL);
+    void* cold = memory_pool_alloc_ex(pool, 64, MP_HINT_COLD);
+    assert(cold && pool->cold_arena == NULL && memory_pool_contains(pool, cold));
+    memory_pool_free(pool, cold);
+    // arena 释放后预算随之归还
+    for (int i = 0; i < n; i++) memory_pool_free(pool, short_objs[i]);
+    memory_pool_trim(pool, MP_TRIM_IDLE_CHILDREN | MP_TRIM_FORCE);
+    void* big = memory_pool_alloc(pool, KB(400));
+    assert(big);
+    memory_pool_free(pool, big);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    printf("[limits] 通过\n");
+}
+
+// 原子替换测试数据源文件（先写临时文件再 rename，监视线程不会读到半截内容）
+static void write_text_file(const char* dir, const char* name, const char* text) {
+    char path[256], tmp[272];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "w");
+    assert(f);
+    fputs(text, f);
+    fclose(f);
+    assert(rename(tmp, path) == 0);
+}
+
+// 等待监视线程的压力事件数达到 n（最多约 2 秒）
+static bool wait_pressure_events(memory_pool_t* pool, size_t n, mp_pressure_monitor_stats_t* st) {
+    for (int i = 0; i < 400; i++) {
+        assert(memory_pool_pressure_monitor_get_stats(pool, st));
+        if (st->pressure_events >= n) return true;
+        usleep(5000);
+    }
+    return false;
+}
+
+static void test_pressure_monitor(void) {
+    printf("[psi] 开始\n");
+    char dir[] = "/tmp/mempool_psi_XXXXXX";
+    assert(mkdtemp(dir));
+    char psi[256];
+    snprintf(psi, sizeof(psi), "%s/memory.pressure", dir);
+    write_text_file(dir, "memory.pressure", "some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n"
+                                            "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n");
+    write_text_file(dir, "memory.high", "max\n");
+    write_text_file(dir, "memory.current", "1048576\n");
+
+    size_t classes[] = { 128 };
+    pool_config_t cfg = { .pool_size = KB(256), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT,
+                          .enable_size_classes = true, .size_class_sizes = classes, .num_size_classes = 1 };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    // 非线程安全池不能被后台线程修改
+    memory_pool_t* unsafe = memory_pool_create(KB(64), false);
+    assert(!memory_pool_pressure_monitor_start(unsafe, NULL));
+    memory_pool_destroy(unsafe);
+
+    // 留下空闲子池、脏的空闲页与 size-class 预留
+    void* big = memory_pool_alloc(pool, MB(1));
+    assert(big && pool->next);
+    memset(big, 0x77, MB(1));
+    memory_pool_free(pool, big);
+    void* objs[64];
+    for (int i = 0; i < 64; i++) assert((objs[i] = memory_pool_alloc_fixed(pool, 128)));
+    for (int i = 0; i < 64; i++) memory_pool_free_fixed(pool, objs[i]);
+    mp_memory_report_t r;
+    assert(memory_pool_get_memory_report(pool, &r) && r.size_class_reserve_bytes > 0);
+
+    mp_pressure_monitor_options_t opts = { .psi_path = psi, .cgroup_dir = dir, .interval_ms = 5 };
+    assert(memory_pool_pressure_monitor_start(pool, &opts));
+    assert(!memory_pool_pressure_monitor_start(pool, &opts)); // 每个池只允许一个
+    mp_pressure_monitor_stats_t st;
+    for (int i = 0; i < 400; i++) {
+        assert(memory_pool_pressure_monitor_get_stats(pool, &st));
+        if (st.polls >= 3) break;
+        usleep(5000);
+    }
+    assert(st.polls >= 3 && st.pressure_events == 0 && st.last_some_avg10 == 0.0);
+    assert(pool->next); // 无压力时不回收
+
+    // PSI 报告压力：回收空闲子池、size-class 预留与空闲页
+    write_text_file(dir, "memory.pressure", "some avg10=42.50 avg60=10.00 avg300=2.00 total=123456\n"
+                                            "full avg10=5.00 avg60=1.00 avg300=0.50 total=1234\n");
+    assert(wait_pressure_events(pool, 1, &st));
+    assert(st.bytes_released >= MB(1) && st.last_some_avg10 > 42.0);
+    assert(memory_pool_get_memory_report(pool, &r));
+    assert(r.segments == 1 && r.size_class_reserve_bytes == 0 && r.used_bytes == 0);
+    assert(memory_pool_validate(pool));
+
+    // cgroup memory.current 接近 memory.high 同样视为压力
+    write_text_file(dir, "memory.pressure", "some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n");
+    size_t before = st.pressure_events;
+    usleep(20000);
+    assert(memory_pool_pressure_monitor_get_stats(pool, &st));
+    size_t quiet = st.pressure_events;
+    assert(quiet <= before + 1); // 改写前可能又读到一次旧值
+    write_text_file(dir, "memory.high", "1000000\n");
+    write_text_file(dir, "memory.current", "950000\n");
+    assert(wait_pressure_events(pool, quiet + 1, &st));
+
+    // 监视期间分配/释放不受影响
+    for (int i = 0; i < 100; i++) {
+        void* p = memory_pool_alloc(pool, 1000 + i);
+        assert(p);
+        memory_pool_free(pool, p);
+    }
+    memory_pool_pressure_monitor_stop(pool);
+    assert(!memory_pool_pressure_monitor_get_stats(pool, &st));
+    assert(memory_pool_validate(pool));
+    // destroy 会自动停止仍在运行的监视线程
+    assert(memory_pool_pressure_monitor_start(pool, &opts));
+    memory_pool_destroy(pool);
+
+    const char* names[] = { "memory.pressure", "memory.high", "memory.current" };
+    for (size_t i = 0; i < 3; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+    printf("[psi] 通过\n");
+}
+
+static void test_streaming_copy(void) {
+    printf("[stream] 开始\n");
+    const char* k = memory_pool_streaming_kernel();
+    assert(k && (!strcmp(k, "avx512") || !strcmp(k, "avx2") || !strcmp(k, "sse2") || !strcmp(k, "generic")));
+    printf("  kernel=%s\n", k);
+    memory_pool_t* pool = memory_pool_create(MB(8), true);
+    assert(pool);
+
+    // 复用脏块：流式清零覆盖不对齐的头尾
+    size_t sizes[] = { 1, 63, 65, 4097, KB(300) + 7, MB(1) + 13 };
+    mp_copy_mode_t modes[] = { MP_COPY_CACHED, MP_COPY_STREAMING, MP_COPY_AUTO };
+    for (size_t m = 0; m < 3; m++) {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            unsigned char* d = (unsigned char*)memory_pool_alloc(pool, sizes[i]);
+            assert(d);
+            memset(d, 0xEE, sizes[i]);
+            memory_pool_free(pool, d);
+            unsigned char* z = (unsigned char*)memory_pool_calloc_ex(pool, 1, sizes[i], modes[m]);
+            assert(z == d && all_zero(z, sizes[i]));
+            memory_pool_free(pool, z);
+        }
+    }
+
+    // 流式复制：源与目标各自错位
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        unsigned char* a = (unsigned char*)memory_pool_alloc(pool, sizes[i]);
+        assert(a);
+        for (size_t j = 0; j < sizes[i]; j++) a[j] = (unsigned char)(j * 131 + i);
+        unsigned char* b = (unsigned char*)memory_pool_realloc_ex(pool, a, sizes[i] * 2 + 3, MP_COPY_STREAMING);
+        assert(b);
+        for (size_t j = 0; j < sizes[i]; j++) assert(b[j] == (unsigned char)(j * 131 + i));
+        memory_pool_free(pool, b);
+    }
+    memory_pool_destroy(pool);
+
+    // 池级阈值：AUTO 在阈值以上走流式，结果不变
+    pool_config_t cfg = { .pool_size = MB(4), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT,
+                          .streaming_threshold = KB(64) };
+    pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    unsigned char* x = (unsigned char*)memory_pool_alloc(pool, KB(200));
+    memset(x, 0x5C, KB(200));
+    unsigned char* y = (unsigned char*)memory_pool_realloc(pool, x, KB(400));
+    assert(y && y[0] == 0x5C && y[KB(200) - 1] == 0x5C);
+    memory_pool_free(pool, y);
+    unsigned char* z = (unsigned char*)memory_pool_calloc(pool, 100, KB(1));
+    assert(z && all_zero(z, KB(100)));
+    memory_pool_free(pool, z);
+    memory_pool_destroy(pool);
+    printf("[stream] 通过\n");
+}
+
+// 补充中途的压力回调把储备目标降到当前数量：补充者切出的块无处存放，须交还通用堆
+static void zero_reserve_shrink_on_pressure(memory_pool_t* pool, const mp_pressure_info_t* info, void* user) {
+    (void)info;
+    assert(memory_pool_zero_reserve(pool, *(size_t*)user, pool->zero_reserves[0].count));
+}
+
+static void test_zero_reserve(void) {
+    printf("[zero-reserve] 开始\n");
+    memory_pool_t* pool = memory_pool_create(MB(1), true);
+    assert(pool);
+    // 先把堆弄脏，补充时必须真正清零
+    void* dirty[64];
+    for (int i = 0; i < 64; i++) {
+        dirty[i] = memory_pool_alloc(pool, 200);
+        memset(dirty[i], 0xAB, 200);
+    }
+    for (int i = 0; i < 64; i++) memory_pool_free(pool, dirty[i]);
+
+    assert(memory_pool_zero_reserve(pool, 200, 16));
+    assert(memory_pool_zero_reserve_refill(pool) == 16);
+    assert(memory_pool_zero_reserve_refill(pool) == 0); // 已满
+    mp_memory_report_t r;
+    assert(memory_pool_get_memory_report(pool, &r) && r.zero_reserve_bytes >= 16 * 200);
+
+    // 命中储备：同一对齐后块大小的请求都可用
+    unsigned char* got[17];
+    for (int i = 0; i < 16; i++) {
+        got[i] = (unsigned char*)((i & 1) ? memory_pool_calloc(pool, 2, 100) : memory_pool_calloc(pool, 1, 200));
+        assert(got[i] && all_zero(got[i], 200));
+        memset(got[i], 0xCD, 200);
+    }
+    assert(pool->zero_reserve_hits == 16 && pool->zero_reserve_misses == 0);
+    got[16] = (unsigned char*)memory_pool_calloc(pool, 1, 200); // 储备耗尽：回退到分配 + 清零
+    assert(got[16] && all_zero(got[16], 200) && pool->zero_reserve_misses == 1);
+    for (int i = 0; i < 17; i++) memory_pool_free(pool, got[i]);
+    // 其他尺寸不受影响
+    void* other = memory_pool_calloc(pool, 1, 4000);
+    assert(other && all_zero(other, 4000) && pool->zero_reserve_misses == 1);
+    memory_pool_free(pool, other);
+
+    // 后台补充：低于目标一半时唤醒补满
+    assert(memory_pool_zero_reserve_start(pool));
+    assert(!memory_pool_zero_reserve_start(pool));
+    for (int i = 0; i < 400 && pool->zero_reserves[0].count < 16; i++) usleep(5000);
+    assert(pool->zero_reserves[0].count == 16);
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 12; i++) {
+            got[i] = (unsigned char*)memory_pool_calloc(pool, 1, 200);
+            assert(got[i] && all_zero(got[i], 200));
+            memset(got[i], 0xEF, 200);
+        }
+        for (int i = 0; i < 12; i++) memory_pool_free(pool, got[i]);
+        // 补充线程可能在本轮出栈中途就已补满，其后的出栈未跌破一半目标则不会再次唤醒：
+        // 只保证储备不停留在低水位以下
+        for (int i = 0; i < 400 && pool->zero_reserves[0].count < 16; i++) usleep(5000);
+        assert(pool->zero_reserves[0].count * 2 >= 16);
+    }
+    memory_pool_zero_reserve_stop(pool);
+
+    // 压力回收时连同 size-class 预留一起归还
+    memory_pool_trim(pool, MP_TRIM_SIZE_CLASSES);
+    assert(memory_pool_get_memory_report(pool, &r) && r.zero_reserve_bytes == 0 && r.used_bytes == 0);
+    assert(memory_pool_validate(pool));
+    assert(memory_pool_zero_reserve_refill(pool) == 16);
+    assert(memory_pool_zero_reserve(pool, 200, 4));   // 降低目标：多余的块立即归还
+    assert(pool->zero_reserves[0].count == 4);
+    assert(memory_pool_zero_reserve(pool, 200, 0));   // 删除
+    assert(pool->num_zero_reserves == 0 && pool->used_size == 0);
+    assert(memory_pool_validate(pool));
+
+    // destroy 自动停止补充线程
+    assert(memory_pool_zero_reserve(pool, 64, 8) && memory_pool_zero_reserve_start(pool));
+    memory_pool_destroy(pool);
+
+    // 补充的块未能放入储备时走内部释放：追踪中不出现调用方从未分配过的 FREE
+    pool_config_t cfg = { .pool_size = MB(1), .alignment = 16, .thread_safe = true, .soft_limit = MB(1) };
+    pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    size_t big = KB(200);
+    assert(memory_pool_set_pressure_callback(pool, zero_reserve_shrink_on_pressure, &big));
+    char path[] = "/tmp/mempool_zr_trace_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    assert(memory_pool_trace_start(pool, path));
+    assert(memory_pool_zero_reserve(pool, big, 8));
+    size_t filled = memory_pool_zero_reserve_refill(pool);
+    assert(filled > 0 && filled < 8 && pool->zero_reserves[0].count == filled);
+    assert(pool->zero_reserves[0].target == filled && pool->profile.pressure_events > 0);
+    assert(memory_pool_trace_stop(pool));
+    FILE* in = fopen(path, "rb");
+    assert(in);
+    mp_trace_header_t th;
+    mp_trace_record_t rec;
+    assert(fread(&th, sizeof(th), 1, in) == 1);
+    assert(fread(&rec, sizeof(rec), 1, in) == 0); // 补充与储备调整都不产生追踪记录
+    fclose(in);
+    unlink(path);
+    assert(memory_pool_zero_reserve(pool, big, 0) && pool->used_size == 0);
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+
+    // 重置与后台补充竞争：补充线程在锁外清零大块时重置重建堆，
+    // 在途的块只能被丢弃，不能再压入储备（否则与空闲堆重叠）
+    pool = memory_pool_create(MB(96), true);
+    assert(pool);
+    assert(memory_pool_zero_reserve(pool, MB(32), 2));
+    assert(memory_pool_zero_reserve_start(pool));
+    for (int round = 0; round < 12; round++) {
+        unsigned char* c = (unsigned char*)memory_pool_calloc(pool, 1, MB(32));
+        assert(c && all_zero(c, MB(32)));
+        memset(c, 0x3C, MB(32)); // 弄脏，之后的补充必须真正清零
+        memory_pool_free(pool, c);
+        // 持续重置：补充线程清零期间必然被抢占
+        for (int i = 0; i < 200; i++) {
+            memory_pool_reset(pool);
+            assert(memory_pool_validate(pool));
+            // 储备中的块必须都处于已分配状态（先读数量：补充线程只会让已分配字节数先于数量增长）
+            size_t reserved = (size_t)__atomic_load_n(&pool->zero_reserves[0].count, __ATOMIC_ACQUIRE) * pool->zero_reserves[0].block_size;
+            size_t used = 0;
+            for (memory_pool_t* p = pool; p; p = p->next) used += __atomic_load_n(&p->used_size, __ATOMIC_ACQUIRE);
+            assert(used >= reserved);
+            assert(memory_pool_zero_reserve(pool, MB(32), 2)); // 唤醒补充线程
+        }
+    }
+    memory_pool_zero_reserve_stop(pool);
+    assert(memory_pool_validate(pool));
+    // 此时仅储备块处于已分配状态
+    size_t live = 0;
+    for (memory_pool_t* p = pool; p; p = p->next) live += p->used_size;
+    assert(live == (size_t)pool->zero_reserves[0].count * pool->zero_reserves[0].block_size);
+    assert(memory_pool_zero_reserve(pool, MB(32), 0));
+    live = 0;
+    for (memory_pool_t* p = pool; p; p = p->next) live += p->used_size;
+    assert(live == 0);
+    memory_pool_destroy(pool);
+    printf("[zero-reserve] 通过\n");
+}
+
+static void test_cold_placement(void) {
+    printf("[cold] 开始\n");
+    pool_config_t cfg = {
+        .pool_size = MB(1),
+        .alignment = 16,
+        .thread_safe = true,
+        .enable_size_classes = true,
+        .huge_pages = MP_HUGE_PAGES_TRANSPARENT,
+    };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool && pool->cold_arena == NULL); // 懒创建
+
+    void* hot[8];
+    unsigned char* cold[8];
+    for (int i = 0; i < 8; i++) {
+        hot[i] = memory_pool_alloc_ex(pool, 128, MP_HINT_NONE);
+        cold[i] = (unsigned char*)memory_pool_alloc_ex(pool, 128, MP_HINT_COLD);
+        assert(hot[i] && cold[i]);
+        memset(cold[i], i, 128);
+    }
+    memory_pool_t* arena = pool->cold_arena;
+    assert(arena && arena->config.cold && (arena->seg_flags & MP_SEG_COLD));
+    assert(!(arena->seg_flags & (MP_SEG_THP | MP_SEG_HUGETLB))); // 冷段不使用大页
+    assert(!(pool->seg_flags & MP_SEG_COLD));
+    // 冷对象与热对象不共享页面：冷指针落在冷 arena 的段内，不在 master 链的段中
+    mp_segment_report_t segs[8];
+    size_t nseg = memory_pool_get_segment_reports(arena, segs, 8);
+    assert(nseg >= 1 && nseg <= 8);
+    for (int i = 0; i < 8; i++) {
+        assert(memory_pool_contains(pool, cold[i]) && memory_pool_contains(arena, cold[i]));
+        assert(!memory_pool_contains(arena, hot[i]));
+        bool in_cold_seg = false;
+        for (size_t s = 0; s < nseg; s++) {
+            char* lo = (char*)segs[s].start;
+            if ((char*)cold[i] >= lo && (char*)cold[i] < lo + segs[s].committed_bytes) {
+                in_cold_seg = (segs[s].seg_flags & MP_SEG_COLD) != 0;
+            }
+        }
+        assert(in_cold_seg);
+    }
+
+    // 冷对象扩容后仍在冷段
+    cold[0] = (unsigned char*)memory_pool_realloc(pool, cold[0], 4096);
+    assert(cold[0] && memory_pool_contains(arena, cold[0]) && cold[0][127] == 0);
+
+    // 回收提示只作用于冷段，内容保留
+    memory_pool_trim(pool, MP_TRIM_COLD);
+    memory_pool_trim(pool, MP_TRIM_PAGEOUT);
+    for (int i = 1; i < 8; i++) assert(cold[i][0] == i && cold[i][127] == i);
+    assert(memory_pool_validate(pool));
+
+    // 通过 master 释放
+    for (int i = 0; i < 8; i++) {
+        memory_pool_free(pool, hot[i]);
+        memory_pool_free(pool, cold[i]);
+    }
+    assert(arena->used_size == 0 && memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+
+    // 本身就是冷数据池：冷提示直接在池内分配，不再另建冷 arena
+    cfg.cold = true;
+    pool = memory_pool_create_with_config(&cfg);
+    assert(pool && (pool->seg_flags & MP_SEG_COLD));
+    void* c = memory_pool_alloc_ex(pool, 128, MP_HINT_COLD);
+    assert(c && pool->cold_arena == NULL && memory_pool_contains(pool, c));
+    memory_pool_free(pool, c);
+    memory_pool_destroy(pool);
+    printf("[cold] 通过\n");
+}
+
+static void test_lifetime_placement(void) {
+    printf("[lifetime] 开始\n");
+    enum { N = 2000 };
+    static void* lng[N];
+    static void* shrt[N];
+    size_t chain[2];
+    // 同样的交错分配序列：无提示时长寿对象钉住短命对象的段；按寿命分开后短命段整体变空
+    for (int hinted = 0; hinted < 2; hinted++) {
+        memory_pool_t* pool = memory_pool_create(KB(64), true);
+        assert(pool);
+        for (int i = 0; i < N; i++) {
+            lng[i] = memory_pool_alloc_ex(pool, 64, hinted ? MP_HINT_LONG_LIVED : MP_HINT_NONE);
+            shrt[i] = memory_pool_alloc_ex(pool, 512, hinted ? MP_HINT_SHORT_LIVED : MP_HINT_NONE);
+            assert(lng[i] && shrt[i]);
+            memset(lng[i], i & 0xFF, 64);
+        }
+        for (int i = 0; i < N; i++) memory_pool_free(pool, shrt[i]);
+        memory_pool_trim(pool, MP_TRIM_IDLE_CHILDREN | MP_TRIM_FORCE);
+        chain[hinted] = memory_pool_get_segment_reports(pool, NULL, 0);
+        if (hinted) {
+            memory_pool_t* arena = pool->short_arena;
+            assert(arena && arena->arena_hint == MP_HINT_SHORT_LIVED);
+            assert(arena->used_size == 0 && arena->next == NULL); // 空子段已全部交还
+            assert(!memory_pool_contains(arena, lng[0]));
+        } else {
+            assert(pool->short_arena == NULL);
+        }
+        for (int i = 0; i < N; i++) {
+            assert(((unsigned char*)lng[i])[63] == (i & 0xFF));
+            memory_pool_free(pool, lng[i]);
+        }
+        assert(memory_pool_validate(pool));
+        memory_pool_destroy(pool);
+    }
+    assert(chain[1] < chain[0]);
+
+    // 请求作用域：请求结束时整体释放，长寿对象不受影响
+    memory_pool_t* pool = memory_pool_create(KB(64), true);
+    assert(pool);
+    unsigned char* keep = (unsigned char*)memory_pool_alloc(pool, 256);
+    memset(keep, 0x5A, 256);
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 200; i++) {
+            void* r = memory_pool_alloc_ex(pool, 128 + (size_t)i, MP_HINT_REQUEST);
+            assert(r && memory_pool_contains(pool, r));
+        }
+        assert(pool->request_arena && pool->request_arena->used_size > 0);
+        memory_pool_reset_requests(pool);
+        assert(pool->request_arena->used_size == 0);
+    }
+    assert(keep[0] == 0x5A && keep[255] == 0x5A && pool->used_size > 0);
+    assert(memory_pool_validate(pool));
+    memory_pool_free(pool, keep);
+    memory_pool_destroy(pool);
+    printf("[lifetime] 通过\n");
+}
+
+static void test_pool_stats(void) {
+    printf("[stats] 开始\n");
+    size_t classes[] = { 32, 64 };
+    pool_config_t cfg = {
+        .pool_size = KB(64),
+        .alignment = 16,
+        .thread_safe = true,
+        .enable_size_classes = true,
+        .size_class_sizes = classes,
+        .num_size_classes = 2,
+    };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    mp_pool_stats_t st;
+    assert(memory_pool_get_stats(pool, &st));
+    assert(st.version == MP_STATS_VERSION && st.struct_size == sizeof(st));
+    assert(st.allocations == 0 && st.frees == 0 && st.chain_length == 1 && st.free_blocks == 1);
+    assert(st.num_classes == 2 && st.classes[0].size == 32 && st.classes[1].size == 64);
+
+    // 通用堆：交错释放留下多个空闲块，超出首段后创建子池
+    void* p[64];
+    for (int i = 0; i < 64; i++) p[i] = memory_pool_alloc(pool, 2000);
+    for (int i = 0; i < 64; i += 2) memory_pool_free(pool, p[i]);
+    assert(memory_pool_get_stats(pool, &st));
+    assert(st.allocations == 64 && st.frees == 32);
+    assert(st.chain_length > 1 && st.child_pools_created == st.chain_length - 1);
+    assert(st.free_blocks >= 32 && st.rb_tree_depth >= 2);
+    assert(st.bytes_in_use > 32 * 2000 && st.peak_bytes >= st.bytes_in_use);
+
+    // 固定类：首次未命中，释放后再分配命中；超出所有类则回退到通用堆
+    void* a = memory_pool_alloc_fixed(pool, 24);
+    memory_pool_free_fixed(pool, a);
+    a = memory_pool_alloc_fixed(pool, 24);
+    void* big = memory_pool_alloc_fixed(pool, 500);
+    assert(a && big);
+    assert(memory_pool_get_stats(pool, &st));
+    assert(st.classes[0].misses == 1 && st.classes[0].hits == 1 && st.classes[0].used_count == 1);
+    assert(st.classes[1].hits == 0 && st.class_fallbacks == 1);
+    memory_pool_free_fixed(pool, a);
+    memory_pool_free(pool, big);
+    for (int i = 1; i < 64; i += 2) memory_pool_free(pool, p[i]);
+
+    // 附属 arena 的计数一并汇总
+    void* c = memory_pool_alloc_ex(pool, 100, MP_HINT_COLD);
+    assert(memory_pool_get_stats(pool, &st));
+    assert(st.arenas == 1 && st.allocations >= 64 + 3);
+    memory_pool_free(pool, c);
+
+    // 旧版本调用方：只写出其结构前缀
+    mp_pool_stats_t old;
+    memset(&old, 0xEE, sizeof(old));
+    size_t prefix = offsetof(mp_pool_stats_t, bytes_in_use);
+    assert(memory_pool_get_stats_sized(pool, &old, prefix));
+    assert(old.struct_size == prefix && old.frees == st.frees + 1);
+    assert(((unsigned char*)&old)[prefix] == 0xEE);
+    assert(!memory_pool_get_stats_sized(pool, &old, 4));
+    memory_pool_destroy(pool);
+    printf("[stats] 通过\n");
+}
+
+static void test_latency_histograms(void) {
+    printf("[latency] 开始\n");
+    size_t classes[] = { 48 };
+    pool_config_t cfg = {
+        .pool_size = KB(256),
+        .alignment = 16,
+        .thread_safe = true,
+        .enable_size_classes = true,
+        .size_class_sizes = classes,
+        .num_size_classes = 1,
+        .record_latency = true,
+    };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    mp_latency_histogram_t h[MP_OP_COUNT];
+#if MEMPOOL_LATENCY
+    void* p[100];
+    for (int i = 0; i < 100; i++) p[i] = memory_pool_alloc(pool, 64 + (size_t)i);
+    for (int i = 0; i < 100; i += 2) p[i] = memory_pool_realloc(pool, p[i], 4096); // 内部的 alloc/free 不重复计数
+    void* al = memory_pool_alloc_aligned(pool, 100, 256);
+    void* fx = memory_pool_alloc_fixed(pool, 40);
+    for (int i = 0; i < 100; i++) memory_pool_free(pool, p[i]);
+    memory_pool_defragment(pool);
+
+    assert(memory_pool_latency_snapshot(pool, h, false));
+    assert(h[MP_OP_ALLOC].count == 100 && h[MP_OP_REALLOC].count == 50 && h[MP_OP_FREE].count == 100);
+    assert(h[MP_OP_ALLOC_ALIGNED].count == 1 && h[MP_OP_ALLOC_FIXED].count == 1 && h[MP_OP_DEFRAGMENT].count == 1);
+    for (int op = 0; op < MP_OP_COUNT; op++) {
+        uint64_t n = 0;
+        for (int b = 0; b < MP_LATENCY_BUCKETS; b++) n += h[op].buckets[b];
+        assert(n == h[op].count && h[op].min_ns <= h[op].max_ns && h[op].total_ns >= h[op].max_ns);
+    }
+    uint64_t p50 = memory_pool_latency_percentile(&h[MP_OP_ALLOC], 0.5);
+    uint64_t p99 = memory_pool_latency_percentile(&h[MP_OP_ALLOC], 0.99);
+    assert(p50 >= h[MP_OP_ALLOC].min_ns && p50 <= p99 && p99 <= h[MP_OP_ALLOC].max_ns);
+
+    // 快照并清零；关闭后不再记录
+    assert(memory_pool_latency_snapshot(pool, h, true));
+    assert(memory_pool_latency_snapshot(pool, h, false) && h[MP_OP_ALLOC].count == 0);
+    assert(memory_pool_latency_enable(pool, false));
+    memory_pool_free(pool, memory_pool_alloc(pool, 32));
+    assert(memory_pool_latency_snapshot(pool, h, false) && h[MP_OP_ALLOC].count == 0);
+    assert(memory_pool_latency_enable(pool, true));
+    memory_pool_free(pool, memory_pool_alloc(pool, 32));
+    assert(memory_pool_latency_snapshot(pool, h, false) && h[MP_OP_ALLOC].count == 1 && h[MP_OP_FREE].count == 1);
+    memory_pool_free(pool, al);
+    memory_pool_free_fixed(pool, fx);
+#else
+    assert(!memory_pool_latency_enable(pool, true));
+    assert(memory_pool_latency_snapshot(pool, h, false) && h[MP_OP_ALLOC].count == 0);
+#endif
+    memory_pool_destroy(pool);
+    printf("[latency] 通过\n");
+}
+
+typedef struct {
+    memory_pool_t* pool;
+    int iters;
+} trace_worker_arg_t;
+
+static void* trace_worker(void* argp) {
+    trace_worker_arg_t* arg = (trace_worker_arg_t*)argp;
+    for (int i = 0; i < arg->iters; i++) memory_pool_free(arg->pool, memory_pool_alloc(arg->pool, 64 + (size_t)i));
+    return NULL;
+}
+
+static void test_trace_record(void) {
+    printf("[trace] 开始\n");
+    char path[] = "/tmp/mempool_trace_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    size_t classes[] = { 48 };
+    pool_config_t cfg = {
+        .pool_size = KB(256),
+        .alignment = 16,
+        .thread_safe = true,
+        .enable_size_classes = true,
+        .size_class_sizes = classes,
+        .num_size_classes = 1,
+    };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    void* before = memory_pool_alloc(pool, 100); // 记录开始前的对象：释放时 arg 为 0
+
+    assert(memory_pool_trace_start(pool, path));
+    assert(!memory_pool_trace_start(pool, path)); // 已在记录
+    void* a = memory_pool_alloc(pool, 100);
+    void* b = memory_pool_alloc_ex(pool, 200, MP_HINT_LONG_LIVED); // 内部转调 alloc，只记一条
+    void* r = memory_pool_alloc_ex(pool, 300, MP_HINT_REQUEST);
+    void* c = memory_pool_calloc(pool, 10, 30);
+    a = memory_pool_realloc(pool, a, 5000); // 内部的 alloc/free 不单独记录
+    void* al = memory_pool_alloc_aligned(pool, 100, 256);
+    void* fx = memory_pool_alloc_fixed(pool, 40);
+    memory_pool_free_fixed(pool, fx);
+    memory_pool_free(pool, before);
+    memory_pool_reset_requests(pool);
+    memory_pool_defragment(pool);
+    (void)r;
+    pthread_t th[2];
+    trace_worker_arg_t wa = { pool, 50 };
+    for (int i = 0; i < 2; i++) assert(pthread_create(&th[i], NULL, trace_worker, &wa) == 0);
+    for (int i = 0; i < 2; i++) pthread_join(th[i], NULL);
+    assert(memory_pool_trace_stop(pool));
+    memory_pool_free(pool, memory_pool_alloc(pool, 32)); // 停止后不再记录
+
+    FILE* in = fopen(path, "rb");
+    assert(in);
+    mp_trace_header_t h;
+    assert(fread(&h, sizeof(h), 1, in) == 1);
+    assert(strcmp(h.magic, MP_TRACE_MAGIC) == 0 && h.version == MP_TRACE_VERSION);
+    assert(h.record_size == sizeof(mp_trace_record_t) && h.pool_size == KB(256) && (h.flags & MP_TRACE_F_THREAD_SAFE));
+    mp_trace_record_t rec[256];
+    size_t n = fread(rec, sizeof(rec[0]), 256, in);
+    fclose(in);
+    unlink(path);
+    assert(n == 11 + 2 * 50 * 2);
+
+    assert(rec[0].op == MP_TRACE_ALLOC && rec[0].size == 100 && rec[0].id == 1 && rec[0].arg == 0);
+    assert(rec[1].op == MP_TRACE_ALLOC_EX && rec[1].hints == MP_HINT_LONG_LIVED && rec[1].id == 2);
+    assert(rec[2].op == MP_TRACE_ALLOC_EX && rec[2].hints == MP_HINT_REQUEST && rec[2].id == 3);
+    assert(rec[3].op == MP_TRACE_CALLOC && rec[3].size == 300 && rec[3].id == 4);
+    assert(rec[4].op == MP_TRACE_REALLOC && rec[4].size == 5000 && rec[4].arg == 1 && rec[4].id == 5);
+    assert(rec[5].op == MP_TRACE_ALLOC_ALIGNED && rec[5].align_log2 == 8 && rec[5].id == 6);
+    assert(rec[6].op == MP_TRACE_ALLOC_FIXED && rec[6].size == 40 && rec[6].id == 7);
+    assert(rec[7].op == MP_TRACE_FREE_FIXED && rec[7].arg == 7);
+    assert(rec[8].op == MP_TRACE_FREE && rec[8].arg == 0);
+    assert(rec[9].op == MP_TRACE_RESET_REQUESTS && rec[10].op == MP_TRACE_DEFRAGMENT);
+    uint32_t main_thread = rec[0].thread;
+    uint32_t seen[2] = { 0, 0 };
+    for (size_t i = 1; i < n; i++) assert(rec[i].time_ns >= rec[i - 1].time_ns);
+    // 两个线程的调用交错，但串行化保证地址复用不会与释放记录交错：
+    // 每条 FREE 释放的都是同一线程此前分配、尚未释放的对象
+    uint32_t live[2] = { 0, 0 };
+    for (size_t i = 11; i < n; i++) {
+        assert(rec[i].thread != main_thread);
+        int t = (!seen[0] || seen[0] == rec[i].thread) ? 0 : 1;
+        if (!seen[t]) seen[t] = rec[i].thread;
+        assert(seen[t] == rec[i].thread);
+        if (rec[i].op == MP_TRACE_ALLOC) {
+            assert(rec[i].id != 0 && live[t] == 0);
+            live[t] = rec[i].id;
+        } else {
+            assert(rec[i].op == MP_TRACE_FREE && rec[i].arg == live[t] && live[t] != 0);
+            live[t] = 0;
+        }
+    }
+    assert(seen[0] && seen[1] && seen[0] != seen[1] && !live[0] && !live[1]);
+
+    memory_pool_free(pool, a);
+    memory_pool_free(pool, b);
+    memory_pool_free(pool, c);
+    memory_pool_free(pool, al);
+    assert(!memory_pool_trace_start(pool, "/nonexistent-dir/trace.bin") && memory_pool_get_last_error() == POOL_ERROR_IO);
+    memory_pool_destroy(pool);
+    printf("[trace] 通过\n");
+}
+
+typedef struct {
+    memory_pool_t* pool;
+    void* victim;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool freed;
+    int calls;
+} trace_pressure_ctx_t;
+
+static void* trace_pressure_freer(void* argp) {
+    trace_pressure_ctx_t* ctx = (trace_pressure_ctx_t*)argp;
+    memory_pool_free(ctx->pool, ctx->victim);
+    pthread_mutex_lock(&ctx->lock);
+    ctx->freed = true;
+    pthread_cond_signal(&ctx->cond);
+    pthread_mutex_unlock(&ctx->lock);
+    return NULL;
+}
+
+// 压力回调把释放交给另一个线程并等待它完成：该线程的释放同样要被记录
+static void trace_pressure_cb(memory_pool_t* pool, const mp_pressure_info_t* info, void* user) {
+    (void)pool;
+    (void)info;
+    trace_pressure_ctx_t* ctx = (trace_pressure_ctx_t*)user;
+    ctx->calls++;
+    pthread_t th;
+    assert(pthread_create(&th, NULL, trace_pressure_freer, ctx) == 0);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 5;
+    pthread_mutex_lock(&ctx->lock);
+    while (!ctx->freed && pthread_cond_timedwait(&ctx->cond, &ctx->lock, &deadline) == 0) {}
+    bool freed = ctx->freed;
+    pthread_mutex_unlock(&ctx->lock);
+    assert(freed); // 回调期间仍持有 trace 锁时会在此超时
+    pthread_join(th, NULL);
+}
+
+static void test_trace_pressure(void) {
+    printf("[trace-pressure] 开始\n");
+    char path[] = "/tmp/mempool_trace_cb_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    pool_config_t cfg = { .pool_size = KB(256), .alignment = 16, .thread_safe = true, .soft_limit = KB(256) };
+    memory_pool_t* pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    trace_pressure_ctx_t ctx = { .pool = pool, .freed = false, .calls = 0 };
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.cond, NULL);
+    assert(memory_pool_set_pressure_callback(pool, trace_pressure_cb, &ctx));
+
+    assert(memory_pool_trace_start(pool, path));
+    ctx.victim = memory_pool_alloc(pool, KB(150));
+    assert(ctx.victim);
+    void* big = memory_pool_alloc(pool, KB(150)); // 将越过软上限：回调中由另一线程释放 victim
+    assert(big && ctx.calls == 1 && ctx.freed);
+    memory_pool_free(pool, big);
+    assert(memory_pool_trace_stop(pool));
+
+    FILE* in = fopen(path, "rb");
+    assert(in);
+    mp_trace_header_t h;
+    assert(fread(&h, sizeof(h), 1, in) == 1);
+    mp_trace_record_t rec[8];
+    size_t n = fread(rec, sizeof(rec[0]), 8, in);
+    fclose(in);
+    unlink(path);
+    // 回调中的释放先于挂起的分配完成；挂起的分配按恢复时刻记录，文件仍按时间有序
+    assert(n == 4);
+    assert(rec[0].op == MP_TRACE_ALLOC && rec[0].id == 1);
+    assert(rec[1].op == MP_TRACE_FREE && rec[1].arg == 1 && rec[1].thread != rec[0].thread);
+    assert(rec[2].op == MP_TRACE_ALLOC && rec[2].id == 2 && rec[2].thread == rec[0].thread);
+    assert(rec[3].op == MP_TRACE_FREE && rec[3].arg == 2);
+    for (size_t i = 1; i < n; i++) assert(rec[i].time_ns >= rec[i - 1].time_ns);
+
+    assert(memory_pool_validate(pool));
+    memory_pool_destroy(pool);
+    pthread_cond_destroy(&ctx.cond);
+    pthread_mutex_destroy(&ctx.lock);
+    printf("[trace-pressure] 通过\n");
+}
+
+typedef struct {
+    memory_pool_t* segment;
+    char* last_end;
+    size_t segment_bytes;
+    size_t segments;
+    size_t counts[3];
+    size_t in_use[3];
+    size_t stop_after;
+    size_t seen;
+    memory_pool_t* arena;
+    size_t arena_blocks;
+} walk_ctx_t;
+
+static bool walk_check(const mp_block_info_t* info, void* arg) {
+    walk_ctx_t* w = arg;
+    if (info->segment != w->segment) {
+        // 上一段的块必须恰好铺满该段
+        assert(!w->segment || w->segment_bytes == w->segment->pool_size);
+        w->segment = info->segment;
+        w->last_end = NULL;
+        w->segment_bytes = 0;
+        w->segments++;
+        assert(info->block == info->segment->pool_start);
+    }
+    assert(!w->last_end || (char*)info->block == w->last_end); // 段内按地址连续
+    assert((char*)info->user == (char*)info->block + sizeof(memory_block_t));
+    w->last_end = (char*)info->block + info->size;
+    w->segment_bytes += info->size;
+    w->counts[info->state]++;
+    if (info->in_use) w->in_use[info->state]++;
+    if (w->arena && info->segment == w->arena && info->state == MP_BLOCK_ALLOCATED) w->arena_blocks++;
+    return ++w->seen != w->stop_after;
+}
+
+static void test_pool_walk(void) {
+    printf("[walk] 开始\n");
+    memory_pool_t* pool = memory_pool_create(KB(256), true);
+    assert(pool);
+    walk_ctx_t w = {0};
+    assert(memory_pool_walk(pool, walk_check, &w) == 1);
+    assert(w.counts[MP_BLOCK_FREE] == 1 && w.segment_bytes == pool->pool_size);
+    assert(memory_pool_walk(NULL, walk_check, &w) == 0 && memory_pool_get_last_error() == POOL_ERROR_NULL_POINTER);
+
+    // 交错释放：已分配与空闲块交替出现
+    void* ptrs[16];
+    for (int i = 0; i < 16; i++) {
+        ptrs[i] = memory_pool_alloc(pool, KB(4));
+        assert(ptrs[i]);
+    }
+    for (int i = 0; i < 16; i += 2) memory_pool_free(pool, ptrs[i]);
+    assert(memory_pool_add_size_class(pool, 64, 8) >= 0);
+    void* small = memory_pool_alloc_fixed(pool, 64);
+    assert(small);
+    // 超出首段容量，扩展出子池
+    void* big = memory_pool_alloc(pool, KB(512));
+    assert(big);
+    // 附属 arena 的块同样被报告
+    void* cold = memory_pool_alloc_ex(pool, 256, MP_HINT_COLD);
+    assert(cold && pool->cold_arena);
+
+    memset(&w, 0, sizeof(w));
+    w.arena = pool->cold_arena;
+    size_t total = memory_pool_walk(pool, walk_check, &w);
+    assert(memory_pool_get_last_error() == POOL_OK);
+    assert(total == w.seen && w.segment_bytes == w.segment->pool_size);
+    assert(w.segments == memory_pool_get_segment_reports(pool, NULL, 0) + 1);
+    assert(w.in_use[MP_BLOCK_FREE] == 0 && w.counts[MP_BLOCK_FREE] >= 8);
+    assert(w.counts[MP_BLOCK_ALLOCATED] == 8 + 1 + 1); // 8 个 4K 块、big、cold
+    assert(w.counts[MP_BLOCK_SIZE_CLASS] == 8 && w.in_use[MP_BLOCK_SIZE_CLASS] == 1);
+    assert(w.arena_blocks == 1);
+
+    // 回调返回 false 提前停止
+    memset(&w, 0, sizeof(w));
+    w.stop_after = 3;
+    assert(memory_pool_walk(pool, walk_check, &w) == 3);
+
+    for (int i = 1; i < 16; i += 2) memory_pool_free(pool, ptrs[i]);
+    memory_pool_free_fixed(pool, small);
+    memory_pool_free(pool, big);
+    memory_pool_free(pool, cold);
+    memory_pool_destroy(pool);
+
+    // 大量缓存块：每次遍历只建一次缓存块集合，交出与缓存的块逐一区分
+    enum { CACHED_N = 4000 };
+    pool = memory_pool_create(MB(2), true);
+    assert(pool);
+    assert(memory_pool_add_size_class(pool, 32, CACHED_N) >= 0);
+    void** held = malloc(sizeof(*held) * CACHED_N);
+    assert(held);
+    for (int i = 0; i < CACHED_N; i++) assert((held[i] = memory_pool_alloc_fixed(pool, 32)) != NULL);
+    for (int i = 0; i < CACHED_N; i += 2) memory_pool_free_fixed(pool, held[i]);
+    memset(&w, 0, sizeof(w));
+    memory_pool_walk(pool, walk_check, &w);
+    assert(memory_pool_get_last_error() == POOL_OK);
+    assert(w.counts[MP_BLOCK_SIZE_CLASS] == CACHED_N && w.in_use[MP_BLOCK_SIZE_CLASS] == CACHED_N / 2);
+    for (int i = 1; i < CACHED_N; i += 2) memory_pool_free_fixed(pool, held[i]);
+    free(held);
+    memory_pool_destroy(pool);
+
+    // 紧凑 slab 整体作为一个 size-class 块报告
+    pool_config_t cfg = { .pool_size = KB(256), .thread_safe = true, .alignment = DEFAULT_ALIGNMENT,
+                          .packed_size_classes = true };
+    pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    assert(memory_pool_add_size_class(pool, 48, 64) >= 0);
+    memset(&w, 0, sizeof(w));
+    memory_pool_walk(pool, walk_check, &w);
+    assert(w.counts[MP_BLOCK_SIZE_CLASS] == 1 && w.in_use[MP_BLOCK_SIZE_CLASS] == 0);
+    void* obj = memory_pool_alloc_fixed(pool, 48);
+    assert(obj);
+    memset(&w, 0, sizeof(w));
+    memory_pool_walk(pool, walk_check, &w);
+    assert(w.counts[MP_BLOCK_SIZE_CLASS] == 1 && w.in_use[MP_BLOCK_SIZE_CLASS] == 1);
+    assert(w.counts[MP_BLOCK_ALLOCATED] == 0);
+    memory_pool_free_fixed(pool, obj);
+    memory_pool_destroy(pool);
+    printf("[walk] 通过\n");
+}
+
 typedef struct {
     memory_pool_t* pool;
     int id;
@@ -245,6 +2092,56 @@ static void test_warmup_and_aligned_errors(void) {
     // non power-of-two alignment should fail
     void* x = memory_pool_alloc_aligned(pool, 64, 24);
     assert(x == NULL && memory_pool_get_last_error() == POOL_ERROR_INVALID_SIZE);
+    // 对齐前缀被切出为空闲块后，对齐块必须保留 prev_size，否则释放时向前合并会越界
+    void* keep[2048];
+    int nkeep = 0;
+    for (int i = 0; i < 6000; i++) {
+        size_t align = (size_t)64 << (i % 7);
+        void* a = memory_pool_alloc_aligned(pool, 100 + (size_t)(i * 7919) % 7900, align);
+        assert(a && ((uintptr_t)a & (align - 1)) == 0);
+        if (i % 3 == 0) keep[nkeep++] = a;
+        else memory_pool_free(pool, a);
+    }
+    assert(memory_pool_validate(pool));
+    for (int i = 0; i < nkeep; i++) memory_pool_free(pool, keep[i]);
+    memory_pool_destroy(pool);
+
+    // 固定类、对齐与通用块交错：对齐前缀必须能成块，空闲块 / 固定类块的链接不能被后继 prev_size 覆盖
+    size_t classes[] = { 64 };
+    pool_config_t cfg = {
+        .pool_size = KB(256),
+        .alignment = 16,
+        .thread_safe = true,
+        .enable_size_classes = true,
+        .size_class_sizes = classes,
+        .num_size_classes = 1,
+        .adaptive_sizing = true,
+    };
+    pool = memory_pool_create_with_config(&cfg);
+    assert(pool);
+    void* slots[128] = { 0 };
+    unsigned seed = 1;
+    for (int i = 0; i < 3000; i++) {
+        int k = rand_r(&seed) % 128;
+        if (slots[k]) {
+            if (k % 4 == 0) memory_pool_free_fixed(pool, slots[k]);
+            else memory_pool_free(pool, slots[k]);
+        }
+        size_t n = 16 + (size_t)(rand_r(&seed) % 4000);
+        switch (k % 4) {
+            case 0: slots[k] = memory_pool_alloc_fixed(pool, 60); break;
+            case 1: slots[k] = memory_pool_alloc_aligned(pool, n, 64); break;
+            case 2: slots[k] = memory_pool_realloc(pool, memory_pool_alloc(pool, n / 2), n * 2); break;
+            default: slots[k] = memory_pool_alloc(pool, n); break;
+        }
+        assert(slots[k]);
+    }
+    assert(memory_pool_validate(pool));
+    for (int k = 0; k < 128; k++) {
+        if (!slots[k]) continue;
+        if (k % 4 == 0) memory_pool_free_fixed(pool, slots[k]);
+        else memory_pool_free(pool, slots[k]);
+    }
     assert(memory_pool_validate(pool));
     memory_pool_destroy(pool);
     printf("[misc] 通过\n");
@@ -258,6 +2155,31 @@ int main(void) {
     test_fixed_edges();
     test_fragmentation_defrag();
     test_chain_growth();
+    test_release_idle_children();
+    test_huge_pages();
+    test_reserve_commit();
+    test_warmup_options();
+    test_calloc_zero_tracking();
+    test_persistent_pool();
+    test_shared_pool();
+    test_locked_pool();
+    test_segment_cache();
+    test_packed_size_classes();
+    test_usage_profile();
+    test_memfd_growth();
+    test_numa();
+    test_memory_report();
+    test_memory_limits();
+    test_pressure_monitor();
+    test_streaming_copy();
+    test_zero_reserve();
+    test_cold_placement();
+    test_lifetime_placement();
+    test_pool_stats();
+    test_latency_histograms();
+    test_trace_record();
+    test_trace_pressure();
+    test_pool_walk();
     test_multithread();
     test_warmup_and_aligned_errors();
     printf("全部通过\n");
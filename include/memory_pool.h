@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <pthread.h>
 // 调试开关：编译时传入 -DMEMPOOL_DEBUG=1 启用
 #if defined(MEMPOOL_DEBUG) && (MEMPOOL_DEBUG)
@@ -25,19 +26,27 @@
     #define MP_ASSERT(cond, msg) do { } while (0)
 #endif
 
+// 延迟直方图：默认编译进库、运行时开启；编译时传入 -DMEMPOOL_LATENCY=0 彻底移除计时代码
+#ifndef MEMPOOL_LATENCY
+    #define MEMPOOL_LATENCY 1
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 // 魔数策略：之前使用固定常量 0xDEADBEEF，容易被覆盖后伪造。
 // 现在改为：每个内存池启动时生成 32-bit 随机种子 magic_seed，
-// 块头 magic 字段 = magic_seed ^ (uint32_t)(uintptr_t)block 指针低位（地址扰动），
+// 块头 magic 字段 = magic_seed ^ 块相对 link base 的偏移低位（地址扰动；非共享池 base 为 0，即块地址），
 // 从而不同池/运行实例的魔数不同，降低简单破坏未被检测的概率。
 // 仍保留旧名字接口语义，提供生成 / 校验宏。
 #define MP_ENABLE_DYNAMIC_MAGIC 1
 
+// 池内链接的基址：共享池为本进程中的映射起点，其余池为 0（见 mp_link_t）
+#define MP_LINK_BASE(pool) ((uintptr_t)(pool) - (pool)->self_offset)
+
 // 生成块魔数：传入 pool 与 block 指针
-#define MP_MAKE_BLOCK_MAGIC(pool, blk_ptr) ((uint32_t)((pool)->magic_seed) ^ (uint32_t)(uintptr_t)(blk_ptr))
+#define MP_MAKE_BLOCK_MAGIC(pool, blk_ptr) ((uint32_t)((pool)->magic_seed) ^ (uint32_t)((uintptr_t)(blk_ptr) - MP_LINK_BASE(pool)))
 
 // 校验块魔数
 #define MP_CHECK_BLOCK_MAGIC(pool, blk_ptr) ((blk_ptr)->magic == MP_MAKE_BLOCK_MAGIC((pool), (blk_ptr)))
@@ -50,12 +59,44 @@ extern "C" {
 // 最大固定大小类别
 #define MAX_SIZE_CLASSES 16    // 支持的固定大小数量
 #define PAGE_SIZE 4096
+#define MP_HUGE_PAGE_SIZE (2u * 1024 * 1024) // x86-64 / arm64 默认大页尺寸
+
+// 大页策略
+typedef enum {
+    MP_HUGE_PAGES_NONE = 0,        // 普通 4 KiB 页（默认）
+    MP_HUGE_PAGES_TRANSPARENT,     // 段按 2 MiB 对齐并 MADV_HUGEPAGE（透明大页）
+    MP_HUGE_PAGES_EXPLICIT         // MAP_HUGETLB 显式大页，失败回退到透明大页
+} mp_huge_pages_t;
+
+// NUMA 内存策略（通过 mbind 施加到段上；单节点机器上除 BIND/PREFERRED 外均为空操作）
+typedef enum {
+    MP_NUMA_NONE = 0,              // 不设置策略，由首次触摸决定
+    MP_NUMA_BIND,                  // 严格绑定到 numa_node
+    MP_NUMA_PREFERRED,             // 优先 numa_node，不足时回退其他节点
+    MP_NUMA_INTERLEAVE,            // 在所有在线节点间按页交错
+    MP_NUMA_LOCAL                  // 分配在首次触摸线程所在节点（显式 local 策略，不受进程默认策略影响）
+} mp_numa_policy_t;
+#define MP_NUMA_MAX_NODES 8        // 支持的节点数上限（超出的节点按节点 0 处理）
+
+// 段属性（memory_pool_t.seg_flags）
+#define MP_SEG_HUGETLB      0x1    // 段由 MAP_HUGETLB 映射
+#define MP_SEG_THP          0x2    // 段已 2 MiB 对齐并 MADV_HUGEPAGE
+#define MP_SEG_RESERVED     0x4    // 段为“预留后按需提交”的连续地址区
+#define MP_SEG_FILE         0x8    // 文件映射持久化段（池结构体嵌入映射头部）
+#define MP_SEG_SHARED       0x10   // 跨进程共享段（robust 进程间互斥锁，链接为偏移，各进程可映射在任意地址）
+#define MP_SEG_LOCKED       0x20   // 段已提交部分全部 mlock 常驻
+#define MP_SEG_EMBEDDED     0x40   // 池结构体嵌入堆前一页段头（销毁后可进入进程级段缓存）
+#define MP_SEG_MEMFD        0x80   // memfd 后备的私有映射段，可 ftruncate + mremap 原地延长（fd 存于 memory_pool_t.fd）
+#define MP_SEG_NUMA         0x100  // 段已成功施加 NUMA 策略
+#define MP_SEG_COLD         0x200  // 冷数据段：不用大页、不锁定，压力下可整体 MADV_COLD / MADV_PAGEOUT
 
 // 标志位（低位聚合）：
 #define MB_FLAG_PREV_FREE   0x1    // 前一个物理块是空闲块（通用块）
 #define MB_FLAG_FREE        0x2    // 当前块处于通用空闲列表
 #define MB_FLAG_SIZECLASS   0x4    // 属于固定大小类别管理（不参与通用合并）
 #define MB_FLAG_RB_BLACK    0x8    // 红黑树颜色位：1=黑，0=红（仅在空闲块挂入 RB 树时使用）
+#define MB_FLAG_ZEROED      0x10   // 空闲块内部整页已 MADV_DONTNEED，读出为零（calloc 可跳过 memset）
+#define MB_FLAG_SLAB        0x20   // 已分配块的用户区是一个紧凑 slab（起点按 2 的幂跨度对齐）
 
 // RB 颜色操作宏
 #define RB_SET_RED(b)       ((b)->flags &= ~MB_FLAG_RB_BLACK)
@@ -64,61 +105,197 @@ extern "C" {
 #define RB_IS_BLACK(b)      (!RB_IS_RED(b))
 
 // 内存块头部结构（紧凑 + 复用）：
-// 空闲块: union.next 用作空闲链指针；已分配块: union.prev_size 记录前一物理块大小(用于 O(1) 反向合并)
+// 空闲块: union.next 用作空闲链链接；已分配块: union.prev_size 记录前一物理块大小(用于 O(1) 反向合并)
+// 池内链接：块相对所属池 link base（MP_LINK_BASE）的偏移，0 为空。
+// 共享池的 base 是各进程自己的映射起点，因此同一共享对象可以映射在任意地址；
+// 其余池的 base 为 0，链接值就是块地址
+typedef uintptr_t mp_link_t;
+
 typedef struct memory_block {
     // 头部前导字段：按写越界方向（通常是上一块用户区向高地址溢出）优先碰撞 magic/flags，实现类似前向 canary 早期检测。
     uint32_t magic;                // 动态魔数 (pool->magic_seed ^ addr) —— 放在最前面，上一块溢出最先破坏
     uint32_t flags;                // 标志位 (包含 FREE / PREV_FREE / SIZECLASS)
     // 复用区 union 放在 size 之前可以让 size 与 prev_size/next 的覆盖更难一次性伪造
     union {
-        struct memory_block* next; // 空闲链表指针（仅当 MB_FLAG_FREE=1 时有效）
+        mp_link_t next;            // 空闲链表链接（仅当 MB_FLAG_FREE=1 时有效）
         size_t prev_size;          // 前一个物理块大小（仅当 MB_FLAG_FREE=0 且 MB_FLAG_PREV_FREE=1 时有效），使用 size_t 避免 >4GB 截断
     } u;
     size_t   size;                 // 当前块大小（含头部，已按 alignment 对齐）
-    // 红黑树指针（仅在通用空闲树中使用）
-    struct memory_block* rb_left;
-    struct memory_block* rb_right;
-    struct memory_block* rb_parent;
+    // 红黑树链接（仅在通用空闲树中使用）
+    mp_link_t rb_left;
+    mp_link_t rb_right;
+    mp_link_t rb_parent;
 } memory_block_t;
 
 // 固定大小类别池（用于固定大小分配优化）
+struct mp_slab;
 typedef struct size_class_pool {
-    memory_block_t* free_blocks;   // 空闲块链表
-    size_t block_size;             // 固定块大小
+    mp_link_t free_blocks;         // 空闲块链表（链接相对 master 的 link base）
+    size_t block_size;             // 固定块大小（紧凑布局下为对象步长，不含块头）
     size_t block_count;            // 总块数量
     size_t used_count;             // 已使用块数
+    size_t hits;                   // alloc_fixed 直接由私有空闲链 / 当前 slab 满足的次数
+    size_t misses;                 // 私有存储为空，需从通用堆补充块或切出新 slab 的次数
+    struct mp_slab* slabs;         // 紧凑布局：该类的 slab 链（元数据集中在 slab 头部侧表）
 } size_class_pool_t;
 
+// 内存池配置
+typedef struct pool_config {
+    size_t pool_size;              // 池大小
+    bool thread_safe;              // 是否线程安全
+    uint32_t alignment;            // 对齐字节数
+    bool enable_size_classes;      // 是否启用固定大小池
+    size_t* size_class_sizes;      // 固定大小数组
+    int num_size_classes;          // 固定大小数量
+    // 空闲子池回收：子池 used_size 归零并持续 child_idle_ms 毫秒后，从链上摘除并 munmap
+    bool release_idle_children;    // 是否自动回收完全空闲的子池
+    uint32_t child_idle_ms;        // 空闲延迟（毫秒，0 = 变空即回收）
+    // 大页：段尺寸（含子池）按 MP_HUGE_PAGE_SIZE 取整
+    mp_huge_pages_t huge_pages;    // 大页策略
+    // 预留-提交模式：预先预留 reserve_size 字节连续虚拟地址（PROT_NONE + MAP_NORESERVE），
+    // 扩展时在其中 mprotect 提交而不是新建子池；预留区耗尽后回退到子池。0 = 关闭
+    // 不能与 MP_HUGE_PAGES_EXPLICIT 同时使用（创建失败，POOL_ERROR_INVALID_SIZE）
+    size_t reserve_size;
+    bool populate;                 // 创建/扩展段时预先缺页（MADV_POPULATE_WRITE，不支持时逐页触摸）
+    // 常驻锁定：每个段（含子池与预留区新提交部分）mlock，分配热路径不再发生主/次缺页
+    bool lock_memory;              // 是否 mlock 段（mlock 本身完成预缺页）
+    bool lock_required;            // mlock 失败（RLIMIT_MEMLOCK 等）时创建/扩展失败，而不是退化为可缺页内存
+    // 紧凑固定大小类：对象无块头、首尾相接排列，大小/状态/空闲链放在 slab 头部的侧表，
+    // 顺序扫描对象数组时不再夹带块头，释放也不写用户数据所在缓存行
+    bool packed_size_classes;
+    // 自适应：子池按已映射总量的一半递增（不超过 64 倍 pool_size），固定大小类按已用数量批量补充
+    bool adaptive_sizing;
+    // memfd 后备：扩展时先 ftruncate + mremap（不移动）延长链尾段，尾部空闲块与新空间直接合并，
+    // 后方地址被占用时才新建子池。按页粒度、忽略大页策略；与 reserve_size 同时设置时后者优先
+    bool memfd_growth;
+    // NUMA：段映射后、首次缺页前 mbind；numa_arenas 时每个节点一个独立的 arena（子池链），
+    // memory_pool_alloc / calloc / alloc_aligned 从调用线程所在节点的 arena 分配，master 作为 numa_node 的 arena。
+    // 固定大小类仍在 master 上。节点数 <= 1 或文件/共享段时不创建 arena
+    mp_numa_policy_t numa_policy;  // 段的内存策略；numa_arenas 且为 NONE 时按 BIND numa_node
+    int numa_node;                 // BIND / PREFERRED 的目标节点，越界时不施加策略
+    bool numa_arenas;              // 每节点独立 arena
+    // 内存预算：按整条链已映射的段字节数（不含节点 arena）约束扩展，0 = 不限制。
+    // 越过软上限时先强制回收空闲子池与空闲页、调用压力回调，之后扩展不再按自适应步长放大；
+    // 扩展后将超过硬上限的请求直接失败（POOL_ERROR_OUT_OF_MEMORY），不再新建子池
+    size_t soft_limit;
+    size_t hard_limit;
+    // calloc / realloc 在 MP_COPY_AUTO 下超过该字节数改用非临时（流式）存储，不把大块数据带入缓存；
+    // 0 = MP_STREAMING_DEFAULT_THRESHOLD，SIZE_MAX = 始终走缓存
+    size_t streaming_threshold;
+    // 冷数据池：段标记 MP_SEG_COLD，忽略大页、lock_memory 与 populate（冷页应可被单独换出）
+    bool cold;
+    // 创建即开启操作延迟直方图（亦可运行时 memory_pool_latency_enable）
+    bool record_latency;
+} pool_config_t;
+
+// 使用画像（仅 master 维护，整条链汇总）
+#define MP_SIZE_HIST_BUCKETS 32
+typedef struct mp_usage_profile {
+    size_t current_used;           // 当前已用字节（含块头与 size-class 预留）
+    size_t peak_used;              // 已用字节峰值
+    size_t mapped_bytes;           // 当前各段总字节数（读取时汇总）
+    size_t peak_mapped;            // 段总字节数峰值
+    size_t segments;               // 当前段数（读取时汇总）
+    size_t growth_events;          // 扩展次数 = in_place_growths + child_pools_created
+    size_t in_place_growths;       // 预留区原地提交次数
+    size_t child_pools_created;    // 新建子池次数
+    size_t alloc_requests;         // 计入直方图的通用堆分配请求数（含固定大小类补充与 slab）
+    size_t pressure_events;        // 扩展将越过软/硬上限的次数
+    size_t hard_limit_rejections;  // 因硬上限拒绝的扩展次数
+    size_t size_hist[MP_SIZE_HIST_BUCKETS]; // 请求尺寸 log2 直方图：桶 i 计 [2^i, 2^(i+1))，末桶含更大请求
+} mp_usage_profile_t;
+
+// 内存压力回调：扩展将越过软/硬上限时调用（不持池锁，可在其中释放本池内存；
+// 回调内的分配不会再次触发回调）
+typedef struct mp_pressure_info {
+    size_t mapped_bytes;           // 当前链上已映射的段字节数
+    size_t requested_bytes;        // 触发扩展的块大小
+    size_t soft_limit;
+    size_t hard_limit;
+    bool hard;                     // 本次扩展将越过硬上限
+} mp_pressure_info_t;
+struct memory_pool;
+typedef void (*mp_pressure_callback_t)(struct memory_pool* pool, const mp_pressure_info_t* info, void* user_data);
+
+// 预清零块储备：calloc 命中时直接弹出已清零的块，不在调用路径上 memset
+#define MP_ZERO_RESERVE_MAX 8
+typedef struct mp_zero_reserve {
+    size_t block_size;             // 块大小（含块头），calloc 请求对齐后相同即命中
+    size_t request_size;           // 补充时的请求字节数
+    uint32_t target;               // 目标块数
+    uint32_t count;                // 当前可用块数
+    void* head;                    // 已清零块的用户区链表（链接存于用户区首字，弹出时清零）
+} mp_zero_reserve_t;
+
 // 内存池结构
 typedef struct memory_pool {
-    void* pool_start;              // 池起始地址
+    void* pool_start;              // 池起始地址（相对 link base；只有共享池与实际地址不同）
     size_t pool_size;              // 池总大小
     size_t used_size;              // 已使用大小
-    memory_block_t* free_list;     // 空闲块链表
+    mp_link_t free_list;           // 空闲块链表（按地址排序）
+    uintptr_t self_offset;         // 本结构体相对 link base 的偏移：共享池为其在映射内的位置，其余池为自身地址
     pthread_mutex_t mutex;         // 互斥锁
     bool thread_safe;              // 是否线程安全
     uint32_t alignment;            // 内存对齐字节数
     struct memory_pool* next;      // 下一个内存池（链式扩展）
-    struct memory_pool* master;    // 主池（全局红黑树所在）
+    struct memory_pool* master;    // 主池（全局红黑树所在）；共享池为 NULL（自身即 master，不保存进程内地址）
     uint32_t magic_seed;           // 动态魔数种子
     
     // 固定大小池
     size_class_pool_t size_classes[MAX_SIZE_CLASSES]; // bins
     size_t class_sizes[MAX_SIZE_CLASSES]; // bins size
     int num_classes; // num of bins
+    uint32_t slab_spans;           // 紧凑 slab 使用过的对齐跨度（bit n = 2^n 字节），释放时按位反查所属 slab
     // 红黑树根：按 size 排序，支持 O(log n) best-fit
-    memory_block_t* rb_root;       // 仅 master 使用，其他池保持 NULL
+    mp_link_t rb_root;             // 仅 master 使用，其他池保持 0
+
+    pool_config_t config;          // 创建配置副本（子池据此继承；不保留 size_class_sizes 指针）
+    uint64_t idle_since_ms;        // 子池变为完全空闲的单调时钟时间戳（0 = 非空闲）
+    size_t idle_children;          // 仅 master：正在空闲计时的子池数量
+    uint32_t seg_flags;            // 段属性 MP_SEG_*
+    size_t reserved_size;          // 预留区总长度（pool_size 为其中已提交部分；0 = 非预留模式）
+    size_t fresh_offset;           // 零页追踪：[fresh_offset + 块头, pool_size) 从未交给用户，保证为零
+    void* map_base;                // 含头部的整个映射起点（仅结构体嵌入映射的段，否则 NULL；与 pool_start 一样相对 link base）
+    size_t map_size;               // 整个映射长度
+    int fd;                        // 后备文件描述符（文件池与 memfd 段；匿名映射与共享池为 -1）
+    uint32_t lock_recoveries;      // robust 锁恢复次数（持锁进程异常退出后按块头重建空闲结构）
+    bool poisoned;                 // 恢复时块头已损坏、无法重建：此后分配/释放失败（POOL_ERROR_CORRUPTION）
+    mp_usage_profile_t profile;    // 使用画像（仅 master 有效）
+    // 运行计数（仅 master，持锁更新；各 arena 独立计数，memory_pool_get_stats 读取时汇总）
+    size_t heap_frees;             // 通用堆释放次数（分配次数见 profile.alloc_requests）
+    size_t merge_sweeps;           // 最佳适配失败后整条链合并空闲块再重试的次数
+    size_t class_fallbacks;        // alloc_fixed 尺寸超出所有固定类、改走通用堆的次数
+    struct memory_pool* numa_arenas[MP_NUMA_MAX_NODES]; // 仅 master：各节点 arena（懒创建，master 自身所在节点为 NULL）
+    mp_pressure_callback_t pressure_cb; // 仅 master：内存压力回调
+    void* pressure_user;
+    bool in_pressure_cb;           // 回调执行中（防止回调内分配递归触发）
+    struct mp_pressure_monitor* monitor; // 仅 master：系统内存压力监视线程（未启动为 NULL）
+    mp_zero_reserve_t zero_reserves[MP_ZERO_RESERVE_MAX]; // 仅 master：预清零块储备
+    int num_zero_reserves;
+    size_t zero_reserve_hits;      // calloc 命中储备次数
+    size_t zero_reserve_misses;    // 对应尺寸储备为空而回退到分配 + 清零的次数
+    struct mp_zero_refiller* zero_refiller; // 仅 master：后台补充线程（未启动为 NULL）
+    uint64_t reset_gen;             // 仅 master：重置代数，memory_pool_reset 开始与结束各加一（奇数 = 重置进行中）
+    uint32_t zero_refills;          // 仅 master：锁外清零中的补充块数，重置须等其归零才能重建堆
+    struct mp_latency* latency;     // 仅 master：操作延迟直方图（从未开启为 NULL）
+    struct mp_trace* trace;         // 仅 master：分配轨迹记录器（从未开启为 NULL）
+    struct memory_pool* cold_arena; // 仅 master：MP_HINT_COLD 分配所在的冷数据池（懒创建）
+    struct memory_pool* short_arena;   // 仅 master：MP_HINT_SHORT_LIVED 分配所在的池（懒创建）
+    struct memory_pool* request_arena; // 仅 master：MP_HINT_REQUEST 分配所在的池（懒创建）
+    unsigned arena_hint;            // 提示 arena 自身：对应的 MP_HINT_*；普通池为 MP_HINT_NONE
+    struct memory_pool* budget;     // 附属 arena：映射计入该 master 的软/硬上限（arena 自身不设上限）；其他池为 NULL
+    size_t mapped_bytes;            // 整条链已映射的字节数：持自身锁更新后原子发布，供共享预算的其他池读取
+    uint64_t seg_serial;            // 段序号：子池按创建顺序递增（master 为 0），链上始终升序
+    uint64_t seg_serials;           // 仅 master：已分配的最大段序号
 } memory_pool_t;
 
-// 内存池配置
-typedef struct pool_config {
-    size_t pool_size;              // 池大小
-    bool thread_safe;              // 是否线程安全
-    uint32_t alignment;            // 对齐字节数
-    bool enable_size_classes;      // 是否启用固定大小池
-    size_t* size_class_sizes;      // 固定大小数组
-    int num_size_classes;          // 固定大小数量
-} pool_config_t;
+// 大块清零/复制的缓存策略（calloc_ex / realloc_ex）
+typedef enum {
+    MP_COPY_AUTO = 0,              // 按 streaming_threshold 选择
+    MP_COPY_CACHED,                // 普通 memset / memcpy，结果留在缓存中（随后马上要读写时）
+    MP_COPY_STREAMING              // 非临时存储绕过缓存（AVX-512 / AVX2 / SSE2，按 CPUID 运行时选择）
+} mp_copy_mode_t;
+#define MP_STREAMING_DEFAULT_THRESHOLD (4u * 1024 * 1024)
 
 // 内存池创建和销毁
 memory_pool_t* memory_pool_create(size_t pool_size, bool thread_safe);
@@ -130,20 +307,305 @@ void* memory_pool_alloc(memory_pool_t* pool, size_t size);
 void* memory_pool_alloc_aligned(memory_pool_t* pool, size_t size, size_t alignment);
 void* memory_pool_calloc(memory_pool_t* pool, size_t count, size_t size);
 void* memory_pool_realloc(memory_pool_t* pool, void* ptr, size_t new_size);
+// 分配提示（memory_pool_alloc_ex）
+#define MP_HINT_NONE 0x0
+#define MP_HINT_COLD 0x1               // 很少访问、长期存活：放入独立的冷数据段，与热对象不共享页面
+// 生命周期提示：不同寿命的对象放入不同段，长寿对象不再钉住短命对象释放后的空洞
+#define MP_HINT_SHORT_LIVED 0x2        // 很快释放：独立 arena，段整体变空后可被 MP_TRIM_IDLE_CHILDREN 回收
+#define MP_HINT_REQUEST     0x4        // 请求作用域：独立 arena，请求结束时 memory_pool_reset_requests 整体释放
+#define MP_HINT_LONG_LIVED  0x8        // 长期存活：留在 master（同无提示）
+#define MP_HINT_ARENA_MASK (MP_HINT_COLD | MP_HINT_SHORT_LIVED | MP_HINT_REQUEST)
+void* memory_pool_alloc_ex(memory_pool_t* pool, size_t size, unsigned hints);
+void* memory_pool_calloc_ex(memory_pool_t* pool, size_t count, size_t size, mp_copy_mode_t mode);
+void* memory_pool_realloc_ex(memory_pool_t* pool, void* ptr, size_t new_size, mp_copy_mode_t mode);
+// 预清零储备：为 calloc 总字节数为 size 的请求保持 count 个已清零的块（同一 size 重复设置即修改目标；
+// count 为 0 删除）。块从通用堆取得并计入 used_size；MP_TRIM_SIZE_CLASSES 时连同 size-class 预留一起归还
+bool memory_pool_zero_reserve(memory_pool_t* pool, size_t size, size_t count);
+// 在调用线程补满所有储备（空闲时调用），返回新清零的块数
+size_t memory_pool_zero_reserve_refill(memory_pool_t* pool);
+// 后台补充线程：储备降到目标一半以下时唤醒补满；仅线程安全池。memory_pool_destroy 时自动停止
+bool memory_pool_zero_reserve_start(memory_pool_t* pool);
+void memory_pool_zero_reserve_stop(memory_pool_t* pool);
+// 当前 CPU 上选用的流式内核："avx512"、"avx2"、"sse2" 或 "generic"
+const char* memory_pool_streaming_kernel(void);
 void memory_pool_free(memory_pool_t* pool, void* ptr);
 
 // 内存池管理
 void memory_pool_reset(memory_pool_t* pool);
+void memory_pool_reset_requests(memory_pool_t* pool); // 释放全部 MP_HINT_REQUEST 分配，其余对象不受影响
 bool memory_pool_contains(memory_pool_t* pool, void* ptr);
 size_t memory_pool_get_block_size(memory_pool_t* pool, void* ptr);
+bool memory_pool_is_packed(memory_pool_t* pool, void* ptr); // 是否为紧凑 slab 对象（get_block_size 返回不含块头的对象大小）
 
 // 性能优化
 void memory_pool_warmup(memory_pool_t* pool);
+
+// 预热选项（memory_pool_warmup 等价于全部默认值）
+typedef struct mp_warmup_options {
+    size_t max_bytes;              // 只预热链上（按段顺序）前 max_bytes 字节，0 = 全部
+    int threads;                   // 并行预缺页线程数，<= 1 在调用线程执行
+    bool touch_only;               // 不使用 MADV_POPULATE_WRITE，始终逐页触摸
+} mp_warmup_options_t;
+// 按窗口分轮预热（工作线程只启动一次，逐窗口分派），每轮之间释放池锁，预热期间其他线程的分配只在单个窗口内等待
+bool memory_pool_warmup_ex(memory_pool_t* pool, const mp_warmup_options_t* opts);
 void memory_pool_defragment(memory_pool_t* pool);
 
+// 内存回收（memory_pool_trim 的 flags）
+#define MP_TRIM_IDLE_CHILDREN 0x1      // 回收空闲已超过 child_idle_ms 的子池
+#define MP_TRIM_PAGES         0x2      // 空闲块内部整页 MADV_DONTNEED 归还内核（跳过已锁定段）
+#define MP_TRIM_SIZE_CLASSES  0x4      // size-class 私有空闲链与空 slab 交还通用堆（本身不计入返回值，配合前两项归还系统）
+#define MP_TRIM_COLD          0x10     // 冷数据段整体 MADV_COLD：页面移到非活跃 LRU，内存紧张时优先回收（不计入返回值）
+#define MP_TRIM_PAGEOUT       0x20     // 冷数据段整体 MADV_PAGEOUT：立即回收（匿名页换出到 swap），返回值计入常驻字节的减少量
+#define MP_TRIM_FORCE         0x8000   // 忽略空闲延迟，立即回收
+// 返回本次归还给系统的字节数
+size_t memory_pool_trim(memory_pool_t* pool, unsigned flags);
+
+// 系统内存压力监视：后台线程周期读取 PSI（memory.pressure / /proc/pressure/memory）与 cgroup v2
+// memory.current / memory.high，检测到压力时对池执行 memory_pool_trim(MP_TRIM_ALL)。仅支持线程安全、非跨进程共享的池
+#define MP_TRIM_ALL (MP_TRIM_IDLE_CHILDREN | MP_TRIM_PAGES | MP_TRIM_SIZE_CLASSES | MP_TRIM_COLD | MP_TRIM_FORCE)
+typedef struct mp_pressure_monitor_options {
+    const char* psi_path;          // PSI 文件；NULL = 所在 cgroup 的 memory.pressure，不可读时 /proc/pressure/memory
+    const char* cgroup_dir;        // 含 memory.current / memory.high 的目录；NULL = 由 /proc/self/cgroup 推得
+    uint32_t interval_ms;          // 轮询周期，0 = 1000
+    double some_avg10;             // "some avg10" 超过该百分比视为压力，0 = 10.0
+    double high_ratio;             // memory.current >= memory.high * high_ratio 视为压力，0 = 0.9
+} mp_pressure_monitor_options_t;
+typedef struct mp_pressure_monitor_stats {
+    size_t polls;                  // 已轮询次数
+    size_t pressure_events;        // 检测到压力的次数
+    size_t bytes_released;         // 因压力归还系统的字节数
+    double last_some_avg10;        // 最近一次读到的 some avg10（无 PSI 时为 -1）
+} mp_pressure_monitor_stats_t;
+// opts 为 NULL 时全部取默认值；每个池最多一个监视线程，memory_pool_destroy 时自动停止
+bool memory_pool_pressure_monitor_start(memory_pool_t* pool, const mp_pressure_monitor_options_t* opts);
+void memory_pool_pressure_monitor_stop(memory_pool_t* pool);
+bool memory_pool_pressure_monitor_get_stats(memory_pool_t* pool, mp_pressure_monitor_stats_t* stats);
+
+// 进程级段缓存：memory_pool_destroy 销毁的匿名段保留复用，配置相同的池（含子池）创建时跳过 mmap/munmap。
+// 缓存段仍然常驻，因此默认关闭（上限为 0），需要时用 memory_pool_segment_cache_set_limit 开启；
+// 空闲子池回收与 memory_pool_trim 释放的段不进入缓存，总是直接 munmap
+#define MP_SEGMENT_CACHE_DEFAULT_ENTRIES 0
+#define MP_SEGMENT_CACHE_DEFAULT_BYTES   0
+typedef struct mp_segment_cache_stats {
+    size_t segments;               // 当前缓存的段数
+    size_t bytes;                  // 当前缓存的映射字节数
+    size_t hits;                   // 创建时命中缓存的次数
+    size_t misses;                 // 创建时未命中（新建映射）的次数
+} mp_segment_cache_stats_t;
+// 设置缓存上限（段数上限不超过 64），超出部分立即 munmap；任一上限为 0 即关闭缓存
+void memory_pool_segment_cache_set_limit(size_t max_segments, size_t max_bytes);
+// 解除全部缓存段映射，返回释放的字节数
+size_t memory_pool_segment_cache_flush(void);
+void memory_pool_segment_cache_get_stats(mp_segment_cache_stats_t* stats);
+
 // 调试
 bool memory_pool_validate(memory_pool_t* pool);
 
+// 文件映射持久化池：文件为空时按 size 格式化，否则重新打开其中的堆（size 被忽略）。
+// 持久化池为单段、线程安全，不会链式扩展；重开时尽量映射回原地址，否则整体重定位，
+// 因此用户数据之间应使用 memory_pool_ptr_to_offset 得到的偏移而非裸指针互相引用。
+// 打开期间对文件持 flock 独占锁，文件已被打开时失败（POOL_ERROR_IO）；未正常关闭的文件重开时按块头重建空闲结构。
+memory_pool_t* memory_pool_create_persistent(const char* path, size_t size);
+bool memory_pool_sync(memory_pool_t* pool);
+bool memory_pool_set_root(memory_pool_t* pool, void* ptr);
+void* memory_pool_get_root(memory_pool_t* pool);
+size_t memory_pool_ptr_to_offset(memory_pool_t* pool, const void* ptr);
+void* memory_pool_offset_to_ptr(memory_pool_t* pool, size_t offset);
+
+// 跨进程共享池：shm_open 具名对象或 memfd，池结构体与 robust 互斥锁位于共享映射内。
+// 块头、红黑树与空闲链表保存的是相对映射起点的偏移，各进程（包括同一进程的多次 attach）
+// 可映射在任意地址；进程之间用 memory_pool_ptr_to_offset / memory_pool_offset_to_ptr 传递对象。
+// 持锁进程异常退出后，下一个加锁者按块头重建空闲结构；块头已损坏时池被标记为 poisoned。
+// memory_pool_destroy 对共享池只解除本进程映射。
+memory_pool_t* memory_pool_create_shared(const char* name, size_t size);
+memory_pool_t* memory_pool_create_shared_fd(size_t size, int* fd_out);
+memory_pool_t* memory_pool_attach_shared(const char* name);
+memory_pool_t* memory_pool_attach_shared_fd(int fd);
+bool memory_pool_unlink_shared(const char* name);
+
+// 大页覆盖统计（整条链）
+typedef struct mp_huge_page_stats {
+    size_t segments;               // 段数量
+    size_t total_bytes;            // 段总字节数
+    size_t hugetlb_bytes;          // MAP_HUGETLB 映射的字节数
+    size_t thp_advised_bytes;      // 已 MADV_HUGEPAGE 的字节数
+    size_t thp_backed_bytes;       // 实际由透明大页承载的字节数（来自 /proc/self/smaps，不可读时为 0）
+} mp_huge_page_stats_t;
+bool memory_pool_get_huge_page_stats(memory_pool_t* pool, mp_huge_page_stats_t* stats);
+
+// 内存占用报告：区分已提交 / 常驻 / 空闲 / 元数据开销，用于判断 RSS 增长来自泄漏、碎片还是元数据
+typedef struct mp_segment_report {
+    void* start;                   // 堆起点
+    size_t committed_bytes;        // 可访问的堆字节（pool_size）
+    size_t reserved_bytes;         // 已预留但尚未提交的地址空间
+    size_t resident_bytes;         // 常驻物理内存（mincore，按页计）
+    size_t used_bytes;             // 已分配块字节（含块头）
+    size_t free_bytes;             // 通用空闲块字节
+    size_t largest_free_block;     // 最大空闲块（含块头）
+    uint32_t seg_flags;            // MP_SEG_*
+} mp_segment_report_t;
+
+typedef struct mp_memory_report {
+    size_t segments;               // 段数（含节点 arena）
+    size_t committed_bytes;
+    size_t reserved_bytes;
+    size_t resident_bytes;
+    size_t used_bytes;
+    size_t free_bytes;
+    size_t free_blocks;            // 通用空闲块数
+    size_t largest_free_block;
+    double fragmentation;          // 外部碎片指数 1 - largest_free_block / free_bytes（无空闲时为 0）
+    size_t allocated_blocks;       // 已分配的通用块数（含 size-class 块与 slab）
+    size_t header_bytes;           // 元数据开销：已分配块的块头 + slab 侧表
+    size_t size_class_reserve_bytes; // size-class 私有空闲链 / slab 中尚未分配的字节（不归还通用堆）
+    size_t zero_reserve_bytes;     // 预清零储备持有的块字节
+} mp_memory_report_t;
+// 汇总整条链与各附属 arena（节点 arena、冷数据 arena）；遍历所有块并调用 mincore，开销与池大小成正比，不适合热路径
+bool memory_pool_get_memory_report(memory_pool_t* pool, mp_memory_report_t* report);
+// 逐段报告，最多写入 max 项，返回总段数（out 为 NULL 时仅计数；不含附属 arena）
+size_t memory_pool_get_segment_reports(memory_pool_t* pool, mp_segment_report_t* out, size_t max);
+
+// 堆遍历：按地址顺序报告每个段内的每个物理块（含空闲块），供碎片图、泄漏排查与整理工具使用
+typedef enum {
+    MP_BLOCK_FREE = 0,             // 通用空闲块（位于空闲树 / 空闲链中）
+    MP_BLOCK_ALLOCATED,            // 通用已分配块（含池内部持有的块，如预清零储备）
+    MP_BLOCK_SIZE_CLASS            // size-class 块或紧凑 slab（归 size-class 私有，不参与通用合并）
+} mp_block_state_t;
+
+typedef struct mp_block_info {
+    void* block;                   // 块头地址
+    void* user;                    // 用户区起点（块头之后）
+    size_t size;                   // 块大小（含块头）
+    mp_block_state_t state;
+    bool in_use;                   // 已交给调用方：已分配块恒为 true；size-class 块不在类私有空闲链中；slab 至少有一个对象在用
+    memory_pool_t* segment;        // 所属段（master、子池或附属 arena 的段）
+} mp_block_info_t;
+
+// 返回 false 提前结束遍历。回调在池锁内执行，不得调用该池的分配 / 释放等接口
+typedef bool (*mp_walk_callback_t)(const mp_block_info_t* info, void* ctx);
+// 依次遍历主链各段与各附属 arena，返回已报告的块数；发现块头损坏时停止并置 POOL_ERROR_CORRUPTION
+size_t memory_pool_walk(memory_pool_t* pool, mp_walk_callback_t callback, void* ctx);
+
+// 运行统计：各 arena 的计数在其自身锁内更新（不引入额外的共享写），读取时汇总。
+// 结构带版本：新字段只追加在末尾，库按调用方编译时的 sizeof 写出
+#define MP_STATS_VERSION 1
+typedef struct mp_class_stats {
+    size_t size;                   // 固定类的用户尺寸
+    size_t hits;                   // 由私有空闲链 / slab 直接满足的次数
+    size_t misses;                 // 需从通用堆补充或切出新 slab 的次数
+    size_t used_count;             // 当前已分配对象数
+    size_t block_count;            // 当前持有的块 / 对象槽数
+} mp_class_stats_t;
+
+typedef struct mp_pool_stats {
+    uint32_t version;              // MP_STATS_VERSION
+    uint32_t struct_size;          // 实际写入的字节数
+    size_t allocations;            // 通用堆分配次数（含固定类补充与 slab）
+    size_t frees;                  // 通用堆释放次数
+    size_t bytes_in_use;           // 已用字节（含块头与固定类预留）
+    size_t peak_bytes;             // 已用字节峰值（多个 arena 时为各自峰值之和）
+    size_t chain_length;           // 段数（含附属 arena 的段）
+    size_t free_blocks;            // 通用空闲块数
+    size_t rb_tree_depth;          // 空闲红黑树最大深度（各 arena 取最大）
+    size_t merge_fallbacks;        // 最佳适配失败后整链合并重试的次数
+    size_t child_pools_created;    // 新建子池次数
+    size_t class_fallbacks;        // alloc_fixed 超出所有固定类、改走通用堆的次数
+    size_t arenas;                 // 已创建的附属 arena 数（节点 / 冷数据 / 生命周期）
+    int num_classes;
+    mp_class_stats_t classes[MAX_SIZE_CLASSES]; // master 的固定类（附属 arena 不启用固定类）
+} mp_pool_stats_t;
+bool memory_pool_get_stats_sized(memory_pool_t* pool, mp_pool_stats_t* stats, size_t size);
+static inline bool memory_pool_get_stats(memory_pool_t* pool, mp_pool_stats_t* stats) {
+    return memory_pool_get_stats_sized(pool, stats, sizeof(*stats));
+}
+
+// 操作延迟直方图（HDR 风格对数-线性分桶，单位纳秒，CLOCK_MONOTONIC 计时，含等锁时间）
+typedef enum {
+    MP_OP_ALLOC = 0,               // memory_pool_alloc / alloc_ex
+    MP_OP_FREE,
+    MP_OP_REALLOC,                 // realloc / realloc_ex
+    MP_OP_ALLOC_ALIGNED,
+    MP_OP_ALLOC_FIXED,
+    MP_OP_DEFRAGMENT,
+    MP_OP_COUNT
+} mp_op_t;
+
+#define MP_LATENCY_BUCKETS 304     // 覆盖到约 2^40 ns；更长的计入末桶
+typedef struct mp_latency_histogram {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t buckets[MP_LATENCY_BUCKETS]; // 桶 0..7 为 0..7ns，其后每个 2 的幂区间分 8 个等宽桶
+} mp_latency_histogram_t;
+
+// 开启/关闭记录（首次开启时分配直方图，关闭保留已有数据）；跨进程共享池不支持
+bool memory_pool_latency_enable(memory_pool_t* pool, bool enable);
+// 复制各操作的直方图到 out[MP_OP_COUNT]；reset 为 true 时同时清零
+bool memory_pool_latency_snapshot(memory_pool_t* pool, mp_latency_histogram_t out[MP_OP_COUNT], bool reset);
+// 按分位数 q（0..1）估算延迟：返回所在桶的上界（不超过 max_ns）
+uint64_t memory_pool_latency_percentile(const mp_latency_histogram_t* h, double q);
+
+// 分配轨迹：把每个公开的分配/释放调用写入紧凑二进制文件（mp_trace_header_t + 定长记录，本机字节序），
+// 供 bench/replay.c 在任意配置下离线重放。指针不落盘，对象以编号关联
+#define MP_TRACE_MAGIC "MPTRACE"
+#define MP_TRACE_VERSION 1
+#define MP_TRACE_F_THREAD_SAFE 0x1 // 被记录的池为线程安全池
+
+typedef enum {
+    MP_TRACE_ALLOC = 1,            // memory_pool_alloc
+    MP_TRACE_ALLOC_EX,             // alloc_ex（hints 有效）
+    MP_TRACE_ALLOC_ALIGNED,        // alloc_aligned（align_log2 有效）
+    MP_TRACE_CALLOC,               // calloc / calloc_ex（size 为总字节数，溢出时为 UINT64_MAX；mode 有效）
+    MP_TRACE_REALLOC,              // realloc / realloc_ex（arg 为原对象，成功后原编号失效；mode 有效）
+    MP_TRACE_FREE,
+    MP_TRACE_ALLOC_FIXED,
+    MP_TRACE_FREE_FIXED,
+    MP_TRACE_RESET,                // 此前的全部对象失效
+    MP_TRACE_RESET_REQUESTS,       // 位于 MP_HINT_REQUEST arena 的对象失效
+    MP_TRACE_DEFRAGMENT
+} mp_trace_op_t;
+
+typedef struct mp_trace_header {
+    char magic[8];                 // MP_TRACE_MAGIC（含结尾 0）
+    uint32_t version;              // MP_TRACE_VERSION
+    uint32_t record_size;          // sizeof(mp_trace_record_t)；读取方按此步长前进，可跳过将来追加的字段
+    uint64_t pool_size;            // 被记录池的初始段大小
+    uint32_t flags;                // MP_TRACE_F_*
+    uint32_t reserved;
+} mp_trace_header_t;
+
+typedef struct mp_trace_record {
+    uint64_t time_ns;              // 距 memory_pool_trace_start 的纳秒数（调用开始时刻）
+    uint64_t size;                 // 请求字节数
+    uint32_t id;                   // 结果对象编号（从 1 递增；0 = 返回 NULL 或无结果）
+    uint32_t arg;                  // 输入对象编号（free / realloc；0 = NULL 或记录开始前分配的对象）
+    uint32_t thread;               // 调用线程序号（进程内从 1 起）
+    uint8_t op;                    // mp_trace_op_t
+    uint8_t align_log2;            // alloc_aligned 的对齐
+    uint8_t hints;                 // alloc_ex 的 MP_HINT_*
+    uint8_t mode;                  // calloc_ex / realloc_ex 的 mp_copy_mode_t
+} mp_trace_record_t;
+
+// 开始记录到 path（截断重写）；已在记录时失败。跨进程共享池不支持。
+// 记录期间对该池的公开调用被串行化，文件中的记录顺序即实际执行顺序
+bool memory_pool_trace_start(memory_pool_t* pool, const char* path);
+// 停止记录并关闭文件；中途写入失败（此后不再记录）时返回 false 并置 POOL_ERROR_IO
+bool memory_pool_trace_stop(memory_pool_t* pool);
+
+// NUMA：在线节点数（无法探测时为 1）
+int memory_pool_numa_node_count(void);
+
+// 使用画像与配置建议
+bool memory_pool_get_usage_profile(memory_pool_t* pool, mp_usage_profile_t* profile);
+// 按峰值用量给出下次部署的配置（其余字段沿用当前池；不填 size_class_sizes）
+bool memory_pool_suggest_config(memory_pool_t* pool, pool_config_t* out);
+// 以 JSON 导出画像、直方图与建议配置（含建议的固定大小类尺寸）
+bool memory_pool_export_profile(memory_pool_t* pool, FILE* out);
+
+// 设置内存压力回调（cb 为 NULL 时取消）；跨进程共享池不支持（函数指针仅在本进程有效）
+bool memory_pool_set_pressure_callback(memory_pool_t* pool, mp_pressure_callback_t cb, void* user_data);
+
 // 固定大小池操作
 int memory_pool_add_size_class(memory_pool_t* pool, size_t size, size_t count);
 void* memory_pool_alloc_fixed(memory_pool_t* pool, size_t size);
@@ -157,7 +619,8 @@ typedef enum {
     POOL_ERROR_OUT_OF_MEMORY,
     POOL_ERROR_CORRUPTION,
     POOL_ERROR_DOUBLE_FREE,
-    POOL_ERROR_INVALID_POINTER
+    POOL_ERROR_INVALID_POINTER,
+    POOL_ERROR_IO
 } pool_error_t;
 
 // 获取最后错误
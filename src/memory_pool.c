@@ -1,3 +1,5 @@
+// MAP_ANONYMOUS / clock_gettime 等在 -std=c99 下需要显式开启扩展
+#define _GNU_SOURCE
 #include "../include/memory_pool.h"
 #include <stdlib.h>
 #include <string.h>
@@ -6,6 +8,34 @@
 #include <stdio.h>
 #include <assert.h>
 #include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
+
+// Linux 5.14+：按写方式预缺页；旧内核返回 EINVAL 时回退到逐页触摸
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+// Linux 5.4+：冷数据段的回收提示
+#ifndef MADV_COLD
+#define MADV_COLD 20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+
+// memfd 段之后预留的地址空间（段初始长度的倍数），供 mremap 原地延长
+#define MP_MEMFD_HEADROOM_FACTOR 64
+
+// 嵌入池结构体的段头长度：匿名段在堆前多映射一页存放 memory_pool_t，创建/销毁不再 malloc/free
+#define MP_SEG_HEADER_SIZE PAGE_SIZE
+typedef char mp_seg_header_fits[(sizeof(memory_pool_t) <= MP_SEG_HEADER_SIZE) ? 1 : -1];
 
 // 线程局部错误码
 static __thread pool_error_t g_last_error = POOL_OK;
@@ -18,33 +48,92 @@ static bool validate_block(memory_block_t* block);
 static void insert_free_block(memory_pool_t* pool, memory_block_t* block);
 static memory_pool_t* create_child_pool(memory_pool_t* root, size_t min_size);
 static memory_block_t* find_best_fit_chain(memory_pool_t* root, memory_pool_t** owner_pool, size_t size);
+static void destroy_segment(memory_pool_t* p, bool cacheable);
+static void* segment_map(const pool_config_t* cfg, size_t* size, size_t* reserved, uint32_t* seg_flags, int* fd);
+static void segment_unmap(memory_pool_t* p);
+static void segment_unmap_raw(void* heap, size_t size, size_t reserved, uint32_t seg_flags);
+static void* segment_cache_take(const pool_config_t* cfg, size_t* size, uint32_t* seg_flags);
+static bool segment_cache_put(memory_pool_t* p);
+static bool pool_init(memory_pool_t* pool, const pool_config_t* config);
+static bool persist_recover(memory_pool_t* pool);
+static void persist_close(memory_pool_t* pool);
+static void prefault_range(void* addr, size_t len, bool touch_only);
+static bool numa_apply_policy(const pool_config_t* cfg, void* addr, size_t len);
+// 用户区内已知为零的字节区间 [lo, hi)（相对用户指针），供 calloc 跳过 memset
+typedef struct zero_span {
+    size_t lo;
+    size_t hi;
+} zero_span_t;
+static void* pool_alloc(memory_pool_t* pool, size_t size, zero_span_t* zs);
+static void* pool_alloc_aligned(memory_pool_t* pool, size_t size, size_t alignment);
+static void* pool_alloc_aligned_local(memory_pool_t* pool, size_t size, size_t alignment);
+static void* pool_alloc_fixed(memory_pool_t* pool, size_t size);
+static void* pool_realloc(memory_pool_t* pool, void* ptr, size_t new_size, mp_copy_mode_t mode);
+static void pool_free(memory_pool_t* pool, void* ptr);
+static void* pool_calloc(memory_pool_t* pool, size_t count, size_t size, mp_copy_mode_t mode);
+static void pool_free_fixed(memory_pool_t* pool, void* ptr);
+static void* zero_reserve_pop(memory_pool_t* pool, size_t size);
+static void free_block_locked(memory_pool_t* owner, memory_block_t* block);
+static memory_block_t* grow_and_fit(memory_pool_t* pool, memory_pool_t** owner_pool, size_t size);
+static size_t release_idle_children(memory_pool_t* master, bool force);
+static size_t trim_locked(memory_pool_t* master, unsigned flags);
+static size_t segment_resident_bytes(memory_pool_t* p);
+static size_t limit_headroom(memory_pool_t* master, size_t gran);
+static size_t budget_mapped_bytes(memory_pool_t* master);
+static memory_pool_t* side_arena_owner(memory_pool_t* pool, const void* ptr);
 // RB-tree (按 size, 次键地址) 管理空闲块，O(log n) best-fit
 static void rb_insert(memory_pool_t* pool, memory_block_t* node);
 static void rb_remove(memory_pool_t* pool, memory_block_t* node);
 static memory_block_t* rb_find_best_fit(memory_pool_t* pool, size_t size, memory_pool_t** owner_pool);
-static void rb_init_node(memory_block_t* n) { n->rb_left = n->rb_right = n->rb_parent = NULL; RB_SET_RED(n); }
+// 池内链接编解码（base 取自链接所属的池：红黑树与 size-class 链用 master，空闲链用块所在段）
+static inline uintptr_t link_base(const memory_pool_t* pool) { return MP_LINK_BASE(pool); }
+static inline memory_block_t* blk_at(uintptr_t base, mp_link_t l) { return l ? (memory_block_t*)(base + l) : NULL; }
+static inline mp_link_t blk_link(uintptr_t base, const memory_block_t* b) { return b ? (mp_link_t)((uintptr_t)b - base) : 0; }
+// 堆起点 / 映射起点在本进程中的地址
+static inline char* pool_heap(const memory_pool_t* p) { return (char*)(link_base(p) + (uintptr_t)p->pool_start); }
+static inline char* pool_map(const memory_pool_t* p) {
+    if (p->seg_flags & MP_SEG_SHARED) return (char*)(link_base(p) + (uintptr_t)p->map_base); // 共享池映射起点即 link base，偏移为 0
+    return (char*)p->map_base;
+}
+static inline memory_pool_t* pool_master(memory_pool_t* p) { return p->master ? p->master : p; }
+
+// 红黑树节点访问：lb 为 master 的 link base
+#define RB_LEFT(n)            blk_at(lb, (n)->rb_left)
+#define RB_RIGHT(n)           blk_at(lb, (n)->rb_right)
+#define RB_PARENT(n)          blk_at(lb, (n)->rb_parent)
+#define RB_SET_LEFT(n, v)     ((n)->rb_left = blk_link(lb, (v)))
+#define RB_SET_RIGHT(n, v)    ((n)->rb_right = blk_link(lb, (v)))
+#define RB_SET_PARENT(n, v)   ((n)->rb_parent = blk_link(lb, (v)))
+#define RB_ROOT(pool)         blk_at(lb, (pool)->rb_root)
+#define RB_SET_ROOT(pool, v)  ((pool)->rb_root = blk_link(lb, (v)))
+
+static void rb_init_node(memory_block_t* n) { n->rb_left = n->rb_right = n->rb_parent = 0; RB_SET_RED(n); }
 
 // 旋转与修复
 static void rb_left_rotate(memory_pool_t* pool, memory_block_t* x) {
-    pool = pool->master ? pool->master : pool;
-    memory_block_t* y = x->rb_right;
+    pool = pool_master(pool);
+    const uintptr_t lb = link_base(pool);
+    memory_block_t* y = RB_RIGHT(x);
     x->rb_right = y->rb_left;
-    if (y->rb_left) y->rb_left->rb_parent = x;
+    if (RB_LEFT(y)) RB_SET_PARENT(RB_LEFT(y), x);
     y->rb_parent = x->rb_parent;
-    if (!x->rb_parent) pool->rb_root = y;
-    else if (x == x->rb_parent->rb_left) x->rb_parent->rb_left = y; else x->rb_parent->rb_right = y;
-    y->rb_left = x;
-    x->rb_parent = y;
+    memory_block_t* xp = RB_PARENT(x);
+    if (!xp) RB_SET_ROOT(pool, y);
+    else if (x == RB_LEFT(xp)) RB_SET_LEFT(xp, y); else RB_SET_RIGHT(xp, y);
+    RB_SET_LEFT(y, x);
+    RB_SET_PARENT(x, y);
 }
 static void rb_right_rotate(memory_pool_t* pool, memory_block_t* y) {
-    pool = pool->master ? pool->master : pool;
-    memory_block_t* x = y->rb_left;
+    pool = pool_master(pool);
+    const uintptr_t lb = link_base(pool);
+    memory_block_t* x = RB_LEFT(y);
     y->rb_left = x->rb_right;
-    if (x->rb_right) x->rb_right->rb_parent = y;
+    if (RB_RIGHT(x)) RB_SET_PARENT(RB_RIGHT(x), y);
     x->rb_parent = y->rb_parent;
-    if (!y->rb_parent) pool->rb_root = x;
-    else if (y == y->rb_parent->rb_left) y->rb_parent->rb_left = x; else y->rb_parent->rb_right = x;
-    x->rb_right = y; y->rb_parent = x;
+    memory_block_t* yp = RB_PARENT(y);
+    if (!yp) RB_SET_ROOT(pool, x);
+    else if (y == RB_LEFT(yp)) RB_SET_LEFT(yp, x); else RB_SET_RIGHT(yp, x);
+    RB_SET_RIGHT(x, y); RB_SET_PARENT(y, x);
 }
 static int rb_cmp(memory_block_t* a, memory_block_t* b) {
     if (a->size < b->size) return -1;
@@ -54,91 +143,95 @@ static int rb_cmp(memory_block_t* a, memory_block_t* b) {
     return 0;
 }
 static void rb_insert(memory_pool_t* pool, memory_block_t* z) {
-    pool = pool->master ? pool->master : pool;
+    pool = pool_master(pool);
+    const uintptr_t lb = link_base(pool);
     rb_init_node(z);
-    memory_block_t* y = NULL; memory_block_t* x = pool->rb_root;
-    while (x) { y = x; int c = rb_cmp(z, x); x = (c < 0) ? x->rb_left : x->rb_right; }
-    z->rb_parent = y;
-    if (!y) pool->rb_root = z;
-    else if (rb_cmp(z, y) < 0) y->rb_left = z; else y->rb_right = z;
+    memory_block_t* y = NULL; memory_block_t* x = RB_ROOT(pool);
+    while (x) { y = x; int c = rb_cmp(z, x); x = (c < 0) ? RB_LEFT(x) : RB_RIGHT(x); }
+    RB_SET_PARENT(z, y);
+    if (!y) RB_SET_ROOT(pool, z);
+    else if (rb_cmp(z, y) < 0) RB_SET_LEFT(y, z); else RB_SET_RIGHT(y, z);
     // fixup
     RB_SET_RED(z); // red
-    while (z != pool->rb_root && RB_IS_RED(z->rb_parent)) {
-        memory_block_t* p = z->rb_parent; memory_block_t* g = p->rb_parent;
+    while (z != RB_ROOT(pool) && RB_IS_RED(RB_PARENT(z))) {
+        memory_block_t* p = RB_PARENT(z); memory_block_t* g = RB_PARENT(p);
         if (!g) break;
-        if (p == g->rb_left) {
-            memory_block_t* u = g->rb_right;
+        if (p == RB_LEFT(g)) {
+            memory_block_t* u = RB_RIGHT(g);
             if (u && RB_IS_RED(u)) { RB_SET_BLACK(p); RB_SET_BLACK(u); RB_SET_RED(g); z = g; }
             else {
-                if (z == p->rb_right) { z = p; rb_left_rotate(pool, z); p = z->rb_parent; g = p? p->rb_parent:NULL; }
+                if (z == RB_RIGHT(p)) { z = p; rb_left_rotate(pool, z); p = RB_PARENT(z); g = p? RB_PARENT(p):NULL; }
                 RB_SET_BLACK(p); if (g) { RB_SET_RED(g); rb_right_rotate(pool, g); }
             }
         } else {
-            memory_block_t* u = g->rb_left;
+            memory_block_t* u = RB_LEFT(g);
             if (u && RB_IS_RED(u)) { RB_SET_BLACK(p); RB_SET_BLACK(u); RB_SET_RED(g); z = g; }
             else {
-                if (z == p->rb_left) { z = p; rb_right_rotate(pool, z); p = z->rb_parent; g = p? p->rb_parent:NULL; }
+                if (z == RB_LEFT(p)) { z = p; rb_right_rotate(pool, z); p = RB_PARENT(z); g = p? RB_PARENT(p):NULL; }
                 RB_SET_BLACK(p); if (g) { RB_SET_RED(g); rb_left_rotate(pool, g); }
             }
         }
     }
-    RB_SET_BLACK(pool->rb_root); // root black
+    RB_SET_BLACK(RB_ROOT(pool)); // root black
 }
-static memory_block_t* rb_min(memory_block_t* n) { while (n && n->rb_left) n = n->rb_left; return n; }
+static memory_block_t* rb_min(uintptr_t lb, memory_block_t* n) { while (n && RB_LEFT(n)) n = RB_LEFT(n); return n; }
 static void rb_transplant(memory_pool_t* pool, memory_block_t* u, memory_block_t* v) {
-    if (!u->rb_parent) pool->rb_root = v;
-    else if (u == u->rb_parent->rb_left) u->rb_parent->rb_left = v; else u->rb_parent->rb_right = v;
+    const uintptr_t lb = link_base(pool);
+    memory_block_t* up = RB_PARENT(u);
+    if (!up) RB_SET_ROOT(pool, v);
+    else if (u == RB_LEFT(up)) RB_SET_LEFT(up, v); else RB_SET_RIGHT(up, v);
     if (v) v->rb_parent = u->rb_parent;
 }
 static void rb_remove(memory_pool_t* pool, memory_block_t* z) {
-    pool = pool->master ? pool->master : pool;
+    pool = pool_master(pool);
+    const uintptr_t lb = link_base(pool);
     // 简单存在性检查：自 root 向下按比较寻找 z
-    memory_block_t* probe = pool->rb_root; bool found=false; while (probe) { int c=rb_cmp(z, probe); if (c==0) { if (probe==z) found=true; break; } probe = (c<0)?probe->rb_left:probe->rb_right; }
+    memory_block_t* probe = RB_ROOT(pool); bool found=false; while (probe) { int c=rb_cmp(z, probe); if (c==0) { if (probe==z) found=true; break; } probe = (c<0)?RB_LEFT(probe):RB_RIGHT(probe); }
     if (!found) { MP_LOG("rb_remove skip: node %p not in tree", (void*)z); return; }
     memory_block_t* y = z; unsigned char y_original_black = RB_IS_BLACK(y); memory_block_t* x = NULL; memory_block_t* x_parent = NULL;
-    if (!z->rb_left) { x = z->rb_right; rb_transplant(pool, z, z->rb_right); x_parent = z->rb_parent; }
-    else if (!z->rb_right) { x = z->rb_left; rb_transplant(pool, z, z->rb_left); x_parent = z->rb_parent; }
+    if (!z->rb_left) { x = RB_RIGHT(z); rb_transplant(pool, z, x); x_parent = RB_PARENT(z); }
+    else if (!z->rb_right) { x = RB_LEFT(z); rb_transplant(pool, z, x); x_parent = RB_PARENT(z); }
     else {
-    y = rb_min(z->rb_right); y_original_black = RB_IS_BLACK(y); x = y->rb_right; if (y->rb_parent == z) { if (x) x->rb_parent = y; x_parent = y; } else { rb_transplant(pool, y, y->rb_right); y->rb_right = z->rb_right; y->rb_right->rb_parent = y; x_parent = y->rb_parent; }
-    rb_transplant(pool, z, y); y->rb_left = z->rb_left; y->rb_left->rb_parent = y; if (RB_IS_RED(z)) RB_SET_RED(y); else RB_SET_BLACK(y);
+    y = rb_min(lb, RB_RIGHT(z)); y_original_black = RB_IS_BLACK(y); x = RB_RIGHT(y); if (RB_PARENT(y) == z) { if (x) RB_SET_PARENT(x, y); x_parent = y; } else { rb_transplant(pool, y, RB_RIGHT(y)); y->rb_right = z->rb_right; RB_SET_PARENT(RB_RIGHT(y), y); x_parent = RB_PARENT(y); }
+    rb_transplant(pool, z, y); y->rb_left = z->rb_left; RB_SET_PARENT(RB_LEFT(y), y); if (RB_IS_RED(z)) RB_SET_RED(y); else RB_SET_BLACK(y);
     }
     if (y_original_black) { // fix double-black
-        while ((x != pool->rb_root) && (!x || RB_IS_BLACK(x))) {
-            if (x_parent && x == x_parent->rb_left) {
-                memory_block_t* w = x_parent->rb_right;
-                if (!w) { x = x_parent; x_parent = x_parent->rb_parent; continue; }
-                if (w && RB_IS_RED(w)) { RB_SET_BLACK(w); RB_SET_RED(x_parent); rb_left_rotate(pool, x_parent); w = x_parent->rb_right; }
-                if ((!w->rb_left || RB_IS_BLACK(w->rb_left)) && (!w->rb_right || RB_IS_BLACK(w->rb_right))) { if (w) RB_SET_RED(w); x = x_parent; x_parent = x_parent->rb_parent; }
+        while ((x != RB_ROOT(pool)) && (!x || RB_IS_BLACK(x))) {
+            if (x_parent && x == RB_LEFT(x_parent)) {
+                memory_block_t* w = RB_RIGHT(x_parent);
+                if (!w) { x = x_parent; x_parent = RB_PARENT(x_parent); continue; }
+                if (w && RB_IS_RED(w)) { RB_SET_BLACK(w); RB_SET_RED(x_parent); rb_left_rotate(pool, x_parent); w = RB_RIGHT(x_parent); }
+                if ((!RB_LEFT(w) || RB_IS_BLACK(RB_LEFT(w))) && (!RB_RIGHT(w) || RB_IS_BLACK(RB_RIGHT(w)))) { if (w) RB_SET_RED(w); x = x_parent; x_parent = RB_PARENT(x_parent); }
                 else {
-                    if (!w->rb_right || RB_IS_BLACK(w->rb_right)) {
-                        if (w->rb_left) RB_SET_BLACK(w->rb_left);
+                    if (!RB_RIGHT(w) || RB_IS_BLACK(RB_RIGHT(w))) {
+                        if (RB_LEFT(w)) RB_SET_BLACK(RB_LEFT(w));
                         RB_SET_RED(w);
                         rb_right_rotate(pool, w);
-                        w = x_parent->rb_right;
+                        w = RB_RIGHT(x_parent);
                     }
                     if (w) { if (RB_IS_RED(x_parent)) RB_SET_RED(w); else RB_SET_BLACK(w); }
                     RB_SET_BLACK(x_parent);
-                    if (w && w->rb_right) RB_SET_BLACK(w->rb_right);
+                    if (w && RB_RIGHT(w)) RB_SET_BLACK(RB_RIGHT(w));
                     rb_left_rotate(pool, x_parent);
-                    x = pool->rb_root;
+                    x = RB_ROOT(pool);
                     break; }
             } else if (x_parent) {
-                memory_block_t* w = x_parent->rb_left;
-                if (!w) { x = x_parent; x_parent = x_parent->rb_parent; continue; }
-                if (w && RB_IS_RED(w)) { RB_SET_BLACK(w); RB_SET_RED(x_parent); rb_right_rotate(pool, x_parent); w = x_parent->rb_left; }
-                if ((!w->rb_left || RB_IS_BLACK(w->rb_left)) && (!w->rb_right || RB_IS_BLACK(w->rb_right))) { if (w) RB_SET_RED(w); x = x_parent; x_parent = x_parent->rb_parent; }
+                memory_block_t* w = RB_LEFT(x_parent);
+                if (!w) { x = x_parent; x_parent = RB_PARENT(x_parent); continue; }
+                if (w && RB_IS_RED(w)) { RB_SET_BLACK(w); RB_SET_RED(x_parent); rb_right_rotate(pool, x_parent); w = RB_LEFT(x_parent); }
+                if ((!RB_LEFT(w) || RB_IS_BLACK(RB_LEFT(w))) && (!RB_RIGHT(w) || RB_IS_BLACK(RB_RIGHT(w)))) { if (w) RB_SET_RED(w); x = x_parent; x_parent = RB_PARENT(x_parent); }
                 else {
-                    if (!w->rb_left || RB_IS_BLACK(w->rb_left)) {
-                        if (w->rb_right) RB_SET_BLACK(w->rb_right);
+                    if (!RB_LEFT(w) || RB_IS_BLACK(RB_LEFT(w))) {
+                        if (RB_RIGHT(w)) RB_SET_BLACK(RB_RIGHT(w));
                         RB_SET_RED(w);
                         rb_left_rotate(pool, w);
-                        w = x_parent->rb_left;
+                        w = RB_LEFT(x_parent);
                     }
                     if (w) { if (RB_IS_RED(x_parent)) RB_SET_RED(w); else RB_SET_BLACK(w); }
                     RB_SET_BLACK(x_parent);
-                    if (w && w->rb_left) RB_SET_BLACK(w->rb_left);
+                    if (w && RB_LEFT(w)) RB_SET_BLACK(RB_LEFT(w));
                     rb_right_rotate(pool, x_parent);
-                    x = pool->rb_root;
+                    x = RB_ROOT(pool);
                     break; }
             } else break;
         }
@@ -147,15 +240,16 @@ static void rb_remove(memory_pool_t* pool, memory_block_t* z) {
 }
 static memory_block_t* rb_find_best_fit(memory_pool_t* root, size_t size, memory_pool_t** owner_pool) {
     if (!root) return NULL;
-    memory_pool_t* master = root->master ? root->master : root;
-    memory_block_t* cur = master->rb_root; memory_block_t* candidate = NULL;
+    memory_pool_t* master = pool_master(root);
+    const uintptr_t lb = link_base(master);
+    memory_block_t* cur = RB_ROOT(master); memory_block_t* candidate = NULL;
     while (cur) {
         if (cur->size == size) { candidate = cur; break; }
-        if (cur->size > size) { candidate = cur; cur = cur->rb_left; } else cur = cur->rb_right;
+        if (cur->size > size) { candidate = cur; cur = RB_LEFT(cur); } else cur = RB_RIGHT(cur);
     }
     if (!candidate) return NULL;
     // 找到后需确定其所属池：通过遍历链判断地址范围
-    memory_pool_t* p = master; while (p) { if ((char*)candidate >= (char*)p->pool_start && (char*)candidate < (char*)p->pool_start + p->pool_size) { *owner_pool = p; break; } p = p->next; }
+    memory_pool_t* p = master; while (p) { if ((char*)candidate >= pool_heap(p) && (char*)candidate < pool_heap(p) + p->pool_size) { *owner_pool = p; break; } p = p->next; }
     rb_remove(master, candidate);
     candidate->flags &= ~MB_FLAG_FREE;
     return candidate;
@@ -172,6 +266,22 @@ static inline void set_error(pool_error_t error) {
     g_last_error = error;
 }
 
+// 加锁：跨进程共享池使用 robust 互斥锁，持锁进程异常退出后由下一个加锁者恢复锁的一致性
+static inline void pool_lock(memory_pool_t* pool) {
+    if (pthread_mutex_lock(&pool->mutex) == EOWNERDEAD) {
+        // 前持有者可能死在堆更新中途：先按块头校验并重建空闲结构，无法重建时标记池已损坏，
+        // 之后分配与释放一律失败（POOL_ERROR_CORRUPTION），最后才恢复锁的一致性
+        if (!pool->poisoned && !persist_recover(pool)) pool->poisoned = true;
+        pthread_mutex_consistent(&pool->mutex);
+        pool->lock_recoveries++;
+        MP_LOG("robust mutex recovered pool=%p (previous owner died)%s", (void*)pool, pool->poisoned ? ", heap poisoned" : "");
+    }
+}
+
+static inline void pool_unlock(memory_pool_t* pool) {
+    pthread_mutex_unlock(&pool->mutex);
+}
+
 // 获取最后错误
 pool_error_t memory_pool_get_last_error(void) {
     return g_last_error;
@@ -187,10 +297,276 @@ const char* memory_pool_error_string(pool_error_t error) {
         case POOL_ERROR_CORRUPTION: return "Memory corruption detected";
         case POOL_ERROR_DOUBLE_FREE: return "Double free detected";
         case POOL_ERROR_INVALID_POINTER: return "Invalid pointer";
+        case POOL_ERROR_IO: return "I/O error";
         default: return "Unknown error";
     }
 }
 
+// 单调时钟毫秒数（用于空闲子池计时）
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+// ---- 操作延迟直方图 ----
+// HDR 风格对数-线性分桶：每个 2 的幂区间再线性分 8 份（相对误差 ≤ 12.5%）。
+// 计时覆盖整个调用（含等锁），在锁外用 relaxed 原子累加；嵌套的公开调用（如 realloc 内部的 alloc/free）只计最外层
+struct mp_latency {
+    bool enabled;
+    mp_latency_histogram_t ops[MP_OP_COUNT];
+};
+
+#if MEMPOOL_LATENCY
+static __thread int g_latency_depth = 0; // 本线程正在计时的公开调用嵌套层数
+#endif
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline int latency_bucket(uint64_t ns) {
+    if (ns < 8) return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    int idx = (msb - 2) * 8 + (int)((ns >> (msb - 3)) & 7);
+    return idx < MP_LATENCY_BUCKETS ? idx : MP_LATENCY_BUCKETS - 1;
+}
+
+// 开始计时：未开启或处于嵌套调用中返回 0
+static inline uint64_t latency_begin(memory_pool_t* pool) {
+#if MEMPOOL_LATENCY
+    if (!pool || g_latency_depth) return 0;
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    struct mp_latency* lat = __atomic_load_n(&master->latency, __ATOMIC_ACQUIRE);
+    if (!lat || !__atomic_load_n(&lat->enabled, __ATOMIC_RELAXED)) return 0;
+    g_latency_depth++;
+    return now_ns();
+#else
+    (void)pool;
+    return 0;
+#endif
+}
+
+static inline void latency_end(memory_pool_t* pool, mp_op_t op, uint64_t t0) {
+#if MEMPOOL_LATENCY
+    if (!t0) return;
+    g_latency_depth--;
+    uint64_t ns = now_ns() - t0;
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    mp_latency_histogram_t* h = &master->latency->ops[op];
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total_ns, ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->buckets[latency_bucket(ns)], 1, __ATOMIC_RELAXED);
+    uint64_t cur = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > cur && !__atomic_compare_exchange_n(&h->max_ns, &cur, ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+    cur = __atomic_load_n(&h->min_ns, __ATOMIC_RELAXED);
+    while ((cur == 0 || ns < cur) && !__atomic_compare_exchange_n(&h->min_ns, &cur, ns ? ns : 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+#else
+    (void)pool; (void)op; (void)t0;
+#endif
+}
+
+// ---- 分配轨迹记录 ----
+// 记录期间每个公开调用从开始到写完记录都持有 trace 锁，文件顺序即执行顺序（地址复用不会与释放记录交错）。
+// 唯一的例外是压力回调：执行用户代码前暂时交出 trace 锁（见 trace_suspend）。
+// 指针经开放寻址表（线性探测 + 删除时后移）映射为对象编号；嵌套的公开调用只记最外层
+typedef struct mp_trace_slot {
+    uintptr_t ptr;                 // 0 = 空槽
+    uint32_t id;
+    bool request;                  // 位于 request arena（reset_requests 时失效）
+} mp_trace_slot_t;
+
+struct mp_trace {
+    pthread_mutex_t lock;
+    bool enabled;
+    bool failed;                   // 写入或扩表失败：已停止记录，stop 时报告
+    FILE* out;
+    uint64_t t0;
+    uint32_t next_id;
+    mp_trace_slot_t* slots;
+    size_t cap;                    // 2 的幂
+    size_t count;
+    uint32_t session;              // 每次 trace_start 加一：交出锁期间被停止/重开时丢弃挂起的记录
+};
+
+#define MP_TRACE_MIN_SLOTS 1024
+static __thread int g_trace_depth = 0;      // 本线程正在记录的公开调用嵌套层数
+static __thread uint32_t g_trace_thread = 0; // 本线程序号（首次记录时分配）
+static __thread struct mp_trace* g_trace_held = NULL; // 本线程当前持有锁的记录器
+static __thread mp_trace_record_t* g_trace_rec = NULL; // 本线程正在填写的记录
+static __thread bool g_trace_drop = false;  // 挂起期间记录已停止：trace_end 不写入
+static uint32_t g_trace_threads = 0;
+
+static inline size_t trace_hash(uintptr_t ptr, size_t cap) {
+    return (size_t)(((uint64_t)(ptr >> 4) * 0x9E3779B97F4A7C15ull) >> 32) & (cap - 1);
+}
+
+static size_t trace_find(struct mp_trace* tr, uintptr_t ptr) {
+    size_t i = trace_hash(ptr, tr->cap);
+    while (tr->slots[i].ptr && tr->slots[i].ptr != ptr) i = (i + 1) & (tr->cap - 1);
+    return i;
+}
+
+// 重建到 cap 个槽；drop_request 时丢弃 request arena 中的对象
+static bool trace_rehash(struct mp_trace* tr, size_t cap, bool drop_request) {
+    mp_trace_slot_t* old = tr->slots;
+    size_t old_cap = tr->cap;
+    mp_trace_slot_t* slots = calloc(cap, sizeof(*slots));
+    if (!slots) return false;
+    tr->slots = slots;
+    tr->cap = cap;
+    tr->count = 0;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!old[i].ptr || (drop_request && old[i].request)) continue;
+        tr->slots[trace_find(tr, old[i].ptr)] = old[i];
+        tr->count++;
+    }
+    free(old);
+    return true;
+}
+
+static uint32_t trace_bind(struct mp_trace* tr, void* ptr, bool request) {
+    if (!ptr) return 0;
+    if ((tr->count + 1) * 2 > tr->cap && !trace_rehash(tr, tr->cap * 2, false)) {
+        tr->failed = true;
+        return 0;
+    }
+    size_t i = trace_find(tr, (uintptr_t)ptr);
+    if (!tr->slots[i].ptr) tr->count++;
+    tr->slots[i] = (mp_trace_slot_t){ (uintptr_t)ptr, ++tr->next_id, request };
+    return tr->next_id;
+}
+
+// 查找对象编号；take 为 true 时同时删除（后继元素回填空槽，保持探测链连续）
+static uint32_t trace_lookup(struct mp_trace* tr, void* ptr, bool take) {
+    if (!ptr) return 0;
+    size_t i = trace_find(tr, (uintptr_t)ptr);
+    uint32_t id = tr->slots[i].id;
+    if (!tr->slots[i].ptr || !take) return tr->slots[i].ptr ? id : 0;
+    size_t mask = tr->cap - 1;
+    for (size_t j = (i + 1) & mask; tr->slots[j].ptr; j = (j + 1) & mask) {
+        size_t home = trace_hash(tr->slots[j].ptr, tr->cap);
+        // home 不在循环区间 (i, j] 内的元素可以前移到 i
+        bool stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (!stays) {
+            tr->slots[i] = tr->slots[j];
+            i = j;
+        }
+    }
+    tr->slots[i].ptr = 0;
+    tr->count--;
+    return id;
+}
+
+// 开始记录一次公开调用：开启时持有 trace 锁直到 trace_end；返回 NULL 表示不记录
+static struct mp_trace* trace_begin(memory_pool_t* pool, mp_trace_record_t* rec, mp_trace_op_t op, uint64_t size) {
+    if (!pool || g_trace_depth) return NULL;
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    struct mp_trace* tr = __atomic_load_n(&master->trace, __ATOMIC_ACQUIRE);
+    if (!tr || !__atomic_load_n(&tr->enabled, __ATOMIC_RELAXED)) return NULL;
+    pthread_mutex_lock(&tr->lock);
+    if (!tr->enabled) {
+        pthread_mutex_unlock(&tr->lock);
+        return NULL;
+    }
+    g_trace_depth++;
+    g_trace_held = tr;
+    g_trace_rec = rec;
+    if (!g_trace_thread) g_trace_thread = __atomic_add_fetch(&g_trace_threads, 1, __ATOMIC_RELAXED);
+    memset(rec, 0, sizeof(*rec));
+    rec->time_ns = now_ns() - tr->t0;
+    rec->thread = g_trace_thread;
+    rec->op = (uint8_t)op;
+    rec->size = size;
+    return tr;
+}
+
+// 结束记录：in 为被释放/重分配的输入指针，out 为结果指针；写入记录后释放 trace 锁
+static void trace_end(struct mp_trace* tr, memory_pool_t* pool, mp_trace_record_t* rec, void* in, void* out) {
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    g_trace_held = NULL;
+    g_trace_rec = NULL;
+    if (g_trace_drop) {
+        g_trace_drop = false;
+        g_trace_depth--;
+        pthread_mutex_unlock(&tr->lock);
+        return;
+    }
+    // realloc 失败时原对象仍然有效
+    bool consumed = rec->op == MP_TRACE_FREE || rec->op == MP_TRACE_FREE_FIXED ||
+                    (rec->op == MP_TRACE_REALLOC && (out || rec->size == 0));
+    rec->arg = trace_lookup(tr, in, consumed);
+    if (out) {
+        memory_pool_t* request = __atomic_load_n(&master->request_arena, __ATOMIC_ACQUIRE);
+        rec->id = trace_bind(tr, out, request && side_arena_owner(master, out) == request);
+    }
+    if (rec->op == MP_TRACE_RESET) {
+        memset(tr->slots, 0, tr->cap * sizeof(*tr->slots));
+        tr->count = 0;
+    } else if (rec->op == MP_TRACE_RESET_REQUESTS && !trace_rehash(tr, tr->cap, true)) {
+        tr->failed = true;
+    }
+    if (fwrite(rec, sizeof(*rec), 1, tr->out) != 1) tr->failed = true;
+    if (tr->failed) __atomic_store_n(&tr->enabled, false, __ATOMIC_RELAXED);
+    g_trace_depth--;
+    pthread_mutex_unlock(&tr->lock);
+}
+
+// 调用用户代码（压力回调）前交出本线程持有的 trace 锁：回调可能等待其他线程的受追踪调用，
+// 持锁会死锁。回调内的公开调用按最外层调用各自记录。返回挂起的记录器（未持有时为 NULL）
+typedef struct trace_suspension {
+    struct mp_trace* tr;
+    mp_trace_record_t* rec;
+    int depth;
+    uint32_t session;
+} trace_suspension_t;
+
+static trace_suspension_t trace_suspend(void) {
+    trace_suspension_t sp = { g_trace_held, g_trace_rec, g_trace_depth, 0 };
+    if (!sp.tr) return sp;
+    sp.session = sp.tr->session;
+    g_trace_held = NULL;
+    g_trace_rec = NULL;
+    g_trace_depth = 0;
+    pthread_mutex_unlock(&sp.tr->lock);
+    return sp;
+}
+
+// 重新取得 trace 锁（调用方此时不持池锁，保持先 trace 锁后池锁的顺序）。挂起的调用在回调之后
+// 才完成，记录时间改为恢复时刻，文件中仍按时间有序；记录已被停止或重开时放弃该条记录
+static void trace_resume(const trace_suspension_t* sp) {
+    if (!sp->tr) return;
+    pthread_mutex_lock(&sp->tr->lock);
+    g_trace_held = sp->tr;
+    g_trace_rec = sp->rec;
+    g_trace_depth = sp->depth;
+    if (!sp->tr->enabled || sp->tr->session != sp->session) g_trace_drop = true;
+    else sp->rec->time_ns = now_ns() - sp->tr->t0;
+}
+
+// 魔数种子：每线程 splitmix64 生成器，首次使用时由 getrandom 播种（不可用时退化到时间+地址+pid），
+// 之后每个池只需几次乘法，不再打开 /dev/urandom
+static __thread uint64_t g_seed_state = 0;
+
+static uint32_t next_magic_seed(void) {
+    if (!g_seed_state) {
+        uint64_t s = 0;
+#ifdef SYS_getrandom
+        if (syscall(SYS_getrandom, &s, sizeof(s), 0) != (long)sizeof(s)) s = 0;
+#endif
+        if (!s) s = ((uint64_t)time(NULL) << 20) ^ (uint64_t)(uintptr_t)&g_seed_state ^ ((uint64_t)getpid() << 40);
+        g_seed_state = s ? s : 0x9E3779B97F4A7C15ull;
+    }
+    uint64_t z = (g_seed_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    uint32_t seed = (uint32_t)z ^ (uint32_t)(z >> 32);
+    return seed ? seed : 0xA5A5A5A5u;
+}
+
 // 对齐大小
 static inline size_t align_size(size_t size, size_t alignment) {
     return (size + alignment - 1) & ~(alignment - 1);
@@ -216,7 +592,7 @@ static bool validate_block(memory_block_t* block) {
 // 物理后继块（可能跨越到池末尾则返回 NULL）
 static inline memory_block_t* next_physical_block(memory_pool_t* pool, memory_block_t* blk) {
     if (!blk) return NULL;
-    char* base = (char*)pool->pool_start;
+    char* base = pool_heap(pool);
     char* end  = base + pool->pool_size;
     char* next = (char*)blk + blk->size;
     if (next >= end) return NULL;
@@ -226,8 +602,10 @@ static inline memory_block_t* next_physical_block(memory_pool_t* pool, memory_bl
 // 在 free_blk 已经是自由块后，设置其后继块的 PREV_FREE 元数据
 static inline void set_next_prev_free(memory_pool_t* pool, memory_block_t* free_blk) {
     memory_block_t* nxt = next_physical_block(pool, free_blk);
-    if (!nxt) return;
-    // 只有在后继块不是空闲列表中的 size-class 专属块时才安全；暂未区分，保持通用逻辑
+    // 空闲块与 size-class 块的 u 用作空闲链 next 链接，写入 prev_size 会截断链表：
+    // 前者自身不需要该标记（分配时清除），后者不参与通用合并（交还通用堆时同样清除 PREV_FREE）。
+    // 相邻的两个通用空闲块可能存在（如 shrink_class_reserves 交还的块不做反向合并）
+    if (!nxt || (nxt->flags & (MB_FLAG_FREE | MB_FLAG_SIZECLASS))) return;
     nxt->flags |= MB_FLAG_PREV_FREE;
     // prev_size 仅在后继块“当前不在通用 free_list”或者需要反向合并时使用
     nxt->u.prev_size = free_blk->size; // size_t 记录完整大小
@@ -243,15 +621,17 @@ static inline void clear_next_prev_free(memory_pool_t* pool, memory_block_t* blk
 static void remove_free_block(memory_pool_t* pool, memory_block_t* block) {
     if (!pool->free_list || !block) return;
     memory_pool_t* master = pool->master ? pool->master : pool;
+    const uintptr_t lb = link_base(pool);
+    const mp_link_t target = blk_link(lb, block);
     MP_ASSERT(block->flags & MB_FLAG_FREE, "remove_free_block: block not marked FREE");
-    if (pool->free_list == block) {
+    if (pool->free_list == target) {
         pool->free_list = block->u.next;
         if (block->flags & MB_FLAG_FREE) rb_remove(master, block);
         return;    
     }
-    memory_block_t* cur = pool->free_list;
-    while (cur->u.next && cur->u.next != block) cur = cur->u.next;
-    if (cur->u.next == block) {
+    memory_block_t* cur = blk_at(lb, pool->free_list);
+    while (cur->u.next && cur->u.next != target) cur = blk_at(lb, cur->u.next);
+    if (cur->u.next == target) {
         cur->u.next = block->u.next;
         if (block->flags & MB_FLAG_FREE) rb_remove(master, block);
     } else {
@@ -267,7 +647,25 @@ memory_pool_t* memory_pool_create(size_t pool_size, bool thread_safe) {
         .alignment = DEFAULT_ALIGNMENT,
         .enable_size_classes = false,
         .size_class_sizes = NULL,
-        .num_size_classes = 0
+        .num_size_classes = 0,
+        .release_idle_children = false,
+        .child_idle_ms = 0,
+        .huge_pages = MP_HUGE_PAGES_NONE,
+        .reserve_size = 0,
+        .populate = false,
+        .lock_memory = false,
+        .lock_required = false,
+        .packed_size_classes = false,
+        .adaptive_sizing = false,
+        .memfd_growth = false,
+        .numa_policy = MP_NUMA_NONE,
+        .numa_node = 0,
+        .numa_arenas = false,
+        .soft_limit = 0,
+        .hard_limit = 0,
+        .streaming_threshold = 0,
+        .cold = false,
+        .record_latency = false
     };
     return memory_pool_create_with_config(&config);
 }
@@ -279,71 +677,170 @@ memory_pool_t* memory_pool_create_with_config(const pool_config_t* config) {
         return NULL;
     }
 
+    // 启用节点 arena 时 master 本身固定在 numa_node 上
+    pool_config_t numa_cfg;
+    if (config->numa_arenas && config->numa_policy == MP_NUMA_NONE) {
+        numa_cfg = *config;
+        numa_cfg.numa_policy = MP_NUMA_BIND;
+        config = &numa_cfg;
+    }
+
+    // 冷数据池：段需能被整体 MADV_COLD / MADV_PAGEOUT，大页、锁定与预缺页均与之冲突
+    pool_config_t cold_cfg;
+    if (config->cold && (config->huge_pages != MP_HUGE_PAGES_NONE || config->lock_memory || config->populate)) {
+        cold_cfg = *config;
+        cold_cfg.huge_pages = MP_HUGE_PAGES_NONE;
+        cold_cfg.lock_memory = false;
+        cold_cfg.lock_required = false;
+        cold_cfg.populate = false;
+        config = &cold_cfg;
+    }
+
     if (!is_power_of_two(config->alignment)) {
         set_error(POOL_ERROR_INVALID_SIZE);
         return NULL;
     }
+    // hugetlb 页无法在预留区内按需提交：拒绝该组合，而不是静默退化为透明大页
+    if (config->huge_pages == MP_HUGE_PAGES_EXPLICIT && config->reserve_size > config->pool_size) {
+        MP_LOG("reserve_size cannot be combined with MP_HUGE_PAGES_EXPLICIT");
+        set_error(POOL_ERROR_INVALID_SIZE);
+        return NULL;
+    }
 
-    memory_pool_t* pool = malloc(sizeof(memory_pool_t));
-    if (!pool) {
+    // 优先复用段缓存；否则用mmap分配大块内存，获得更好的性能（按页或大页对齐）
+    size_t aligned_size = config->pool_size;
+    size_t reserved = 0;
+    uint32_t seg_flags = 0;
+    int fd = -1;
+    char* heap = segment_cache_take(config, &aligned_size, &seg_flags);
+    bool reused = heap != NULL;
+    if (!heap) heap = segment_map(config, &aligned_size, &reserved, &seg_flags, &fd);
+    if (!heap) {
         set_error(POOL_ERROR_OUT_OF_MEMORY);
         return NULL;
     }
 
-    // 确保池大小按页对齐
-    size_t aligned_size = align_size(config->pool_size, PAGE_SIZE);
-
-    // 使用mmap分配大块内存，获得更好的性能
-    pool->pool_start = mmap(NULL, aligned_size, 
-                           PROT_READ | PROT_WRITE,
-                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-
-    if (pool->pool_start == MAP_FAILED) {
-        free(pool);
+    // 池结构体放在段头页内；hugetlb 段没有段头，仍单独分配
+    memory_pool_t* pool;
+    if (seg_flags & MP_SEG_EMBEDDED) {
+        pool = (memory_pool_t*)(heap - MP_SEG_HEADER_SIZE);
+        memset(pool, 0, sizeof(*pool)); // 复用段的段头残留上一个池的字段
+        pool->map_base = pool;
+        pool->map_size = MP_SEG_HEADER_SIZE + (reserved ? reserved : aligned_size);
+    } else {
+        pool = malloc(sizeof(memory_pool_t));
+        if (!pool) {
+            segment_unmap_raw(heap, aligned_size, reserved, seg_flags);
+            set_error(POOL_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+        pool->map_base = NULL;
+        pool->map_size = 0;
+    }
+    pool->pool_start = heap;
+    pool->pool_size = aligned_size;
+    pool->reserved_size = reserved;
+    pool->seg_flags = seg_flags;
+    pool->fd = fd;
+    if (!pool_init(pool, config)) {
+        segment_unmap_raw(heap, aligned_size, reserved, seg_flags);
+        if (fd >= 0) close(fd);
+        if (!(seg_flags & MP_SEG_EMBEDDED)) free(pool);
         set_error(POOL_ERROR_OUT_OF_MEMORY);
         return NULL;
     }
+    if (reused) {
+        // 复用段已被写过：不再有已知为零的区间
+        pool->fresh_offset = pool->pool_size;
+        if (config->populate && !(seg_flags & MP_SEG_LOCKED)) prefault_range(heap, aligned_size, false);
+    }
+    if (config->record_latency) memory_pool_latency_enable(pool, true);
 
-    pool->pool_size = aligned_size;
+    set_error(POOL_OK);
+    return pool;
+}
+
+static bool shared_mutex_init(memory_pool_t* pool) {
+    if (!(pool->seg_flags & MP_SEG_SHARED)) {
+        return pthread_mutex_init(&pool->mutex, NULL) == 0;
+    }
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr) != 0) return false;
+    bool ok = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) == 0 &&
+              pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) == 0 &&
+              pthread_mutex_init(&pool->mutex, &attr) == 0;
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+}
+
+// 初始化池结构与堆：调用方已设置 pool_start / pool_size / seg_flags / reserved_size 及映射信息
+//（共享池还需先设置 self_offset，pool_start / map_base 为相对映射起点的偏移）。
+// 仅互斥锁初始化可能失败。
+static bool pool_init(memory_pool_t* pool, const pool_config_t* config) {
     pool->used_size = 0;
     pool->alignment = config->alignment;
     pool->thread_safe = config->thread_safe;
     pool->num_classes = 0;
+    pool->slab_spans = 0;
+    pool->budget = NULL;
+    pool->mapped_bytes = pool->pool_size;
+    pool->seg_serial = 0;
+    pool->seg_serials = 0;
     pool->next = NULL;
-    pool->master = pool; // self master
-    // 初始化随机种子（优先使用 /dev/urandom，退化到时间+地址）
-    {
-        uint32_t seed = 0;
-        FILE* rf = fopen("/dev/urandom", "rb");
-        if (rf) {
-            if (fread(&seed, 1, sizeof(seed), rf) != sizeof(seed)) seed = 0;
-            fclose(rf);
-        }
-        if (seed == 0) {
-            seed = (uint32_t)time(NULL) ^ (uint32_t)(uintptr_t)pool ^ (uint32_t)getpid();
-        }
-        pool->magic_seed = seed ? seed : 0xA5A5A5A5u;
+    if (pool->seg_flags & MP_SEG_SHARED) {
+        pool->master = NULL; // 共享结构体中不能保存进程内地址；pool_master() 视 NULL 为自身
+    } else {
+        pool->self_offset = (uintptr_t)pool; // link base 为 0：链接即地址
+        pool->master = pool; // self master
     }
+    pool->config = *config;
+    pool->config.pool_size = pool->pool_size;
+    pool->config.size_class_sizes = NULL; // 不持有调用方数组
+    pool->config.num_size_classes = 0;
+    pool->idle_since_ms = 0;
+    pool->idle_children = 0;
+    pool->fresh_offset = 0; // 新映射全为零，仅初始块头已写入
+    memset(&pool->profile, 0, sizeof(pool->profile));
+    pool->heap_frees = 0;
+    pool->merge_sweeps = 0;
+    pool->class_fallbacks = 0;
+    memset(pool->numa_arenas, 0, sizeof(pool->numa_arenas));
+    pool->pressure_cb = NULL;
+    pool->pressure_user = NULL;
+    pool->in_pressure_cb = false;
+    pool->monitor = NULL;
+    memset(pool->zero_reserves, 0, sizeof(pool->zero_reserves));
+    pool->num_zero_reserves = 0;
+    pool->zero_reserve_hits = 0;
+    pool->zero_reserve_misses = 0;
+    pool->zero_refiller = NULL;
+    pool->reset_gen = 0;
+    pool->zero_refills = 0;
+    pool->latency = NULL;
+    pool->trace = NULL;
+    pool->cold_arena = NULL;
+    pool->short_arena = NULL;
+    pool->request_arena = NULL;
+    pool->arena_hint = MP_HINT_NONE;
+    pool->profile.peak_mapped = pool->pool_size;
+    pool->magic_seed = next_magic_seed();
 
-    // 初始化互斥锁
-    if (pool->thread_safe) {
-        if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
-            munmap(pool->pool_start, pool->pool_size);
-            free(pool);
-            set_error(POOL_ERROR_OUT_OF_MEMORY);
-            return NULL;
-        }
+    pool->lock_recoveries = 0;
+    pool->poisoned = false;
+    // 初始化互斥锁（跨进程共享段使用 PROCESS_SHARED + ROBUST）
+    if (pool->thread_safe && !shared_mutex_init(pool)) {
+        return false;
     }
 
     // 初始化空闲链表 - 整个池作为一个大的空闲块
-    memory_block_t* initial_block = (memory_block_t*)pool->pool_start;
-    initial_block->u.next = NULL;
+    memory_block_t* initial_block = (memory_block_t*)pool_heap(pool);
+    initial_block->u.next = 0;
     initial_block->size = pool->pool_size;
     initial_block->magic = MP_MAKE_BLOCK_MAGIC(pool, initial_block);
     initial_block->flags = MB_FLAG_FREE;
-    initial_block->rb_left = initial_block->rb_right = initial_block->rb_parent = NULL; RB_SET_BLACK(initial_block); // root black
-    pool->free_list = initial_block;
-    pool->rb_root = initial_block; // only master uses
+    rb_init_node(initial_block); RB_SET_BLACK(initial_block); // root black
+    pool->free_list = blk_link(link_base(pool), initial_block);
+    pool->rb_root = pool->free_list; // only master uses
     MP_LOG("create pool %p size=%zu align=%u", (void*)pool, pool->pool_size, pool->alignment);
 
     // 初始化固定大小池
@@ -355,210 +852,1132 @@ memory_pool_t* memory_pool_create_with_config(const pool_config_t* config) {
             // 记录用户尺寸阈值
             pool->class_sizes[i] = config->size_class_sizes[i];
             // 注意：block_size 存储内部使用的“对齐后且含头部”的块大小，
-            // 以便 free_fixed 能够用 block->size 做精确匹配。
-            pool->size_classes[i].block_size = align_size(config->size_class_sizes[i] + sizeof(memory_block_t), pool->alignment);
-            pool->size_classes[i].free_blocks = NULL;
+            // 以便 free_fixed 能够用 block->size 做精确匹配；紧凑布局下为无头部的对象步长。
+            pool->size_classes[i].block_size = config->packed_size_classes
+                ? align_size(config->size_class_sizes[i], pool->alignment)
+                : align_size(config->size_class_sizes[i] + sizeof(memory_block_t), pool->alignment);
+            pool->size_classes[i].slabs = NULL;
+            pool->size_classes[i].free_blocks = 0;
             pool->size_classes[i].block_count = 0;
             pool->size_classes[i].used_count = 0;
+            pool->size_classes[i].hits = 0;
+            pool->size_classes[i].misses = 0;
         }
         pool->num_classes = classes_to_add;
     }
-
-    set_error(POOL_OK);
-    return pool;
-}
-
-// 创建子池（至少 min_size，向上取整到页）
-static memory_pool_t* create_child_pool(memory_pool_t* root, size_t min_size) {
-    pool_config_t cfg = {
-        .pool_size = (min_size < root->pool_size) ? root->pool_size : min_size,
-        .thread_safe = root->thread_safe,
-        .alignment = root->alignment,
-        .enable_size_classes = false,
-        .size_class_sizes = NULL,
-        .num_size_classes = 0
-    };
-    memory_pool_t* child = memory_pool_create_with_config(&cfg);
-    if (!child) return NULL;
-    // 子池继承 master，不自建 rb_root
-    memory_pool_t* master = root->master ? root->master : root;
-    child->master = master;
-    // 原创建函数把自身 initial_block 设为 rb_root，需要转接到 master 的树
-    memory_block_t* initial_block = (memory_block_t*)child->pool_start;
-    // 清理其 rb 链接后插入 master
-    initial_block->rb_left = initial_block->rb_right = initial_block->rb_parent = NULL;
-    RB_SET_RED(initial_block); // will be recolored in insert
-    child->rb_root = NULL;
-    rb_insert(master, initial_block);
-    // 挂到链尾
-    memory_pool_t* p = root;
-    while (p->next) p = p->next;
-    p->next = child;
-    return child;
+    return true;
 }
 
-// 链式查找最佳适配块，返回块与其所属池
-static memory_block_t* find_best_fit_chain(memory_pool_t* root, memory_pool_t** owner_pool, size_t size) {
-    memory_block_t* blk = rb_find_best_fit(root, size, owner_pool);
-    if (!blk) return NULL; // 仅使用红黑树，不再线性回退
-    memory_pool_t* p = *owner_pool;
-    memory_block_t* cur = p->free_list; memory_block_t* prev = NULL;
-    while (cur) { if (cur == blk) { if (prev) prev->u.next = cur->u.next; else p->free_list = cur->u.next; break; } prev = cur; cur = cur->u.next; }
-    MP_LOG("best-fit(rb) from %p blk=%p size=%zu", (void*)*owner_pool, (void*)blk, (size_t)blk->size);
-    return blk;
+// 段映射的粒度：大页模式按 2 MiB，否则按页
+static inline size_t segment_granularity(const pool_config_t* cfg) {
+    return cfg->huge_pages == MP_HUGE_PAGES_NONE ? PAGE_SIZE : MP_HUGE_PAGE_SIZE;
 }
 
-static bool pool_contains(memory_pool_t* pool, void* ptr) {
-    return (char*)ptr >= (char*)pool->pool_start && 
-           (char*)ptr < (char*)pool->pool_start + pool->pool_size;
+static inline size_t segment_header_size(uint32_t seg_flags) {
+    return (seg_flags & MP_SEG_EMBEDDED) ? MP_SEG_HEADER_SIZE : 0;
 }
 
-// 销毁内存池
-void memory_pool_destroy(memory_pool_t* pool) {
-    if (!pool) return;
-    memory_pool_t* p = pool;
-    while (p) {
-        memory_pool_t* next = p->next;
-        if (p->thread_safe) {
-            pthread_mutex_destroy(&p->mutex);
-        }
-        munmap(p->pool_start, p->pool_size);
-        free(p);
-        p = next;
+// 映射匿名区间 [返回值 - lead, 返回值 + len)，返回值按 align 对齐；
+// align > PAGE_SIZE 时多映射一段再裁掉首尾以满足对齐
+static char* map_aligned(size_t lead, size_t len, size_t align, int prot, int extra_flags) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | extra_flags;
+    if (align <= PAGE_SIZE) {
+        char* raw = mmap(NULL, lead + len, prot, flags, -1, 0);
+        return raw == MAP_FAILED ? NULL : raw + lead;
     }
+    char* raw = mmap(NULL, lead + len + align, prot, flags, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    char* addr = (char*)align_size((uintptr_t)raw + lead, align);
+    size_t head = (size_t)(addr - lead - raw);
+    size_t tail = align - head;
+    if (head) munmap(raw, head);
+    if (tail) munmap(addr + len, tail);
+    return addr;
 }
 
-// 分配内存
-void* memory_pool_alloc(memory_pool_t* pool, size_t size) {
-    if (!pool || size == 0) {
-        set_error(POOL_ERROR_INVALID_SIZE);
-        return NULL;
-    }
-
-    // 内存对齐
-    size_t aligned_size = align_size(size + sizeof(memory_block_t), pool->alignment);
-    
-    // 确保最小块大小
-    if (aligned_size < MIN_BLOCK_SIZE) {
-        aligned_size = MIN_BLOCK_SIZE;
-    }
-
-    if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
-    }
+// 映射池段：按大页策略决定对齐与映射方式，返回堆起点，*size 输入期望尺寸、输出实际可用（已提交）尺寸。
+// 配置了 reserve_size 时先以 PROT_NONE + MAP_NORESERVE 预留整段虚拟地址，仅提交前 *size 字节，
+// *reserved 输出预留总长度（非预留模式为 0）。
+// 除显式大页外，堆前附带一页段头（MP_SEG_EMBEDDED）用于嵌入池结构体，堆本身仍按粒度对齐。
+// memfd_growth 模式下段为 memfd 的 MAP_PRIVATE | MAP_FIXED 映射，*fd 输出该 memfd（其余模式为 -1）。
+// 用私有映射是有意的：memfd 只提供一个可 ftruncate + mremap 延长的映射对象，堆页仍是匿名 COW 页，
+// 因此修剪与零页标记（MB_FLAG_ZEROED）可沿用 MADV_DONTNEED（丢弃后读出文件空洞即零），
+// 共享映射则需 MADV_REMOVE 打洞；fork 语义也与匿名段一致，子进程得到副本而非同一份堆。
+static void* segment_map_pages(const pool_config_t* cfg, size_t* size, size_t* reserved, uint32_t* seg_flags, int* fd) {
+    *seg_flags = 0;
+    *reserved = 0;
+    *fd = -1;
+    size_t gran = segment_granularity(cfg);
+    size_t len = align_size(*size, gran);
+    const size_t lead = MP_SEG_HEADER_SIZE;
 
-    memory_pool_t* owner = pool;
-    memory_block_t* block = find_best_fit_chain(pool, &owner, aligned_size);
-    if (!block) {
-        // 先尝试在整条链上整理合并空闲块，再次尝试分配
-        memory_pool_t* p = pool;
-        while (p) { merge_free_blocks(p); p = p->next; }
-        owner = pool;
-        block = find_best_fit_chain(pool, &owner, aligned_size);
-    }
-    if (!block) {
-        // 仍不足，则创建子池
-        if (pool->thread_safe) {
-            pthread_mutex_unlock(&pool->mutex);
-        }
-        memory_pool_t* child = create_child_pool(pool, aligned_size);
-        if (!child) {
-            set_error(POOL_ERROR_OUT_OF_MEMORY);
+    if (cfg->memfd_growth && !cfg->reserve_size) {
+        // memfd 段：扩展时 ftruncate + mremap（不带 MREMAP_MAYMOVE）原地延长；按页粒度，不使用大页
+        len = align_size(*size, PAGE_SIZE);
+        int mfd = memfd_create("libmempool-seg", MFD_CLOEXEC);
+        if (mfd < 0) return NULL;
+        if (ftruncate(mfd, (off_t)(lead + len)) != 0) {
+            close(mfd);
             return NULL;
         }
-        if (pool->thread_safe) {
-            pthread_mutex_lock(&pool->mutex);
+        // 段后预留 PROT_NONE 地址空间：mmap 自顶向下分配，紧邻段尾的地址通常已被占用，
+        // 不预留则 mremap 原地延长几乎总会失败
+        size_t headroom = len * MP_MEMFD_HEADROOM_FACTOR;
+        char* base = mmap(NULL, lead + len + headroom, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base == MAP_FAILED) {
+            close(mfd);
+            return NULL;
         }
-        owner = child;
-        block = find_best_fit_chain(child, &owner, aligned_size);
-        if (!block) {
-            if (pool->thread_safe) pthread_mutex_unlock(&pool->mutex);
-            set_error(POOL_ERROR_OUT_OF_MEMORY);
+        // 私有映射：写入落在匿名 COW 页，memfd 本身始终是空洞文件，只用来提供可延长的映射；
+        // fork 后不与子进程共享，MADV_DONTNEED 回落到文件空洞（读出为零）
+        if (mmap(base, lead + len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, mfd, 0) == MAP_FAILED) {
+            munmap(base, lead + len + headroom);
+            close(mfd);
             return NULL;
         }
+        *fd = mfd;
+        *seg_flags |= MP_SEG_MEMFD | MP_SEG_EMBEDDED;
+        *reserved = len + headroom; // 堆可延伸到的总长度，与预留模式一致
+        *size = len;
+        return base + lead;
     }
 
-    // 分割大块（避免内部碎片）
-    size_t remaining_size = block->size - aligned_size;
-    if (remaining_size >= MIN_BLOCK_SIZE) {
-        memory_block_t* new_block = (memory_block_t*)((char*)block + aligned_size);
-    new_block->size = remaining_size;
-    new_block->magic = MP_MAKE_BLOCK_MAGIC(owner, new_block);
-    new_block->flags = 0; // will be set FREE by insert_free_block
-    new_block->u.next = NULL;
-        block->size = aligned_size;
-    insert_free_block(owner, new_block); // 插入全局结构 (包含 RB)
-    set_next_prev_free(owner, new_block); // 更新其后继 PREV_FREE
-    new_block->flags &= ~MB_FLAG_PREV_FREE; // 前驱为已分配块
-    } else {
-        // 没有剩余自由块，清除后继块 PREV_FREE（前驱变为已分配）
-        clear_next_prev_free(owner, block);
+    if (cfg->reserve_size > len) {
+        // 预留模式（显式大页已在创建时拒绝）：大页策略下按透明大页粒度预留
+        size_t rlen = align_size(cfg->reserve_size, gran);
+        char* addr = map_aligned(lead, rlen, gran, PROT_NONE, MAP_NORESERVE);
+        if (!addr) return NULL;
+        if (mprotect(addr - lead, lead + len, PROT_READ | PROT_WRITE) != 0) {
+            munmap(addr - lead, lead + rlen);
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        if (gran == MP_HUGE_PAGE_SIZE && madvise(addr, rlen, MADV_HUGEPAGE) == 0) *seg_flags |= MP_SEG_THP;
+#endif
+        *seg_flags |= MP_SEG_RESERVED | MP_SEG_EMBEDDED;
+        *reserved = rlen;
+        *size = len;
+        return addr;
     }
-    block->flags &= ~MB_FLAG_FREE; // 已分配
 
-    owner->used_size += block->size;
-    MP_LOG("alloc pool=%p user=%p size=%zu (blk=%zu)", (void*)owner, (void*)((char*)block + sizeof(memory_block_t)), (size_t)(aligned_size - sizeof(memory_block_t)), (size_t)block->size);
+    if (cfg->huge_pages == MP_HUGE_PAGES_NONE) {
+        void* addr = map_aligned(lead, len, PAGE_SIZE, PROT_READ | PROT_WRITE, 0);
+        if (addr) {
+            *size = len;
+            *seg_flags |= MP_SEG_EMBEDDED;
+        }
+        return addr;
+    }
 
-    if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+#ifdef MAP_HUGETLB
+    if (cfg->huge_pages == MP_HUGE_PAGES_EXPLICIT) {
+        int huge_flags = MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+        huge_flags |= MAP_HUGE_2MB;
+#endif
+        // hugetlb 段只能整大页映射，不附带段头（池结构体仍单独分配）
+        void* addr = map_aligned(0, len, PAGE_SIZE, PROT_READ | PROT_WRITE, huge_flags);
+        if (addr) {
+            *size = len;
+            *seg_flags |= MP_SEG_HUGETLB;
+            return addr;
+        }
+        // 大页池未预留（nr_hugepages 为 0）等情况：回退到透明大页
+        MP_LOG("MAP_HUGETLB failed for %zu bytes, falling back to THP", len);
     }
+#endif
+    // 透明大页需先 MADV_HUGEPAGE 再缺页
+    char* addr = map_aligned(lead, len, MP_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, 0);
+    if (!addr) return NULL;
+#ifdef MADV_HUGEPAGE
+    if (madvise(addr, len, MADV_HUGEPAGE) == 0) *seg_flags |= MP_SEG_THP;
+#endif
+    *seg_flags |= MP_SEG_EMBEDDED;
+    *size = len;
+    return addr;
+}
 
-    set_error(POOL_OK);
-    return (char*)block + sizeof(memory_block_t);
+// 按配置 mlock 段内新提交的区间：成功返回 true；失败时若 lock_required 返回 false，否则记录日志后退化为普通内存
+static bool segment_lock_range(const pool_config_t* cfg, void* addr, size_t len, bool* locked) {
+    *locked = false;
+    if (!cfg->lock_memory) return true;
+    if (mlock(addr, len) == 0) {
+        *locked = true;
+        return true;
+    }
+    MP_LOG("mlock %zu bytes failed (errno=%d)%s", len, errno, cfg->lock_required ? "" : ", continuing unlocked");
+    return !cfg->lock_required;
 }
 
-// 对齐分配：通过在链上寻找足够大的块，切分出对齐后的使用块，并将前后余留重新挂回空闲链
-void* memory_pool_alloc_aligned(memory_pool_t* pool, size_t size, size_t alignment) {
-    if (!pool || size == 0 || !is_power_of_two(alignment)) {
-        set_error(POOL_ERROR_INVALID_SIZE);
+// 映射池段，依次施加 NUMA 策略、锁定常驻与预缺页（段头一并处理）：
+// 页面在策略生效后才首次缺页，落在策略指定的节点上。参数语义同 segment_map_pages
+static void* segment_map(const pool_config_t* cfg, size_t* size, size_t* reserved, uint32_t* seg_flags, int* fd) {
+    char* addr = segment_map_pages(cfg, size, reserved, seg_flags, fd);
+    if (!addr) return NULL;
+    size_t lead = segment_header_size(*seg_flags);
+    if (numa_apply_policy(cfg, addr - lead, lead + (*reserved ? *reserved : *size))) *seg_flags |= MP_SEG_NUMA;
+    if (cfg->cold) *seg_flags |= MP_SEG_COLD;
+    bool locked;
+    if (!segment_lock_range(cfg, addr - lead, lead + *size, &locked)) {
+        segment_unmap_raw(addr, *size, *reserved, *seg_flags);
+        if (*fd >= 0) close(*fd);
+        *fd = -1;
         return NULL;
     }
+    if (locked) *seg_flags |= MP_SEG_LOCKED;
+    else if (cfg->populate) prefault_range(addr - lead, lead + *size, false);
+    return addr;
+}
 
-    // 使用块总大小（包含头部），并按池对齐
-    size_t used_total = align_size(size + sizeof(memory_block_t), pool->alignment);
-    // 需要预留最多 alignment 字节作为前缀填充
-    size_t min_needed = used_total + alignment;
+// 按段属性解除整段映射（含段头与预留区）
+static void segment_unmap_raw(void* heap, size_t size, size_t reserved, uint32_t seg_flags) {
+    size_t lead = segment_header_size(seg_flags);
+    munmap((char*)heap - lead, lead + (reserved ? reserved : size));
+}
 
-    if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
-    }
+// ---- NUMA ----
+// 直接使用 mbind / getcpu 系统调用，不依赖 libnuma
+#define MP_MPOL_PREFERRED   1
+#define MP_MPOL_BIND        2
+#define MP_MPOL_INTERLEAVE  3
+#define MP_NUMA_NODE_REFRESH 256   // 线程所在节点缓存的刷新周期（分配次数）
 
-    memory_pool_t* owner = pool;
-    memory_block_t* block = find_best_fit_chain(pool, &owner, min_needed);
-    if (!block) {
-        // 先在整条链上合并空闲块再试一次
-        memory_pool_t* p = pool;
-        while (p) { merge_free_blocks(p); p = p->next; }
-        owner = pool;
-        block = find_best_fit_chain(pool, &owner, min_needed);
-    }
-    if (!block) {
-        // 仍无则创建子池后重试
-        if (pool->thread_safe) pthread_mutex_unlock(&pool->mutex);
-        memory_pool_t* child = create_child_pool(pool, min_needed);
-        if (!child) { set_error(POOL_ERROR_OUT_OF_MEMORY); return NULL; }
-        if (pool->thread_safe) pthread_mutex_lock(&pool->mutex);
-        owner = child;
-        block = find_best_fit_chain(child, &owner, min_needed);
-        if (!block) {
-            if (pool->thread_safe) pthread_mutex_unlock(&pool->mutex);
-            set_error(POOL_ERROR_OUT_OF_MEMORY);
-            return NULL;
+static int g_numa_nodes = 0;       // 0 = 尚未探测
+static __thread int g_thread_node = -1;
+static __thread unsigned g_thread_node_age = 0;
+
+// 在线节点数：/sys/devices/system/node/online（形如 "0"、"0-1"、"0,2-3"）的最大编号 + 1
+int memory_pool_numa_node_count(void) {
+    int n = __atomic_load_n(&g_numa_nodes, __ATOMIC_RELAXED);
+    if (n) return n;
+    n = 1;
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    if (f) {
+        char buf[256];
+        if (fgets(buf, sizeof(buf), f)) {
+            long max = 0;
+            for (char* q = buf; *q;) {
+                if (*q >= '0' && *q <= '9') {
+                    long v = strtol(q, &q, 10);
+                    if (v > max) max = v;
+                } else {
+                    q++;
+                }
+            }
+            n = (int)max + 1;
         }
+        fclose(f);
     }
+    if (n > MP_NUMA_MAX_NODES) n = MP_NUMA_MAX_NODES;
+    __atomic_store_n(&g_numa_nodes, n, __ATOMIC_RELAXED);
+    return n;
+}
 
-    // 计算对齐后的用户指针与对齐块头位置
-    char* raw = (char*)block;
-    char* user_min = raw + sizeof(memory_block_t);
-    uintptr_t aligned_user_addr = align_size((uintptr_t)user_min, alignment);
-    memory_block_t* aligned_block = (memory_block_t*)((char*)aligned_user_addr - sizeof(memory_block_t));
+// 对区间施加配置的 NUMA 策略，成功返回 true。单节点上 INTERLEAVE/LOCAL 无意义直接跳过；
+// 节点号越界、内核不支持或无权限时记录日志后按无策略继续
+static bool numa_apply_policy(const pool_config_t* cfg, void* addr, size_t len) {
+#ifdef SYS_mbind
+    if (cfg->numa_policy == MP_NUMA_NONE) return false;
+    int nodes = memory_pool_numa_node_count();
+    unsigned long mask = 0;
+    int mode;
+    switch (cfg->numa_policy) {
+    case MP_NUMA_BIND:
+    case MP_NUMA_PREFERRED:
+        if (cfg->numa_node < 0 || cfg->numa_node >= nodes) return false;
+        mode = cfg->numa_policy == MP_NUMA_BIND ? MP_MPOL_BIND : MP_MPOL_PREFERRED;
+        mask = 1UL << cfg->numa_node;
+        break;
+    case MP_NUMA_INTERLEAVE:
+        if (nodes <= 1) return false;
+        mode = MP_MPOL_INTERLEAVE;
+        mask = (1UL << nodes) - 1;
+        break;
+    case MP_NUMA_LOCAL:
+        if (nodes <= 1) return false;
+        mode = MP_MPOL_PREFERRED; // 空节点掩码的 PREFERRED 即本地分配
+        break;
+    default:
+        return false;
+    }
+    if (syscall(SYS_mbind, addr, len, mode, mask ? &mask : NULL, (unsigned long)(sizeof(mask) * 8), 0) != 0) {
+        MP_LOG("mbind mode=%d mask=%lx failed (errno=%d), continuing without policy", mode, mask, errno);
+        return false;
+    }
+    return true;
+#else
+    (void)cfg; (void)addr; (void)len;
+    return false;
+#endif
+}
 
-    // 确保前缀块大小要么为0要么 >= MIN_BLOCK_SIZE；不足则前移到下一个对齐位置
-    size_t prefix = (size_t)((char*)aligned_block - raw);
-    if (prefix > 0 && prefix < MIN_BLOCK_SIZE) {
-        uintptr_t bumped = align_size((uintptr_t)user_min + (MIN_BLOCK_SIZE - prefix), alignment);
-        aligned_block = (memory_block_t*)((char*)bumped - sizeof(memory_block_t));
-        prefix = (size_t)((char*)aligned_block - raw);
+// 调用线程当前所在节点（按 MP_NUMA_NODE_REFRESH 次分配刷新一次，线程迁移后随之更新）
+static int numa_current_node(void) {
+    if (g_thread_node < 0 || ++g_thread_node_age >= MP_NUMA_NODE_REFRESH) {
+        unsigned cpu = 0, node = 0;
+#ifdef SYS_getcpu
+        if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) node = 0;
+#endif
+        g_thread_node = node < MP_NUMA_MAX_NODES ? (int)node : 0;
+        g_thread_node_age = 0;
+    }
+    return g_thread_node;
+}
+
+// 附属 arena：0..MP_NUMA_MAX_NODES-1 为节点 arena，其后依次为冷数据、短生命周期、请求作用域 arena
+#define MP_SIDE_ARENAS (MP_NUMA_MAX_NODES + 3)
+
+static inline memory_pool_t** side_arena_slot(memory_pool_t* master, int i) {
+    switch (i - MP_NUMA_MAX_NODES) {
+    case 0: return &master->cold_arena;
+    case 1: return &master->short_arena;
+    case 2: return &master->request_arena;
+    default: return &master->numa_arenas[i];
+    }
+}
+
+static inline memory_pool_t* side_arena(memory_pool_t* master, int i) {
+    return __atomic_load_n(side_arena_slot(master, i), __ATOMIC_ACQUIRE);
+}
+
+// 上限所在的池：附属 arena 计入其 master 的预算
+static inline memory_pool_t* budget_owner(memory_pool_t* master) {
+    return master->budget ? master->budget : master;
+}
+
+// 附属 arena 的配置：继承 master，但不设自己的软/硬上限（映射计入 master 的预算），
+// 不再派生 arena，也不建固定大小类与延迟直方图（延迟计入调用所用的句柄）
+static pool_config_t arena_config(memory_pool_t* master) {
+    pool_config_t cfg = master->config;
+    cfg.soft_limit = 0;
+    cfg.hard_limit = 0;
+    cfg.numa_arenas = false;
+    cfg.record_latency = false;
+    cfg.enable_size_classes = false;
+    cfg.packed_size_classes = false;
+    return cfg;
+}
+
+// 创建附属 arena 并挂到 master 的预算上；初始段会使 master 越过硬上限时不创建（调用方回退到 master）。
+// 调用方持 master 的锁
+static memory_pool_t* arena_create(memory_pool_t* master, const pool_config_t* cfg) {
+    size_t hard = budget_owner(master)->config.hard_limit;
+    if (hard && budget_mapped_bytes(master) + align_size(cfg->pool_size, segment_granularity(cfg)) > hard) {
+        master->profile.hard_limit_rejections++;
+        return NULL;
+    }
+    memory_pool_t* arena = memory_pool_create_with_config(cfg);
+    if (arena) arena->budget = budget_owner(master);
+    return arena;
+}
+
+// 调用线程所在节点的 arena：master 自身服务 numa_node，其他节点懒创建 BIND 到该节点的独立池。
+// 未启用、单节点或创建失败时返回 pool 本身
+static memory_pool_t* numa_arena_for_thread(memory_pool_t* pool) {
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (!master->config.numa_arenas || memory_pool_numa_node_count() <= 1) return pool;
+    if (master->seg_flags & (MP_SEG_FILE | MP_SEG_SHARED)) return pool; // arena 指针无法跨进程/持久化
+    int node = numa_current_node();
+    if (node == master->config.numa_node) return pool;
+    memory_pool_t* arena = __atomic_load_n(&master->numa_arenas[node], __ATOMIC_ACQUIRE);
+    if (arena) return arena;
+    if (master->thread_safe) pool_lock(master);
+    arena = master->numa_arenas[node];
+    if (!arena) {
+        pool_config_t cfg = arena_config(master);
+        cfg.numa_policy = MP_NUMA_BIND;
+        cfg.numa_node = node;
+        arena = arena_create(master, &cfg);
+        if (arena) __atomic_store_n(&master->numa_arenas[node], arena, __ATOMIC_RELEASE);
+    }
+    if (master->thread_safe) pool_unlock(master);
+    return arena ? arena : pool;
+}
+
+// 按分配提示选择 arena：冷数据优先（冷对象必然长寿），其次短生命周期、请求作用域；
+// 长生命周期与无提示留在 master。arena 为懒创建的独立池，不与 master 共享页面：
+// 冷数据段标记 MP_SEG_COLD；短命对象集中后其段会整体变空，可被 trim 回收或随请求整体 reset。
+// 文件/共享池、arena 自身或创建失败时返回 pool 本身
+static memory_pool_t* hint_arena_get(memory_pool_t* pool, unsigned hints) {
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    memory_pool_t** slot;
+    unsigned kind;
+    if (hints & MP_HINT_COLD) {
+        slot = &master->cold_arena;
+        kind = MP_HINT_COLD;
+    } else if (hints & MP_HINT_SHORT_LIVED) {
+        slot = &master->short_arena;
+        kind = MP_HINT_SHORT_LIVED;
+    } else if (hints & MP_HINT_REQUEST) {
+        slot = &master->request_arena;
+        kind = MP_HINT_REQUEST;
+    } else {
+        return pool;
+    }
+    if (master->arena_hint != MP_HINT_NONE) return pool;
+    if (kind == MP_HINT_COLD && master->config.cold) return pool; // 本身就是冷数据池
+    if (master->seg_flags & (MP_SEG_FILE | MP_SEG_SHARED)) return pool; // arena 指针无法跨进程/持久化
+    memory_pool_t* arena = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if (arena) return arena;
+    if (master->thread_safe) pool_lock(master);
+    arena = *slot;
+    if (!arena) {
+        pool_config_t cfg = arena_config(master);
+        cfg.cold = kind == MP_HINT_COLD;
+        arena = arena_create(master, &cfg);
+        if (arena) {
+            arena->arena_hint = kind;
+            __atomic_store_n(slot, arena, __ATOMIC_RELEASE);
+        }
+    }
+    if (master->thread_safe) pool_unlock(master);
+    return arena ? arena : pool;
+}
+
+// 查找包含 ptr 的附属 arena（节点 arena 与各提示 arena，不含 master 链本身）
+static memory_pool_t* side_arena_owner(memory_pool_t* pool, const void* ptr) {
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    for (int n = 0; n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(master, n);
+        if (arena && memory_pool_contains(arena, (void*)ptr)) return arena;
+    }
+    return NULL;
+}
+
+// 解除段映射（文件映射池与嵌入段释放含头部的整个映射，预留模式需释放整段预留区）
+static void segment_unmap(memory_pool_t* p) {
+    char* map = pool_map(p);
+    if (map) munmap(map, p->map_size);
+    else munmap(pool_heap(p), p->reserved_size ? p->reserved_size : p->pool_size);
+}
+
+// ---- 进程级段缓存 ----
+// 销毁的匿名嵌入段（含子池）按原样保留在缓存中，之后配置相同的创建直接复用，
+// 省去 mmap/munmap 与重新缺页。预留段、hugetlb、文件与共享段不进入缓存。
+// 缓存段保持常驻，因此默认关闭；只有 memory_pool_destroy 放入缓存，空闲子池回收与 trim 总是解除映射。
+#define MP_SEGMENT_CACHE_CAPACITY 64
+
+typedef struct segment_cache_entry {
+    void* heap;                    // 堆起点（段头位于其前一页）
+    size_t size;                   // 堆尺寸
+    uint32_t seg_flags;            // 段属性
+    mp_huge_pages_t huge_pages;    // 映射时的大页策略
+    bool lock_memory;              // 映射时是否要求锁定
+    mp_numa_policy_t numa_policy;  // 映射时施加的 NUMA 策略（策略随页面保留）
+    int numa_node;                 // 策略目标节点
+} segment_cache_entry_t;
+
+static struct {
+    pthread_mutex_t lock;
+    segment_cache_entry_t entries[MP_SEGMENT_CACHE_CAPACITY]; // 按放入顺序，末尾最新
+    size_t count;
+    size_t bytes;                  // 缓存段映射总长度（含段头）
+    size_t max_entries;
+    size_t max_bytes;
+    size_t hits;
+    size_t misses;
+} g_seg_cache = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .max_entries = MP_SEGMENT_CACHE_DEFAULT_ENTRIES,
+    .max_bytes = MP_SEGMENT_CACHE_DEFAULT_BYTES,
+};
+
+static inline size_t cache_entry_bytes(const segment_cache_entry_t* e) {
+    return segment_header_size(e->seg_flags) + e->size;
+}
+
+// 取出与配置匹配的缓存段（优先最近放入的，页面更可能仍在缓存中）；未命中返回 NULL
+static void* segment_cache_take(const pool_config_t* cfg, size_t* size, uint32_t* seg_flags) {
+    if (cfg->reserve_size || cfg->memfd_growth || cfg->huge_pages == MP_HUGE_PAGES_EXPLICIT) return NULL;
+    size_t want = align_size(cfg->pool_size, segment_granularity(cfg));
+    void* heap = NULL;
+    pthread_mutex_lock(&g_seg_cache.lock);
+    for (size_t i = g_seg_cache.count; i-- > 0;) {
+        segment_cache_entry_t* e = &g_seg_cache.entries[i];
+        if (e->size != want || e->huge_pages != cfg->huge_pages || e->lock_memory != cfg->lock_memory) continue;
+        if (e->numa_policy != cfg->numa_policy || e->numa_node != cfg->numa_node) continue;
+        if (!(e->seg_flags & MP_SEG_COLD) != !cfg->cold) continue;
+        if (cfg->lock_required && !(e->seg_flags & MP_SEG_LOCKED)) continue;
+        heap = e->heap;
+        *size = e->size;
+        *seg_flags = e->seg_flags;
+        g_seg_cache.bytes -= cache_entry_bytes(e);
+        memmove(e, e + 1, (g_seg_cache.count - i - 1) * sizeof(*e));
+        g_seg_cache.count--;
+        break;
+    }
+    if (heap) g_seg_cache.hits++;
+    else g_seg_cache.misses++;
+    pthread_mutex_unlock(&g_seg_cache.lock);
+    return heap;
+}
+
+// 从最旧的缓存段开始淘汰，直到不超过 max_entries 个、max_bytes 字节；
+// 被淘汰的段写入 out 由调用方在锁外 munmap。调用方持缓存锁。
+static size_t segment_cache_evict(size_t max_entries, size_t max_bytes, segment_cache_entry_t* out) {
+    size_t n = 0;
+    while (g_seg_cache.count && (g_seg_cache.count > max_entries || g_seg_cache.bytes > max_bytes)) {
+        out[n] = g_seg_cache.entries[0];
+        g_seg_cache.bytes -= cache_entry_bytes(&out[n]);
+        n++;
+        memmove(&g_seg_cache.entries[0], &g_seg_cache.entries[1], (g_seg_cache.count - 1) * sizeof(out[0]));
+        g_seg_cache.count--;
+    }
+    return n;
+}
+
+// 尝试把段放入缓存：成功后段（含嵌入的池结构体）归缓存所有，调用方不得再访问
+static bool segment_cache_put(memory_pool_t* p) {
+    const uint32_t excluded = MP_SEG_RESERVED | MP_SEG_HUGETLB | MP_SEG_FILE | MP_SEG_SHARED | MP_SEG_MEMFD;
+    if (!(p->seg_flags & MP_SEG_EMBEDDED) || (p->seg_flags & excluded)) return false;
+    if (p->config.huge_pages == MP_HUGE_PAGES_EXPLICIT) return false; // 与 take 一致：显式大页总是重新尝试 hugetlb
+    segment_cache_entry_t e = {
+        .heap = pool_heap(p),
+        .size = p->pool_size,
+        .seg_flags = p->seg_flags,
+        .huge_pages = p->config.huge_pages,
+        .lock_memory = p->config.lock_memory,
+        .numa_policy = p->config.numa_policy,
+        .numa_node = p->config.numa_node,
+    };
+    size_t bytes = cache_entry_bytes(&e);
+    segment_cache_entry_t evicted[MP_SEGMENT_CACHE_CAPACITY];
+    size_t n = 0;
+    bool cached = false;
+    pthread_mutex_lock(&g_seg_cache.lock);
+    if (g_seg_cache.max_entries && bytes <= g_seg_cache.max_bytes) {
+        n = segment_cache_evict(g_seg_cache.max_entries - 1, g_seg_cache.max_bytes - bytes, evicted);
+        g_seg_cache.entries[g_seg_cache.count++] = e;
+        g_seg_cache.bytes += bytes;
+        cached = true;
+    }
+    pthread_mutex_unlock(&g_seg_cache.lock);
+    for (size_t i = 0; i < n; i++) segment_unmap_raw(evicted[i].heap, evicted[i].size, 0, evicted[i].seg_flags);
+    return cached;
+}
+
+void memory_pool_segment_cache_set_limit(size_t max_segments, size_t max_bytes) {
+    if (max_segments > MP_SEGMENT_CACHE_CAPACITY) max_segments = MP_SEGMENT_CACHE_CAPACITY;
+    segment_cache_entry_t evicted[MP_SEGMENT_CACHE_CAPACITY];
+    pthread_mutex_lock(&g_seg_cache.lock);
+    g_seg_cache.max_entries = max_segments;
+    g_seg_cache.max_bytes = max_bytes;
+    size_t n = segment_cache_evict(max_segments, max_bytes, evicted);
+    pthread_mutex_unlock(&g_seg_cache.lock);
+    for (size_t i = 0; i < n; i++) segment_unmap_raw(evicted[i].heap, evicted[i].size, 0, evicted[i].seg_flags);
+}
+
+size_t memory_pool_segment_cache_flush(void) {
+    segment_cache_entry_t evicted[MP_SEGMENT_CACHE_CAPACITY];
+    pthread_mutex_lock(&g_seg_cache.lock);
+    size_t bytes = g_seg_cache.bytes;
+    size_t n = segment_cache_evict(0, 0, evicted);
+    pthread_mutex_unlock(&g_seg_cache.lock);
+    for (size_t i = 0; i < n; i++) segment_unmap_raw(evicted[i].heap, evicted[i].size, 0, evicted[i].seg_flags);
+    return bytes;
+}
+
+void memory_pool_segment_cache_get_stats(mp_segment_cache_stats_t* stats) {
+    if (!stats) return;
+    pthread_mutex_lock(&g_seg_cache.lock);
+    stats->segments = g_seg_cache.count;
+    stats->bytes = g_seg_cache.bytes;
+    stats->hits = g_seg_cache.hits;
+    stats->misses = g_seg_cache.misses;
+    pthread_mutex_unlock(&g_seg_cache.lock);
+}
+
+// 段尾新增 extra 字节后并入堆：与尾部空闲块相邻则直接扩大该块（跨越原提交边界合并），否则新建空闲块
+static void segment_attach_tail(memory_pool_t* seg, size_t extra) {
+    const uintptr_t lb = link_base(seg);
+    char* old_end = pool_heap(seg) + seg->pool_size;
+    memory_block_t* tail = blk_at(lb, seg->free_list);
+    while (tail && tail->u.next) tail = blk_at(lb, tail->u.next);
+    if (tail && (char*)tail + tail->size == old_end) {
+        remove_free_block(seg, tail);
+        seg->pool_size += extra;
+        tail->size += extra;
+        tail->u.next = 0;
+        insert_free_block(seg, tail);
+    } else {
+        seg->pool_size += extra;
+        memory_block_t* blk = (memory_block_t*)old_end;
+        blk->size = extra;
+        blk->magic = MP_MAKE_BLOCK_MAGIC(seg, blk);
+        blk->flags = 0; // 前驱为已分配块；FREE 由 insert_free_block 设置
+        blk->u.next = 0;
+        insert_free_block(seg, blk);
+    }
+    MP_LOG("grow segment pool=%p +%zu -> %zu", (void*)seg, extra, seg->pool_size);
+}
+
+// 预留模式下原地提交更多地址空间：至少 min_extra，默认按初始池大小步进，受预留区上限约束。调用方持锁。
+static bool segment_grow_in_place(memory_pool_t* seg, size_t min_extra) {
+    if (!(seg->seg_flags & MP_SEG_RESERVED)) return false;
+    size_t gran = segment_granularity(&seg->config);
+    size_t room = seg->reserved_size - seg->pool_size;
+    size_t extra = align_size(min_extra > seg->config.pool_size ? min_extra : seg->config.pool_size, gran);
+    if (extra > room) extra = room;
+    size_t headroom = limit_headroom(seg, gran);
+    if (extra > headroom) extra = headroom;
+    if (extra < min_extra) return false;
+    char* tail = pool_heap(seg) + seg->pool_size;
+    if (mprotect(tail, extra, PROT_READ | PROT_WRITE) != 0) return false;
+    bool locked;
+    if (!segment_lock_range(&seg->config, tail, extra, &locked)) {
+        // 锁定失败且要求常驻：撤销提交，由调用方按扩展失败处理（不回退到可缺页的子池）
+        mprotect(tail, extra, PROT_NONE);
+        madvise(tail, extra, MADV_DONTNEED);
+        return false;
+    }
+    // 只有全部提交区都锁定时段才保持 LOCKED
+    if (!locked) seg->seg_flags &= ~MP_SEG_LOCKED;
+    if (seg->config.populate && !locked) prefault_range(tail, extra, false);
+    segment_attach_tail(seg, extra);
+    return true;
+}
+
+// 自适应子池尺寸上限：pool_size 的倍数
+#define MP_ADAPTIVE_MAX_FACTOR 64
+
+// 整条链当前映射的段字节数。调用方持锁。
+static size_t chain_mapped_bytes(memory_pool_t* master) {
+    size_t total = 0;
+    for (memory_pool_t* p = master; p; p = p->next) total += p->pool_size;
+    return total;
+}
+
+// 链长度变化后发布映射字节数。调用方持锁。
+static inline void publish_mapped_bytes(memory_pool_t* master) {
+    __atomic_store_n(&master->mapped_bytes, chain_mapped_bytes(master), __ATOMIC_RELAXED);
+}
+
+// 共享同一预算的 master 与全部附属 arena 当前映射的总字节数。调用方持 master（自身）的锁：
+// 自身链直接遍历，其他成员读取各自发布的 mapped_bytes
+static size_t budget_mapped_bytes(memory_pool_t* master) {
+    memory_pool_t* owner = budget_owner(master);
+    size_t total = owner == master ? chain_mapped_bytes(master) : __atomic_load_n(&owner->mapped_bytes, __ATOMIC_RELAXED);
+    for (int n = 0; n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(owner, n);
+        if (!arena) continue;
+        total += arena == master ? chain_mapped_bytes(master) : __atomic_load_n(&arena->mapped_bytes, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+// 硬上限下还能映射的字节数（按 gran 向下取整）；未设硬上限时为 SIZE_MAX。调用方持锁。
+static size_t limit_headroom(memory_pool_t* master, size_t gran) {
+    size_t hard = budget_owner(master)->config.hard_limit;
+    if (!hard) return SIZE_MAX;
+    size_t mapped = budget_mapped_bytes(master);
+    return mapped >= hard ? 0 : (hard - mapped) / gran * gran;
+}
+
+// 扩展步长：至少 min_size 与初始 pool_size；自适应模式下至少为已映射总量的一半（不超过 64 倍 pool_size），
+// 越过软上限后不再放大；不超过硬上限余量
+static size_t growth_step(memory_pool_t* master, size_t min_size) {
+    size_t step = (min_size < master->config.pool_size) ? master->config.pool_size : min_size;
+    size_t soft = budget_owner(master)->config.soft_limit;
+    bool throttled = soft && budget_mapped_bytes(master) + step > soft;
+    if (master->config.adaptive_sizing && !throttled) {
+        // 几何增长：每次至少补充当前容量的一半，链长随峰值用量对数增长
+        size_t grow = chain_mapped_bytes(master) / 2;
+        size_t cap = master->config.pool_size * MP_ADAPTIVE_MAX_FACTOR;
+        if (grow > cap) grow = cap;
+        if (grow > step) step = grow;
+    }
+    size_t room = limit_headroom(master, segment_granularity(&master->config));
+    if (step > room) step = room > min_size ? room : min_size;
+    return step;
+}
+
+// memfd 段原地延长：ftruncate 扩大文件，让出段尾预留区的对应区间后 mremap 不带 MREMAP_MAYMOVE
+// 延长文件映射（池结构体与全部块地址保持不变）。预留区不足或区间被并发映射抢占时失败，
+// 由调用方改建子池。调用方持锁。
+static bool segment_grow_mremap(memory_pool_t* seg, size_t min_extra) {
+    if (!(seg->seg_flags & MP_SEG_MEMFD)) return false;
+    memory_pool_t* master = seg->master ? seg->master : seg;
+    size_t room = seg->reserved_size - seg->pool_size;
+    size_t extra = align_size(growth_step(master, min_extra), PAGE_SIZE);
+    if (extra > room) extra = room;
+    if (extra < min_extra) return false;
+    size_t old_len = MP_SEG_HEADER_SIZE + seg->pool_size;
+    size_t new_len = old_len + extra;
+    char* tail = pool_heap(seg) + seg->pool_size;
+    if (ftruncate(seg->fd, (off_t)new_len) != 0) return false;
+    munmap(tail, extra);
+    if (mremap(pool_map(seg), old_len, new_len, 0) == MAP_FAILED) {
+        // 让出的区间已不属于本段：放弃其余预留，之后只能新建子池
+        MP_LOG("mremap in place failed for pool=%p (+%zu)", (void*)seg, extra);
+        if (room > extra) munmap(tail + extra, room - extra);
+        seg->reserved_size = seg->pool_size;
+        seg->map_size = old_len;
+        if (ftruncate(seg->fd, (off_t)old_len) != 0) MP_LOG("ftruncate rollback failed");
+        return false;
+    }
+    bool locked;
+    if (!segment_lock_range(&seg->config, tail, extra, &locked)) {
+        // 锁定失败且要求常驻：原子地换回 PROT_NONE 预留，缩回文件长度
+        mmap(tail, extra, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        if (ftruncate(seg->fd, (off_t)old_len) != 0) MP_LOG("ftruncate rollback failed");
+        return false;
+    }
+    if (!locked) seg->seg_flags &= ~MP_SEG_LOCKED;
+    if (seg->config.populate && !locked) prefault_range(tail, extra, false);
+    segment_attach_tail(seg, extra);
+    return true;
+}
+
+// 创建子池（至少 min_size，向上取整到页）
+// 调用方需持有 root 的锁：子池挂链与插入 master 红黑树都不能与空闲子池回收并发
+static memory_pool_t* create_child_pool(memory_pool_t* root, size_t min_size) {
+    memory_pool_t* master = root->master ? root->master : root;
+    // 文件映射池的数据必须全部位于文件内，不能链入匿名子池
+    if (master->seg_flags & MP_SEG_FILE) return NULL;
+    // 继承 master 的创建配置（对齐、线程安全、回收策略等），仅替换尺寸
+    pool_config_t cfg = master->config;
+    cfg.pool_size = growth_step(master, min_size);
+    cfg.enable_size_classes = false;
+    cfg.packed_size_classes = false;
+    cfg.reserve_size = 0; // 预留区耗尽后的子池使用普通映射
+    memory_pool_t* child = memory_pool_create_with_config(&cfg);
+    if (!child) return NULL;
+    // 子池继承 master，不自建 rb_root
+    child->master = master;
+    child->seg_serial = ++master->seg_serials;
+    // 原创建函数把自身 initial_block 设为 rb_root，需要转接到 master 的树
+    memory_block_t* initial_block = (memory_block_t*)pool_heap(child);
+    // 清理其 rb 链接后插入 master
+    rb_init_node(initial_block); // will be recolored in insert
+    child->rb_root = 0;
+    rb_insert(master, initial_block);
+    // 挂到链尾
+    memory_pool_t* p = root;
+    while (p->next) p = p->next;
+    p->next = child;
+    return child;
+}
+
+// 扩展前的预算检查：将越过软/硬上限时先强制回收空闲子池与空闲页，再（不持锁）调用压力回调，
+// 之后重新查找；仍需扩展且将越过硬上限时置 *reject。调用方持锁，返回时仍持锁。
+// 附属 arena 按其 master 的上限与总映射量判断，只回收自身；压力回调归 master，不在 arena 中调用
+static memory_block_t* limit_pressure(memory_pool_t* pool, memory_pool_t** owner_pool, size_t size, bool* reject) {
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    const pool_config_t* cfg = &budget_owner(master)->config;
+    size_t need = align_size(size, segment_granularity(&master->config));
+    size_t mapped = budget_mapped_bytes(master);
+    bool over_hard = cfg->hard_limit && mapped + need > cfg->hard_limit;
+    if (!over_hard && !(cfg->soft_limit && mapped + need > cfg->soft_limit)) return NULL;
+    master->profile.pressure_events++;
+    MP_LOG("memory pressure pool=%p mapped=%zu need=%zu soft=%zu hard=%zu", (void*)master, mapped, need, cfg->soft_limit, cfg->hard_limit);
+
+    trim_locked(master, MP_TRIM_IDLE_CHILDREN | MP_TRIM_PAGES | MP_TRIM_FORCE);
+    if (master->pressure_cb && !master->in_pressure_cb) {
+        mp_pressure_info_t info = {
+            .mapped_bytes = budget_mapped_bytes(master),
+            .requested_bytes = size,
+            .soft_limit = cfg->soft_limit,
+            .hard_limit = cfg->hard_limit,
+            .hard = over_hard,
+        };
+        master->in_pressure_cb = true;
+        if (pool->thread_safe) pool_unlock(pool);
+        trace_suspension_t sp = trace_suspend();
+        master->pressure_cb(master, &info, master->pressure_user);
+        trace_resume(&sp);
+        if (pool->thread_safe) pool_lock(pool);
+        master->in_pressure_cb = false;
+        // 回调可能已释放内存：合并后重新查找
+        for (memory_pool_t* p = master; p; p = p->next) merge_free_blocks(p);
+        *owner_pool = pool;
+        memory_block_t* blk = find_best_fit_chain(pool, owner_pool, size);
+        if (blk) return blk;
+    }
+    if (cfg->hard_limit && budget_mapped_bytes(master) + need > cfg->hard_limit) {
+        master->profile.hard_limit_rejections++;
+        *reject = true;
+    }
+    return NULL;
+}
+
+// 空间不足时扩展：预留模式优先原地提交 master，memfd 模式尝试 mremap 延长链尾段，
+// 否则创建子池，然后在新空间中查找。调用方持锁。
+static memory_block_t* grow_and_fit(memory_pool_t* pool, memory_pool_t** owner_pool, size_t size) {
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    mp_usage_profile_t* pr = &master->profile;
+    if (budget_owner(master)->config.soft_limit || budget_owner(master)->config.hard_limit) {
+        bool reject = false;
+        memory_block_t* blk = limit_pressure(pool, owner_pool, size, &reject);
+        if (blk || reject) return blk;
+    }
+    memory_pool_t* last = master;
+    while (last->next) last = last->next;
+    memory_pool_t* grown = segment_grow_in_place(master, size) ? master
+                         : segment_grow_mremap(last, size) ? last : NULL;
+    if (grown) {
+        pr->in_place_growths++;
+        pr->growth_events++;
+        publish_mapped_bytes(master);
+        size_t mapped = chain_mapped_bytes(master);
+        if (mapped > pr->peak_mapped) pr->peak_mapped = mapped;
+        *owner_pool = grown;
+        memory_block_t* blk = find_best_fit_chain(pool, owner_pool, size);
+        if (blk) return blk;
+    }
+    memory_pool_t* child = create_child_pool(pool, size);
+    if (!child) return NULL;
+    pr->child_pools_created++;
+    pr->growth_events++;
+    publish_mapped_bytes(master);
+    size_t mapped = chain_mapped_bytes(master);
+    if (mapped > pr->peak_mapped) pr->peak_mapped = mapped;
+    *owner_pool = child;
+    return find_best_fit_chain(child, owner_pool, size);
+}
+
+// 链式查找最佳适配块，返回块与其所属池
+static memory_block_t* find_best_fit_chain(memory_pool_t* root, memory_pool_t** owner_pool, size_t size) {
+    memory_block_t* blk = rb_find_best_fit(root, size, owner_pool);
+    if (!blk) return NULL; // 仅使用红黑树，不再线性回退
+    memory_pool_t* p = *owner_pool;
+    const uintptr_t lb = link_base(p);
+    memory_block_t* cur = blk_at(lb, p->free_list); memory_block_t* prev = NULL;
+    while (cur) { if (cur == blk) { if (prev) prev->u.next = cur->u.next; else p->free_list = cur->u.next; break; } prev = cur; cur = blk_at(lb, cur->u.next); }
+    MP_LOG("best-fit(rb) from %p blk=%p size=%zu", (void*)*owner_pool, (void*)blk, (size_t)blk->size);
+    return blk;
+}
+
+static bool pool_contains(memory_pool_t* pool, void* ptr) {
+    return (char*)ptr >= pool_heap(pool) &&
+           (char*)ptr < pool_heap(pool) + pool->pool_size;
+}
+
+// 释放单个池段（不处理链表与红黑树）。cacheable 为 false 时（空闲子池回收、trim）
+// 总是解除映射：这些路径的目的就是把内存还给系统，放进缓存会让段仍然常驻
+static void destroy_segment(memory_pool_t* p, bool cacheable) {
+    if (p->seg_flags & MP_SEG_SHARED) {
+        // 其他进程仍可能在使用：只解除本进程映射，锁与堆保持原样
+        munmap(pool_map(p), p->map_size);
+        return;
+    }
+    if (p->thread_safe) {
+        pthread_mutex_destroy(&p->mutex);
+    }
+    if (p->seg_flags & MP_SEG_FILE) {
+        persist_close(p); // 池结构体位于映射内，不能 free
+        return;
+    }
+    if (cacheable && segment_cache_put(p)) return;
+    bool embedded = (p->seg_flags & MP_SEG_EMBEDDED) != 0;
+    int fd = p->fd; // memfd 段
+    segment_unmap(p); // 嵌入段连同池结构体一起解除映射
+    if (fd >= 0) close(fd);
+    if (!embedded) free(p);
+}
+
+// 子池 used_size 归零：开始空闲计时（size-class 预留块计入 used_size，不会被误判为空闲）
+static inline void child_mark_idle(memory_pool_t* child) {
+    memory_pool_t* master = pool_master(child);
+    if (child == master || child->idle_since_ms || !master->config.release_idle_children) return;
+    uint64_t t = now_ms();
+    child->idle_since_ms = t ? t : 1;
+    master->idle_children++;
+}
+
+// 使用画像：记录一次通用分配的块大小与请求尺寸（master 上，调用方持锁）
+static inline void profile_note_alloc(memory_pool_t* master, size_t block_size, size_t request) {
+    mp_usage_profile_t* pr = &master->profile;
+    pr->current_used += block_size;
+    if (pr->current_used > pr->peak_used) pr->peak_used = pr->current_used;
+    unsigned b = request > 1 ? 63u - (unsigned)__builtin_clzll((unsigned long long)request) : 0;
+    pr->size_hist[b < MP_SIZE_HIST_BUCKETS ? b : MP_SIZE_HIST_BUCKETS - 1]++;
+    pr->alloc_requests++;
+}
+
+// 子池重新被使用：取消空闲计时
+static inline void child_mark_busy(memory_pool_t* child) {
+    if (!child->idle_since_ms) return;
+    child->idle_since_ms = 0;
+    pool_master(child)->idle_children--;
+}
+
+// 回收空闲子池：把初始块移出 master 红黑树、从链上摘除并 munmap。调用方持锁。
+static size_t release_idle_children(memory_pool_t* master, bool force) {
+    if (!master->idle_children) return 0;
+    uint64_t now = now_ms();
+    size_t released = 0;
+    memory_pool_t* prev = master;
+    memory_pool_t* p = master->next;
+    while (p) {
+        memory_pool_t* next = p->next;
+        if (p->idle_since_ms && p->used_size == 0 &&
+            (force || now - p->idle_since_ms >= master->config.child_idle_ms)) {
+            // used_size == 0 时理论上只剩一个完整空闲块，整理一次以防残留未合并的相邻块
+            merge_free_blocks(p);
+            memory_block_t* initial_block = (memory_block_t*)pool_heap(p);
+            if (blk_at(link_base(p), p->free_list) == initial_block && initial_block->size == p->pool_size && !initial_block->u.next) {
+                rb_remove(master, initial_block);
+                prev->next = next;
+                master->idle_children--;
+                released += p->pool_size;
+                MP_LOG("release idle child pool=%p size=%zu", (void*)p, p->pool_size);
+                destroy_segment(p, false);
+                p = next;
+                continue;
+            }
+        }
+        prev = p;
+        p = next;
+    }
+    if (released) publish_mapped_bytes(master);
+    return released;
+}
+
+// 销毁内存池
+void memory_pool_destroy(memory_pool_t* pool) {
+    if (!pool) return;
+    memory_pool_pressure_monitor_stop(pool);
+    memory_pool_zero_reserve_stop(pool);
+    for (int n = 0; n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(pool, n);
+        if (arena) memory_pool_destroy(arena);
+    }
+    free(pool->latency);
+    if (pool->trace) {
+        memory_pool_trace_stop(pool);
+        pthread_mutex_destroy(&pool->trace->lock);
+        free(pool->trace);
+    }
+    memory_pool_t* p = pool;
+    while (p) {
+        memory_pool_t* next = p->next;
+        destroy_segment(p, true);
+        p = next;
+    }
+}
+
+// 零页追踪：
+//  1) 段内 [fresh_offset + 块头, pool_size) 自映射以来从未交给用户，内核保证为零。
+//     除分割产生的块头外（块头只会写在 <= fresh_offset 的位置），该区间不会被写入。
+//  2) 带 MB_FLAG_ZEROED 的空闲块，其内部整页 [page_up(blk+块头), page_down(blk+size)) 已被 MADV_DONTNEED，读出为零。
+static inline char* zeroed_pages_lo(memory_block_t* blk) {
+    return (char*)align_size((uintptr_t)blk + sizeof(memory_block_t), PAGE_SIZE);
+}
+static inline char* zeroed_pages_hi(memory_block_t* blk) {
+    return (char*)(((uintptr_t)blk + blk->size) & ~(uintptr_t)(PAGE_SIZE - 1));
+}
+
+// 记录已分配块 [blk, blk+size)：推进 fresh_offset，并在需要时计算用户区中已知为零的区间。
+// zlo/zhi 为分配前所在空闲块的 DONTNEED 零页范围（无则均为 NULL）。
+static void note_allocated(memory_pool_t* seg, memory_block_t* blk, char* zlo, char* zhi, zero_span_t* zs) {
+    char* user = (char*)blk + sizeof(memory_block_t);
+    char* end = (char*)blk + blk->size;
+    size_t fresh = seg->fresh_offset;
+    if (zs) {
+        char* lo = NULL;
+        char* hi = NULL;
+        char* tail = pool_heap(seg) + fresh + sizeof(memory_block_t);
+        if (tail < end) { lo = tail > user ? tail : user; hi = end; }
+        if (zlo) {
+            char* a = zlo > user ? zlo : user;
+            char* b = zhi < end ? zhi : end;
+            if (a < b) {
+                if (lo && a <= hi && b >= lo) { lo = a < lo ? a : lo; hi = b > hi ? b : hi; }
+                else if (!lo || (size_t)(b - a) > (size_t)(hi - lo)) { lo = a; hi = b; }
+            }
+        }
+        zs->lo = lo ? (size_t)(lo - user) : 0;
+        zs->hi = lo ? (size_t)(hi - user) : 0;
+    }
+    size_t end_off = (size_t)(end - pool_heap(seg));
+    if (end_off > fresh) seg->fresh_offset = end_off;
+}
+
+// 分配内存
+void* memory_pool_alloc(memory_pool_t* pool, size_t size) {
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_ALLOC, size);
+    uint64_t t0 = latency_begin(pool);
+    void* ptr = pool_alloc(pool ? numa_arena_for_thread(pool) : NULL, size, NULL);
+    latency_end(pool, MP_OP_ALLOC, t0);
+    if (tr) trace_end(tr, pool, &rec, NULL, ptr);
+    return ptr;
+}
+
+// 带提示的分配：冷数据与短命对象放入各自的 arena，长寿与无提示同 memory_pool_alloc
+void* memory_pool_alloc_ex(memory_pool_t* pool, size_t size, unsigned hints) {
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_ALLOC_EX, size);
+    void* ptr;
+    if (!pool || !(hints & MP_HINT_ARENA_MASK)) {
+        ptr = memory_pool_alloc(pool, size);
+    } else {
+        uint64_t t0 = latency_begin(pool);
+        ptr = pool_alloc(hint_arena_get(pool, hints), size, NULL);
+        latency_end(pool, MP_OP_ALLOC, t0);
+    }
+    if (tr) {
+        rec.hints = (uint8_t)hints;
+        trace_end(tr, pool, &rec, NULL, ptr);
+    }
+    return ptr;
+}
+
+// 通用分配实现；zs 非空时输出用户区中已知为零的区间
+static void* pool_alloc(memory_pool_t* pool, size_t size, zero_span_t* zs) {
+    if (!pool || size == 0) {
+        set_error(POOL_ERROR_INVALID_SIZE);
+        return NULL;
+    }
+
+    // 内存对齐
+    size_t aligned_size = align_size(size + sizeof(memory_block_t), pool->alignment);
+    
+    // 确保最小块大小
+    if (aligned_size < MIN_BLOCK_SIZE) {
+        aligned_size = MIN_BLOCK_SIZE;
+    }
+
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    if (pool->poisoned) {
+        if (pool->thread_safe) pool_unlock(pool);
+        set_error(POOL_ERROR_CORRUPTION);
+        return NULL;
+    }
+
+    memory_pool_t* owner = pool;
+    memory_block_t* block = find_best_fit_chain(pool, &owner, aligned_size);
+    if (!block) {
+        // 先尝试在整条链上整理合并空闲块，再次尝试分配
+        memory_pool_t* p = pool;
+        while (p) { merge_free_blocks(p); p = p->next; }
+        pool_master(pool)->merge_sweeps++;
+        owner = pool;
+        block = find_best_fit_chain(pool, &owner, aligned_size);
+    }
+    if (!block) {
+        // 仍不足，则原地扩展或创建子池（持锁进行，避免与空闲子池回收并发修改链表）
+        block = grow_and_fit(pool, &owner, aligned_size);
+        if (!block) {
+            if (pool->thread_safe) pool_unlock(pool);
+            set_error(POOL_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    // 分割前记录 DONTNEED 零页范围（分割后剩余块仍是其子区间，继承标记）
+    uint32_t zeroed = block->flags & MB_FLAG_ZEROED;
+    char* zlo = zeroed ? zeroed_pages_lo(block) : NULL;
+    char* zhi = zeroed ? zeroed_pages_hi(block) : NULL;
+
+    // 分割大块（避免内部碎片）
+    size_t remaining_size = block->size - aligned_size;
+    if (remaining_size >= MIN_BLOCK_SIZE) {
+        memory_block_t* new_block = (memory_block_t*)((char*)block + aligned_size);
+    new_block->size = remaining_size;
+    new_block->magic = MP_MAKE_BLOCK_MAGIC(owner, new_block);
+    new_block->flags = zeroed; // FREE will be set by insert_free_block
+    new_block->u.next = 0;
+        block->size = aligned_size;
+    insert_free_block(owner, new_block); // 插入全局结构 (包含 RB)
+    set_next_prev_free(owner, new_block); // 更新其后继 PREV_FREE
+    new_block->flags &= ~MB_FLAG_PREV_FREE; // 前驱为已分配块
+    } else {
+        // 没有剩余自由块，清除后继块 PREV_FREE（前驱变为已分配）
+        clear_next_prev_free(owner, block);
+    }
+    block->flags &= ~(MB_FLAG_FREE | MB_FLAG_ZEROED); // 已分配
+    note_allocated(owner, block, zlo, zhi, zs);
+
+    owner->used_size += block->size;
+    child_mark_busy(owner);
+    profile_note_alloc(pool_master(owner), block->size, size);
+    MP_LOG("alloc pool=%p user=%p size=%zu (blk=%zu)", (void*)owner, (void*)((char*)block + sizeof(memory_block_t)), (size_t)(aligned_size - sizeof(memory_block_t)), (size_t)block->size);
+
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+
+    set_error(POOL_OK);
+    return (char*)block + sizeof(memory_block_t);
+}
+
+void* memory_pool_alloc_aligned(memory_pool_t* pool, size_t size, size_t alignment) {
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_ALLOC_ALIGNED, size);
+    uint64_t t0 = latency_begin(pool);
+    void* ptr = pool_alloc_aligned(pool, size, alignment);
+    latency_end(pool, MP_OP_ALLOC_ALIGNED, t0);
+    if (tr) {
+        rec.align_log2 = alignment ? (uint8_t)__builtin_ctzll(alignment) : 0;
+        trace_end(tr, pool, &rec, NULL, ptr);
+    }
+    return ptr;
+}
+
+// 对齐分配：通过在链上寻找足够大的块，切分出对齐后的使用块，并将前后余留重新挂回空闲链
+static void* pool_alloc_aligned(memory_pool_t* pool, size_t size, size_t alignment) {
+    if (!pool || size == 0 || !is_power_of_two(alignment)) {
+        set_error(POOL_ERROR_INVALID_SIZE);
+        return NULL;
+    }
+    return pool_alloc_aligned_local(numa_arena_for_thread(pool), size, alignment);
+}
+
+// 在给定池链上做对齐分配，不做 NUMA 分流（slab 只能落在主链）
+static void* pool_alloc_aligned_local(memory_pool_t* pool, size_t size, size_t alignment) {
+    // 使用块总大小（包含头部），并按池对齐
+    size_t used_total = align_size(size + sizeof(memory_block_t), pool->alignment);
+    // 需要预留最多 alignment 字节作为前缀填充；前缀不足 MIN_BLOCK_SIZE 时还会再后移一次
+    size_t min_needed = used_total + alignment + MIN_BLOCK_SIZE;
+
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    if (pool->poisoned) {
+        if (pool->thread_safe) pool_unlock(pool);
+        set_error(POOL_ERROR_CORRUPTION);
+        return NULL;
+    }
+
+    memory_pool_t* owner = pool;
+    memory_block_t* block = find_best_fit_chain(pool, &owner, min_needed);
+    if (!block) {
+        // 先在整条链上合并空闲块再试一次
+        memory_pool_t* p = pool;
+        while (p) { merge_free_blocks(p); p = p->next; }
+        pool_master(pool)->merge_sweeps++;
+        owner = pool;
+        block = find_best_fit_chain(pool, &owner, min_needed);
+    }
+    if (!block) {
+        // 仍无则原地扩展或创建子池后重试（持锁进行）
+        block = grow_and_fit(pool, &owner, min_needed);
+        if (!block) {
+            if (pool->thread_safe) pool_unlock(pool);
+            set_error(POOL_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    // 前缀/尾部余块都是原块的子区间，继承 DONTNEED 零页标记
+    uint32_t zeroed = block->flags & MB_FLAG_ZEROED;
+
+    // 计算对齐后的用户指针与对齐块头位置
+    char* raw = (char*)block;
+    char* user_min = raw + sizeof(memory_block_t);
+    uintptr_t aligned_user_addr = align_size((uintptr_t)user_min, alignment);
+    memory_block_t* aligned_block = (memory_block_t*)((char*)aligned_user_addr - sizeof(memory_block_t));
+
+    // 确保前缀块大小要么为0要么 >= MIN_BLOCK_SIZE；不足则后移到 user_min + MIN_BLOCK_SIZE 之后的对齐位置
+    //（按差值 MIN_BLOCK_SIZE - prefix 后移可能仍落在原对齐位置，留下无法成块的前缀）
+    size_t prefix = (size_t)((char*)aligned_block - raw);
+    if (prefix > 0 && prefix < MIN_BLOCK_SIZE) {
+        uintptr_t bumped = align_size((uintptr_t)user_min + MIN_BLOCK_SIZE, alignment);
+        aligned_block = (memory_block_t*)((char*)bumped - sizeof(memory_block_t));
+        prefix = (size_t)((char*)aligned_block - raw);
     }
 
     // 使用块大小：至少 used_total，尾部不够 MIN_BLOCK_SIZE 则并入使用块
@@ -568,403 +1987,2804 @@ void* memory_pool_alloc_aligned(memory_pool_t* pool, size_t size, size_t alignme
         used_total = block->size - prefix;
         suffix = 0;
     }
-    if (suffix > 0 && suffix < MIN_BLOCK_SIZE) {
-        used_total += suffix;
-        suffix = 0;
-        // 再次按池对齐
-        used_total = align_size(used_total, pool->alignment);
+    if (suffix > 0 && suffix < MIN_BLOCK_SIZE) {
+        // 尾部整体并入使用块；不能再向上对齐，否则会越过原块末尾破坏物理相邻块
+        used_total += suffix;
+        suffix = 0;
+    }
+
+    // 前缀回收
+    if (prefix >= MIN_BLOCK_SIZE) {
+        memory_block_t* pre = (memory_block_t*)raw;
+        pre->size = prefix;
+    pre->magic = MP_MAKE_BLOCK_MAGIC(owner, pre);
+        pre->flags = MB_FLAG_FREE | zeroed;
+        pre->u.next = 0;
+        insert_free_block(owner, pre);
+        set_next_prev_free(owner, pre);
+        pre->flags &= ~MB_FLAG_PREV_FREE; // 物理首块或其前驱不一定空闲
+    }
+
+    // 设置对齐后的使用块头
+    aligned_block->size = used_total;
+    aligned_block->magic = MP_MAKE_BLOCK_MAGIC(owner, aligned_block);
+    aligned_block->flags = 0; // allocated（对齐块头可能落在原块内部，标志需整体重置）
+    if (prefix >= MIN_BLOCK_SIZE) {
+        aligned_block->flags |= MB_FLAG_PREV_FREE;
+    aligned_block->u.prev_size = ((memory_block_t*)raw)->size;
+    } else {
+        aligned_block->flags &= ~MB_FLAG_PREV_FREE;
+        aligned_block->u.next = 0;
+    }
+
+    // 尾部回收
+    if (suffix >= MIN_BLOCK_SIZE) {
+        memory_block_t* suf = (memory_block_t*)((char*)aligned_block + used_total);
+        suf->size = suffix;
+    suf->magic = MP_MAKE_BLOCK_MAGIC(owner, suf);
+        suf->flags = MB_FLAG_FREE | zeroed;
+        suf->u.next = 0;
+        insert_free_block(owner, suf);
+        set_next_prev_free(owner, suf);
+    }
+    else {
+        // 没有尾部自由块，则需要清理下一物理块的 PREV_FREE（前驱已分配 & 无新自由块）
+        clear_next_prev_free(owner, aligned_block);
+    }
+
+    note_allocated(owner, aligned_block, NULL, NULL, NULL);
+    owner->used_size += used_total;
+    child_mark_busy(owner);
+    profile_note_alloc(pool_master(owner), used_total, size);
+    MP_LOG("alloc_aligned pool=%p user=%p size=%zu align=%zu used_total=%zu", (void*)owner, (void*)((char*)aligned_block + sizeof(memory_block_t)), (size_t)size, (size_t)alignment, (size_t)used_total);
+
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+
+    set_error(POOL_OK);
+    return (char*)aligned_block + sizeof(memory_block_t);
+}
+
+// ---- 大块清零/复制内核 ----
+// 超过阈值的清零与复制使用非临时存储：数据直接写回内存，不逐出进程的热工作集。
+// 内核按 CPUID 在首次使用时选定（AVX-512F > AVX2 > SSE2），非 x86-64 退化为 memset/memcpy。
+#define MP_STREAM_ALIGN 64
+
+typedef void (*mp_zero_fn)(char* dst, size_t n);
+typedef void (*mp_copy_fn)(char* dst, const char* src, size_t n);
+
+static void zero_generic(char* dst, size_t n) { memset(dst, 0, n); }
+static void copy_generic(char* dst, const char* src, size_t n) { memcpy(dst, src, n); }
+
+#if defined(__x86_64__) && defined(__GNUC__)
+// 对齐到 64 字节前后的零散部分走普通存储，中间整段按 64 字节流式写入
+#define MP_STREAM_SPLIT(dst, n, head, body)                                             \
+    size_t head = (size_t)(-(uintptr_t)(dst) & (MP_STREAM_ALIGN - 1));                 \
+    if (head > (n)) head = (n);                                                         \
+    size_t body = ((n) - head) & ~(size_t)(MP_STREAM_ALIGN - 1)
+
+static void zero_sse2(char* dst, size_t n) {
+    MP_STREAM_SPLIT(dst, n, head, body);
+    memset(dst, 0, head);
+    __m128i z = _mm_setzero_si128();
+    for (char *p = dst + head, *e = p + body; p < e; p += 64) {
+        _mm_stream_si128((__m128i*)p, z);
+        _mm_stream_si128((__m128i*)(p + 16), z);
+        _mm_stream_si128((__m128i*)(p + 32), z);
+        _mm_stream_si128((__m128i*)(p + 48), z);
+    }
+    _mm_sfence();
+    memset(dst + head + body, 0, n - head - body);
+}
+
+static void copy_sse2(char* dst, const char* src, size_t n) {
+    MP_STREAM_SPLIT(dst, n, head, body);
+    memcpy(dst, src, head);
+    for (size_t i = head; i < head + body; i += 64) {
+        for (size_t k = 0; k < 64; k += 16) {
+            _mm_stream_si128((__m128i*)(dst + i + k), _mm_loadu_si128((const __m128i*)(src + i + k)));
+        }
+    }
+    _mm_sfence();
+    memcpy(dst + head + body, src + head + body, n - head - body);
+}
+
+__attribute__((target("avx2")))
+static void zero_avx2(char* dst, size_t n) {
+    MP_STREAM_SPLIT(dst, n, head, body);
+    memset(dst, 0, head);
+    __m256i z = _mm256_setzero_si256();
+    for (char *p = dst + head, *e = p + body; p < e; p += 64) {
+        _mm256_stream_si256((__m256i*)p, z);
+        _mm256_stream_si256((__m256i*)(p + 32), z);
+    }
+    _mm_sfence();
+    memset(dst + head + body, 0, n - head - body);
+}
+
+__attribute__((target("avx2")))
+static void copy_avx2(char* dst, const char* src, size_t n) {
+    MP_STREAM_SPLIT(dst, n, head, body);
+    memcpy(dst, src, head);
+    for (size_t i = head; i < head + body; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+        _mm256_stream_si256((__m256i*)(dst + i), a);
+        _mm256_stream_si256((__m256i*)(dst + i + 32), b);
+    }
+    _mm_sfence();
+    memcpy(dst + head + body, src + head + body, n - head - body);
+}
+
+__attribute__((target("avx512f")))
+static void zero_avx512(char* dst, size_t n) {
+    MP_STREAM_SPLIT(dst, n, head, body);
+    memset(dst, 0, head);
+    __m512i z = _mm512_setzero_si512();
+    for (char *p = dst + head, *e = p + body; p < e; p += 64) _mm512_stream_si512((__m512i*)p, z);
+    _mm_sfence();
+    memset(dst + head + body, 0, n - head - body);
+}
+
+__attribute__((target("avx512f")))
+static void copy_avx512(char* dst, const char* src, size_t n) {
+    MP_STREAM_SPLIT(dst, n, head, body);
+    memcpy(dst, src, head);
+    for (size_t i = head; i < head + body; i += 64) {
+        _mm512_stream_si512((__m512i*)(dst + i), _mm512_loadu_si512((const void*)(src + i)));
+    }
+    _mm_sfence();
+    memcpy(dst + head + body, src + head + body, n - head - body);
+}
+#endif
+
+typedef struct mp_stream_kernel {
+    const char* name;
+    mp_zero_fn zero;
+    mp_copy_fn copy;
+} mp_stream_kernel_t;
+
+static const mp_stream_kernel_t* stream_kernel(void) {
+    static const mp_stream_kernel_t* selected = NULL;
+    const mp_stream_kernel_t* k = __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+    if (k) return k;
+    static const mp_stream_kernel_t generic = { "generic", zero_generic, copy_generic };
+    k = &generic;
+#if defined(__x86_64__) && defined(__GNUC__)
+    static const mp_stream_kernel_t sse2 = { "sse2", zero_sse2, copy_sse2 };
+    static const mp_stream_kernel_t avx2 = { "avx2", zero_avx2, copy_avx2 };
+    static const mp_stream_kernel_t avx512 = { "avx512", zero_avx512, copy_avx512 };
+    __builtin_cpu_init();
+    k = __builtin_cpu_supports("avx512f") ? &avx512 : __builtin_cpu_supports("avx2") ? &avx2 : &sse2;
+#endif
+    __atomic_store_n(&selected, k, __ATOMIC_RELEASE);
+    return k;
+}
+
+const char* memory_pool_streaming_kernel(void) {
+    return stream_kernel()->name;
+}
+
+// 本次操作是否走流式存储：AUTO 按整个请求的字节数与池阈值判定
+static bool use_streaming(memory_pool_t* pool, mp_copy_mode_t mode, size_t total) {
+    if (mode != MP_COPY_AUTO) return mode == MP_COPY_STREAMING;
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    size_t threshold = master->config.streaming_threshold ? master->config.streaming_threshold
+                                                          : MP_STREAMING_DEFAULT_THRESHOLD;
+    return total >= threshold;
+}
+
+static inline void bulk_zero(char* dst, size_t n, bool streaming) {
+    if (!n) return;
+    if (streaming) stream_kernel()->zero(dst, n);
+    else memset(dst, 0, n);
+}
+
+static inline void bulk_copy(char* dst, const char* src, size_t n, bool streaming) {
+    if (!n) return;
+    if (streaming) stream_kernel()->copy(dst, src, n);
+    else memcpy(dst, src, n);
+}
+
+// 分配并清零
+void* memory_pool_calloc(memory_pool_t* pool, size_t count, size_t size) {
+    return memory_pool_calloc_ex(pool, count, size, MP_COPY_AUTO);
+}
+
+void* memory_pool_calloc_ex(memory_pool_t* pool, size_t count, size_t size, mp_copy_mode_t mode) {
+    mp_trace_record_t rec;
+    size_t total;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_CALLOC,
+                                      __builtin_mul_overflow(count, size, &total) ? UINT64_MAX : total);
+    void* ptr = pool_calloc(pool, count, size, mode);
+    if (tr) {
+        rec.mode = (uint8_t)mode;
+        trace_end(tr, pool, &rec, NULL, ptr);
+    }
+    return ptr;
+}
+
+static void* pool_calloc(memory_pool_t* pool, size_t count, size_t size, mp_copy_mode_t mode) {
+    if (!pool || count == 0 || size == 0) {
+        set_error(POOL_ERROR_INVALID_SIZE);
+        return NULL;
+    }
+
+    // 检查溢出
+    if (count > SIZE_MAX / size) {
+        set_error(POOL_ERROR_INVALID_SIZE);
+        return NULL;
+    }
+
+    size_t total_size = count * size;
+    memory_pool_t* target = numa_arena_for_thread(pool);
+    if (target == pool) {
+        void* reserved = zero_reserve_pop(pool, total_size);
+        if (reserved) {
+            set_error(POOL_OK);
+            return reserved;
+        }
+    }
+    zero_span_t zs;
+    char* ptr = pool_alloc(target, total_size, &zs);
+
+    // 只清零不能确认为零的部分：新映射未触及的尾部与 DONTNEED 过的页无需 memset
+    if (ptr) {
+        bool streaming = use_streaming(pool, mode, total_size);
+        size_t lo = zs.lo < total_size ? zs.lo : total_size;
+        size_t hi = zs.hi < total_size ? zs.hi : total_size;
+        if (lo >= hi) {
+            bulk_zero(ptr, total_size, streaming);
+        } else {
+            bulk_zero(ptr, lo, streaming);
+            bulk_zero(ptr + hi, total_size - hi, streaming);
+        }
+    }
+
+    return ptr;
+}
+
+// ---- 预清零块储备 ----
+// 储备块是从通用堆正常分配出的块，由池代为持有；用户区已全部清零，仅首字用作链表链接，弹出时清零。
+// 清零在补充方（refill 调用者或后台线程）不持锁完成，calloc 命中时只做一次出栈。
+
+typedef struct mp_zero_refiller {
+    memory_pool_t* pool;
+    pthread_t thread;
+    pthread_mutex_t lock;          // 保护 stop / kick
+    pthread_cond_t cond;
+    bool stop;
+    bool kick;                     // 有储备降到低水位，需要补充
+} mp_zero_refiller_t;
+
+// 请求 size 字节时通用分配得到的块大小
+static inline size_t request_block_size(memory_pool_t* pool, size_t size) {
+    size_t bs = align_size(size + sizeof(memory_block_t), pool->alignment);
+    return bs < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : bs;
+}
+
+// 唤醒后台补充线程。调用方持池锁（停止线程时先在池锁下摘除指针，因此此处指针有效）
+static void zero_refiller_kick(memory_pool_t* master) {
+    mp_zero_refiller_t* r = master->zero_refiller;
+    if (!r) return;
+    pthread_mutex_lock(&r->lock);
+    r->kick = true;
+    pthread_cond_signal(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
+// calloc 快路径：弹出与请求块大小相同的已清零块；无对应储备或储备为空返回 NULL
+static void* zero_reserve_pop(memory_pool_t* pool, size_t size) {
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (!master->num_zero_reserves) return NULL;
+    size_t bs = request_block_size(master, size);
+    void* p = NULL;
+    if (pool->thread_safe) pool_lock(pool);
+    for (int i = 0; i < master->num_zero_reserves; i++) {
+        mp_zero_reserve_t* r = &master->zero_reserves[i];
+        if (r->block_size != bs) continue;
+        if (r->head) {
+            p = r->head;
+            r->head = *(void**)p;
+            r->count--;
+            master->zero_reserve_hits++;
+            if (r->count * 2 < r->target) zero_refiller_kick(master);
+        } else {
+            master->zero_reserve_misses++;
+            zero_refiller_kick(master);
+        }
+        break;
+    }
+    if (pool->thread_safe) pool_unlock(pool);
+    if (p) *(void**)p = NULL;
+    return p;
+}
+
+// 将储备中的块交还通用堆（调用方持锁），返回交还的字节数
+static size_t zero_reserve_release_locked(memory_pool_t* master, mp_zero_reserve_t* r, uint32_t keep) {
+    size_t returned = 0;
+    while (r->count > keep) {
+        void* p = r->head;
+        r->head = *(void**)p;
+        r->count--;
+        memory_block_t* blk = (memory_block_t*)((char*)p - sizeof(memory_block_t));
+        memory_pool_t* owner = master;
+        while (owner && !pool_contains(owner, p)) owner = owner->next;
+        if (!owner) continue;
+        returned += blk->size;
+        free_block_locked(owner, blk);
+    }
+    return returned;
+}
+
+bool memory_pool_zero_reserve(memory_pool_t* pool, size_t size, size_t count) {
+    if (!pool || size == 0) {
+        set_error(POOL_ERROR_INVALID_SIZE);
+        return false;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    // 链接指针存于用户区：持久化/共享段中的进程内地址无意义
+    if (master->seg_flags & (MP_SEG_FILE | MP_SEG_SHARED)) {
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return false;
+    }
+    if (count > UINT32_MAX) count = UINT32_MAX;
+    size_t bs = request_block_size(master, size);
+    bool ok = true;
+    if (pool->thread_safe) pool_lock(pool);
+    int i = 0;
+    while (i < master->num_zero_reserves && master->zero_reserves[i].block_size != bs) i++;
+    if (i < master->num_zero_reserves) {
+        mp_zero_reserve_t* r = &master->zero_reserves[i];
+        zero_reserve_release_locked(master, r, (uint32_t)count);
+        r->target = (uint32_t)count;
+        if (!count) {
+            memmove(r, r + 1, (size_t)(master->num_zero_reserves - i - 1) * sizeof(*r));
+            master->num_zero_reserves--;
+        }
+    } else if (count) {
+        if (master->num_zero_reserves < MP_ZERO_RESERVE_MAX) {
+            master->zero_reserves[master->num_zero_reserves++] = (mp_zero_reserve_t){
+                .block_size = bs, .request_size = size, .target = (uint32_t)count,
+            };
+        } else {
+            ok = false;
+        }
+    }
+    if (ok && count) zero_refiller_kick(master);
+    if (pool->thread_safe) pool_unlock(pool);
+    set_error(ok ? POOL_OK : POOL_ERROR_INVALID_SIZE);
+    return ok;
+}
+
+size_t memory_pool_zero_reserve_refill(memory_pool_t* pool) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return 0;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    size_t filled = 0;
+    for (int i = 0; i < MP_ZERO_RESERVE_MAX; i++) {
+        for (;;) {
+            if (master->thread_safe) pool_lock(master);
+            // 重置进行中不再发起补充（重置结束会重新唤醒补充线程）；登记在途补充，重置等其结束
+            uint64_t gen = master->reset_gen;
+            bool need = !(gen & 1) && i < master->num_zero_reserves && master->zero_reserves[i].count < master->zero_reserves[i].target;
+            size_t req = need ? master->zero_reserves[i].request_size : 0;
+            size_t bs = need ? master->zero_reserves[i].block_size : 0;
+            if (need) master->zero_refills++;
+            if (master->thread_safe) pool_unlock(master);
+            if (!need) {
+                if (gen & 1) goto out;
+                break;
+            }
+
+            zero_span_t zs;
+            char* p = pool_alloc(master, req, &zs);
+            if (!p) {
+                if (master->thread_safe) pool_lock(master);
+                master->zero_refills--;
+                if (master->thread_safe) pool_unlock(master);
+                goto out;
+            }
+            // 不持锁清零：块已从通用堆摘出，只有本线程可见；新映射与 DONTNEED 过的零页跳过
+            size_t usable = ((memory_block_t*)(p - sizeof(memory_block_t)))->size - sizeof(memory_block_t);
+            size_t lo = zs.lo < usable ? zs.lo : usable;
+            size_t hi = zs.hi < usable ? zs.hi : usable;
+            if (lo >= hi) {
+                memset(p, 0, usable);
+            } else {
+                memset(p, 0, lo);
+                memset(p + hi, 0, usable - hi);
+            }
+
+            // 期间储备可能被修改或已被其他补充者补满：按块大小重新定位
+            bool pushed = false;
+            if (master->thread_safe) pool_lock(master);
+            master->zero_refills--;
+            if (master->reset_gen != gen) {
+                // 重置已开始（正等本块清零结束）：块随堆一起被重建，不再触碰也不释放
+                if (master->thread_safe) pool_unlock(master);
+                goto out;
+            }
+            for (int j = 0; j < master->num_zero_reserves; j++) {
+                mp_zero_reserve_t* r = &master->zero_reserves[j];
+                if (r->block_size != bs || r->count >= r->target) continue;
+                *(void**)p = r->head;
+                r->head = p;
+                r->count++;
+                pushed = true;
+                break;
+            }
+            if (master->thread_safe) pool_unlock(master);
+            if (!pushed) {
+                // 内部释放：不经过公开入口，追踪中不会出现调用方从未分配过的 FREE 记录
+                pool_free(master, p);
+                break;
+            }
+            filled++;
+        }
+    }
+out:
+    MP_LOG("zero reserve refill pool=%p filled=%zu", (void*)master, filled);
+    set_error(POOL_OK);
+    return filled;
+}
+
+static void* zero_refiller_main(void* arg) {
+    mp_zero_refiller_t* r = (mp_zero_refiller_t*)arg;
+    pthread_mutex_lock(&r->lock);
+    while (!r->stop) {
+        if (!r->kick) {
+            pthread_cond_wait(&r->cond, &r->lock);
+            continue;
+        }
+        r->kick = false;
+        pthread_mutex_unlock(&r->lock);
+        memory_pool_zero_reserve_refill(r->pool);
+        pthread_mutex_lock(&r->lock);
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+bool memory_pool_zero_reserve_start(memory_pool_t* pool) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (!master->thread_safe || (master->seg_flags & (MP_SEG_FILE | MP_SEG_SHARED)) || master->zero_refiller) {
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return false;
+    }
+    mp_zero_refiller_t* r = calloc(1, sizeof(*r));
+    if (!r) {
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    r->pool = master;
+    r->kick = true; // 启动即补满
+    if (pthread_mutex_init(&r->lock, NULL) != 0) {
+        free(r);
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    if (pthread_cond_init(&r->cond, NULL) != 0) {
+        pthread_mutex_destroy(&r->lock);
+        free(r);
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    pool_lock(master);
+    bool raced = master->zero_refiller != NULL;
+    if (!raced) master->zero_refiller = r;
+    pool_unlock(master);
+    if (raced || pthread_create(&r->thread, NULL, zero_refiller_main, r) != 0) {
+        if (!raced) {
+            pool_lock(master);
+            master->zero_refiller = NULL;
+            pool_unlock(master);
+        }
+        pthread_cond_destroy(&r->cond);
+        pthread_mutex_destroy(&r->lock);
+        free(r);
+        set_error(raced ? POOL_ERROR_INVALID_POINTER : POOL_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    set_error(POOL_OK);
+    return true;
+}
+
+void memory_pool_zero_reserve_stop(memory_pool_t* pool) {
+    if (!pool) return;
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (!master->zero_refiller) return;
+    pool_lock(master);
+    mp_zero_refiller_t* r = master->zero_refiller;
+    master->zero_refiller = NULL;
+    pool_unlock(master);
+    if (!r) return;
+    pthread_mutex_lock(&r->lock);
+    r->stop = true;
+    pthread_cond_signal(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+    pthread_cond_destroy(&r->cond);
+    pthread_mutex_destroy(&r->lock);
+    free(r);
+}
+
+// 插入空闲块到链表中（按地址排序，便于合并）
+static void insert_free_block(memory_pool_t* pool, memory_block_t* block) {
+    if (block->flags & MB_FLAG_SIZECLASS) {
+        // size-class 块不进入通用空闲链
+        return;
+    }
+    // 标记为空闲（通用）
+    block->flags |= MB_FLAG_FREE;
+    // 插入主池 RB 树（按 size 排序）
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    rb_insert(master, block);
+    // 同一段内链接值与地址同序，可直接比较
+    const uintptr_t lb = link_base(pool);
+    const mp_link_t link = blk_link(lb, block);
+    if (!pool->free_list || link < pool->free_list) {
+        block->u.next = pool->free_list;
+        pool->free_list = link;
+        return;
+    }
+    memory_block_t* current = blk_at(lb, pool->free_list);
+    while (current->u.next && current->u.next < link) {
+        current = blk_at(lb, current->u.next);
+    }
+    block->u.next = current->u.next;
+    current->u.next = link;
+}
+
+// ---- 紧凑固定大小类（带外元数据） ----
+// 每个 slab 是通用堆中的一个普通已分配块，块内布局：
+//   [mp_slab_t][next_free: uint32 × capacity][state: uint8 × capacity] | 缓存行对齐 | 对象 0 | 对象 1 | ...
+// 对象之间没有块头；对象按 (ptr - 对象区) / obj_size 索引侧表，分配/释放只写 slab 头部。
+// slab 起点按不小于其长度的 2 的幂（跨度）对齐，块头带 MB_FLAG_SLAB：释放时把指针向下取整到
+// 各个用过的跨度即可找到 slab，与 slab 数量无关。
+#define MP_SLAB_MAGIC       0x534C4142u   // "SLAB"
+#define MP_SLAB_NONE        UINT32_MAX
+#define MP_SLAB_BYTES       (64u * 1024)  // 按需补充时每个 slab 的目标跨度（含侧表）
+#define MP_CACHE_LINE       64
+
+typedef struct mp_slab {
+    uint32_t magic;                // MP_SLAB_MAGIC ^ magic_seed
+    uint32_t obj_size;             // 对象步长（已按池对齐取整）
+    uint32_t capacity;             // 对象个数
+    uint32_t used;                 // 已分配对象数
+    uint32_t free_head;            // 空闲对象索引链表头（MP_SLAB_NONE = 已满）
+    uint32_t objects_offset;       // 对象区相对 slab 起点的偏移
+    uint32_t class_index;          // 所属 size-class 下标
+    struct mp_slab* next;          // 同类 slab 链
+} mp_slab_t;
+
+static inline uint32_t* slab_next_free(mp_slab_t* s) { return (uint32_t*)(s + 1); }
+static inline uint8_t* slab_state(mp_slab_t* s) { return (uint8_t*)(slab_next_free(s) + s->capacity); }
+static inline char* slab_objects(mp_slab_t* s) { return (char*)s + s->objects_offset; }
+
+static inline size_t slab_meta_size(size_t capacity) {
+    return sizeof(mp_slab_t) + capacity * (sizeof(uint32_t) + sizeof(uint8_t));
+}
+
+static inline size_t slab_align(const memory_pool_t* pool) {
+    return pool->alignment > MP_CACHE_LINE ? pool->alignment : MP_CACHE_LINE;
+}
+
+// 跨度 span 内最多容纳的对象个数（含侧表、对象区对齐余量与下一个跨度起点前的块头，
+// 使相邻跨度能首尾相接地各放一个 slab）
+static size_t slab_capacity_for_span(const memory_pool_t* pool, size_t obj_size, size_t span) {
+    size_t fixed = sizeof(memory_block_t) + sizeof(mp_slab_t) + slab_align(pool);
+    if (span <= fixed) return 0;
+    return (span - fixed) / (obj_size + sizeof(uint32_t) + sizeof(uint8_t));
+}
+
+// 从通用堆切出一个 slab（调用方不持锁），对象区按缓存行对齐，使侧表与对象不共享缓存行；
+// slab 起点按跨度对齐，块头标记 MB_FLAG_SLAB 供 slab_find 反查
+static mp_slab_t* slab_create(memory_pool_t* pool, int class_index, size_t obj_size, size_t capacity) {
+    if (capacity == 0 || capacity >= MP_SLAB_NONE || obj_size > UINT32_MAX) return NULL;
+    size_t align = slab_align(pool);
+    size_t meta = slab_meta_size(capacity);
+    size_t total = meta + align + capacity * obj_size;
+    if (total > ((size_t)1 << 31)) return NULL;
+    size_t span = MP_CACHE_LINE;
+    while (span < total + sizeof(memory_block_t)) span <<= 1;
+    // slab 只在主链上切分，slab_find 因此无需访问侧池的块头
+    mp_slab_t* s = (mp_slab_t*)pool_alloc_aligned_local(pool, total, span);
+    if (!s) return NULL;
+    s->magic = MP_SLAB_MAGIC ^ pool->magic_seed;
+    s->obj_size = (uint32_t)obj_size;
+    s->capacity = (uint32_t)capacity;
+    s->used = 0;
+    s->objects_offset = (uint32_t)(align_size((uintptr_t)s + meta, align) - (uintptr_t)s);
+    s->class_index = (uint32_t)class_index;
+    s->next = NULL;
+    uint32_t* next_free = slab_next_free(s);
+    for (uint32_t i = 0; i < s->capacity; i++) next_free[i] = i + 1;
+    next_free[s->capacity - 1] = MP_SLAB_NONE;
+    memset(slab_state(s), 0, capacity);
+    s->free_head = 0;
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    ((memory_block_t*)s - 1)->flags |= MB_FLAG_SLAB;
+    pool->slab_spans |= (uint32_t)span;
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+    return s;
+}
+
+// 查找 ptr 所在的 slab：*index 为对象序号，指向对象内部（非起点）时为 MP_SLAB_NONE。调用方持锁。
+// 对每个用过的跨度把 ptr 向下取整，候选起点须是同一段内带 MB_FLAG_SLAB 且魔数有效的块的用户区
+static mp_slab_t* slab_find(memory_pool_t* pool, const void* ptr, int* class_index, uint32_t* index) {
+    uint32_t spans = pool->slab_spans;
+    if (!spans) return NULL;
+    // 侧池由其它锁保护，且从不承载 slab：不在主链内的指针直接返回
+    memory_pool_t* owner = pool_master(pool);
+    while (owner && !pool_contains(owner, (void*)ptr)) owner = owner->next;
+    if (!owner) return NULL;
+    const char* lo = pool_heap(owner) + sizeof(memory_block_t);
+    const char* hi = pool_heap(owner) + owner->pool_size;
+    while (spans) {
+        uintptr_t span = (uintptr_t)1 << __builtin_ctz(spans);
+        spans &= spans - 1;
+        const char* base = (const char*)((uintptr_t)ptr & ~(span - 1));
+        if (base < lo || base == (const char*)ptr || hi - base < (ptrdiff_t)sizeof(mp_slab_t)) continue;
+        memory_block_t* blk = (memory_block_t*)base - 1;
+        if (!(blk->flags & MB_FLAG_SLAB) || (blk->flags & MB_FLAG_FREE) || !MP_CHECK_BLOCK_MAGIC(owner, blk)) continue;
+        mp_slab_t* s = (mp_slab_t*)base;
+        if (s->magic != (MP_SLAB_MAGIC ^ pool->magic_seed)) continue;
+        const char* objs = slab_objects(s);
+        if ((const char*)ptr < objs || (const char*)ptr >= objs + (size_t)s->capacity * s->obj_size) continue;
+        size_t off = (size_t)((const char*)ptr - objs);
+        *class_index = (int)s->class_index;
+        *index = (off % s->obj_size) ? MP_SLAB_NONE : (uint32_t)(off / s->obj_size);
+        return s;
+    }
+    return NULL;
+}
+
+// 从类的 slab 链中取一个空闲对象；全部已满返回 NULL。调用方持锁。
+static void* slab_alloc(size_class_pool_t* cls) {
+    for (mp_slab_t* s = cls->slabs; s; s = s->next) {
+        if (s->free_head == MP_SLAB_NONE) continue;
+        uint32_t idx = s->free_head;
+        s->free_head = slab_next_free(s)[idx];
+        slab_state(s)[idx] = 1;
+        s->used++;
+        cls->used_count++;
+        return slab_objects(s) + (size_t)idx * s->obj_size;
+    }
+    return NULL;
+}
+
+// 挂入新 slab（头插，新 slab 优先分配）。调用方持锁。
+static void slab_attach(size_class_pool_t* cls, mp_slab_t* s) {
+    s->next = cls->slabs;
+    cls->slabs = s;
+    cls->block_count += s->capacity;
+}
+
+// slab 所在通用块的属主段；位于节点 arena 的 slab 由 arena 自身的锁保护，返回 NULL。调用方持锁。
+static memory_pool_t* slab_owner(memory_pool_t* master, mp_slab_t* s) {
+    memory_pool_t* owner = master;
+    while (owner && !pool_contains(owner, (memory_block_t*)s - 1)) owner = owner->next;
+    return owner;
+}
+
+// 已从类链摘下的 slab 交还通用堆：清除 slab 标记后按普通块释放。调用方持锁。
+static void slab_return_block(memory_pool_t* owner, mp_slab_t* s) {
+    memory_block_t* blk = (memory_block_t*)s - 1;
+    blk->flags &= ~MB_FLAG_SLAB;
+    free_block_locked(owner, blk);
+}
+
+// 最后一个对象释放后交还空 slab；类的唯一 slab 保留，避免单对象反复分配/释放时来回切 slab。调用方持锁。
+static void slab_release_empty(memory_pool_t* pool, size_class_pool_t* cls, mp_slab_t* s) {
+    if (cls->slabs == s && !s->next) return;
+    memory_pool_t* owner = slab_owner(pool->master ? pool->master : pool, s);
+    if (!owner) return;
+    mp_slab_t** link = &cls->slabs;
+    while (*link && *link != s) link = &(*link)->next;
+    if (!*link) return;
+    *link = s->next;
+    cls->block_count -= s->capacity;
+    slab_return_block(owner, s);
+}
+
+// 若 ptr 属于紧凑 slab 则释放并返回 true（*err 为结果），否则返回 false 交由通用路径。调用方持锁。
+static bool slab_try_free(memory_pool_t* pool, void* ptr, pool_error_t* err) {
+    int ci;
+    uint32_t idx;
+    mp_slab_t* s = slab_find(pool, ptr, &ci, &idx);
+    if (!s) return false;
+    if (idx == MP_SLAB_NONE) {
+        *err = POOL_ERROR_INVALID_POINTER;
+    } else if (!slab_state(s)[idx]) {
+        *err = POOL_ERROR_DOUBLE_FREE;
+    } else {
+        slab_state(s)[idx] = 0;
+        slab_next_free(s)[idx] = s->free_head;
+        s->free_head = idx;
+        s->used--;
+        pool->size_classes[ci].used_count--;
+        if (s->used == 0) slab_release_empty(pool, &pool->size_classes[ci], s);
+        *err = POOL_OK;
+    }
+    return true;
+}
+
+// 紧凑对象的可用大小；非紧凑指针返回 0。调用方持锁。
+static size_t slab_usable_size(memory_pool_t* pool, const void* ptr) {
+    int ci;
+    uint32_t idx;
+    mp_slab_t* s = slab_find(pool, ptr, &ci, &idx);
+    return (s && idx != MP_SLAB_NONE) ? s->obj_size : 0;
+}
+
+// 通用块释放：与前后空闲块合并后挂回空闲结构。block 已通过校验且属于 owner。调用方持锁。
+static void free_block_locked(memory_pool_t* owner, memory_block_t* block) {
+    owner->used_size -= block->size;
+    pool_master(owner)->profile.current_used -= block->size;
+    pool_master(owner)->heap_frees++;
+
+    // 重写合并逻辑：先计算最终合并后的块大小，再一次性插入空闲结构（避免红黑树中途 size 变化破坏有序性）
+    memory_block_t* base = block; // 最终要插入的块
+    // bool merged_backward = false; // 已不再需要
+    if (block->flags & MB_FLAG_PREV_FREE) {
+        memory_block_t* prev = (memory_block_t*)((char*)block - block->u.prev_size);
+        if (validate_block(prev) && (prev->flags & MB_FLAG_FREE) && (char*)prev + prev->size == (char*)block) {
+            // 从自由结构中移除 prev（它本就在 free_list 和 RB 中）
+            MP_LOG("free coalesce backward prev=%p size=%zu with blk=%p size=%zu", (void*)prev, (size_t)prev->size, (void*)block, (size_t)block->size);
+            remove_free_block(owner, prev);
+            prev->size += block->size;
+            base = prev;
+        } else {
+            block->flags &= ~MB_FLAG_PREV_FREE; // 清理无效标记，按未合并处理
+        }
+    }
+
+    // 向前（后继）合并：不断吸收紧邻的自由块
+    while (1) {
+        memory_block_t* nxt = next_physical_block(owner, base);
+        if (!nxt || (nxt->flags & MB_FLAG_SIZECLASS) || !(nxt->flags & MB_FLAG_FREE) || (char*)base + base->size != (char*)nxt) break;
+        remove_free_block(owner, nxt); // detach nxt (包括 RB)
+    MP_LOG("free coalesce forward base=%p new_size=%zu absorb nxt=%p size=%zu", (void*)base, (size_t)(base->size + nxt->size), (void*)nxt, (size_t)nxt->size);
+        base->size += nxt->size;
+    }
+
+    // 现在 base 还未在 RB/链表内（若 backward 合并则已移除；若未 backward 合并则是新释放块，不在结构中）
+    base->flags |= MB_FLAG_FREE;
+    base->flags &= ~(MB_FLAG_PREV_FREE | MB_FLAG_ZEROED); // 自身作为自由块不需要该标记；含刚释放的脏数据
+    base->u.next = 0;
+    insert_free_block(owner, base); // 一次性按新 size 插入
+    set_next_prev_free(owner, base); // 设置其后继的 PREV_FREE
+
+    // 子池变空则开始空闲计时
+    if (owner->used_size == 0) child_mark_idle(owner);
+}
+
+// 释放内存
+void memory_pool_free(memory_pool_t* pool, void* ptr) {
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_FREE, 0);
+    uint64_t t0 = latency_begin(pool);
+    pool_free(pool, ptr);
+    latency_end(pool, MP_OP_FREE, t0);
+    if (tr) trace_end(tr, pool, &rec, ptr, NULL);
+}
+
+static void pool_free(memory_pool_t* pool, void* ptr) {
+    if (!pool || !ptr) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return;
+    }
+
+    // 链表可能因空闲子池回收而变化，先持锁再查找所属池
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    if (pool->poisoned) {
+        if (pool->thread_safe) pool_unlock(pool);
+        set_error(POOL_ERROR_CORRUPTION);
+        return;
+    }
+
+    // 紧凑 slab 中的对象没有块头，先按侧表识别
+    if (pool->config.packed_size_classes) {
+        pool_error_t err;
+        if (slab_try_free(pool, ptr, &err)) {
+            if (pool->thread_safe) pool_unlock(pool);
+            set_error(err);
+            return;
+        }
+    }
+
+    // 检查指针是否在池范围内
+    // 找到所属池
+    memory_pool_t* owner = pool;
+    while (owner && !pool_contains(owner, ptr)) owner = owner->next;
+    if (!owner) {
+        if (pool->thread_safe) pool_unlock(pool);
+        // 可能来自其他节点的 arena（远端释放直接交还给所属 arena）
+        memory_pool_t* arena = side_arena_owner(pool, ptr);
+        if (arena) {
+            memory_pool_free(arena, ptr);
+            return;
+        }
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return;
+    }
+
+    memory_block_t* block = (memory_block_t*)((char*)ptr - sizeof(memory_block_t));
+
+    // 验证块的完整性
+    if (!validate_block(block) || !MP_CHECK_BLOCK_MAGIC(owner, block)) {
+        if (pool->thread_safe) pool_unlock(pool);
+        set_error(POOL_ERROR_CORRUPTION);
+        return;
+    }
+
+    // 若为 size-class 块，改用 fixed 释放逻辑（不触发合并）
+    if (block->flags & MB_FLAG_SIZECLASS) {
+        if (pool->thread_safe) pool_unlock(pool);
+        memory_pool_free_fixed(owner, ptr);
+        return;
+    }
+
+    // 双重释放检测（仅适用于通用 free；固定大小池内部释放由 free_fixed）
+    if (block->flags & MB_FLAG_FREE) {
+        if (pool->thread_safe) pool_unlock(pool);
+        set_error(POOL_ERROR_DOUBLE_FREE);
+        MP_LOG("double free detected blk=%p", (void*)block);
+        return;
+    }
+    MP_LOG("free pool=%p user=%p blk_size=%zu", (void*)owner, ptr, (size_t)block->size);
+    free_block_locked(owner, block);
+    // 到期的空闲子池顺带回收
+    release_idle_children(pool_master(owner), false);
+
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+
+    set_error(POOL_OK);
+}
+
+// 重新分配内存
+void* memory_pool_realloc(memory_pool_t* pool, void* ptr, size_t new_size) {
+    return memory_pool_realloc_ex(pool, ptr, new_size, MP_COPY_AUTO);
+}
+
+void* memory_pool_realloc_ex(memory_pool_t* pool, void* ptr, size_t new_size, mp_copy_mode_t mode) {
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_REALLOC, new_size);
+    uint64_t t0 = latency_begin(pool);
+    void* new_ptr = pool_realloc(pool, ptr, new_size, mode);
+    latency_end(pool, MP_OP_REALLOC, t0);
+    if (tr) {
+        rec.mode = (uint8_t)mode;
+        trace_end(tr, pool, &rec, ptr, new_ptr);
+    }
+    return new_ptr;
+}
+
+static void* pool_realloc(memory_pool_t* pool, void* ptr, size_t new_size, mp_copy_mode_t mode) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return NULL;
+    }
+
+    if (!ptr) {
+        return memory_pool_alloc(pool, new_size);
+    }
+
+    if (new_size == 0) {
+        memory_pool_free(pool, ptr);
+        return NULL;
+    }
+
+    // 获取当前块大小
+    size_t old_size = memory_pool_get_block_size(pool, ptr);
+    if (old_size == 0) {
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return NULL;
+    }
+
+    // 如果新大小小于等于当前大小，直接返回（紧凑对象没有块头）
+    size_t usable_old_size = memory_pool_is_packed(pool, ptr) ? old_size : old_size - sizeof(memory_block_t);
+    if (new_size <= usable_old_size) {
+        return ptr;
+    }
+
+    // 分配新内存（提示 arena 中的对象扩容后仍留在原 arena）
+    memory_pool_t* owner = side_arena_owner(pool, ptr);
+    void* new_ptr = owner && owner->arena_hint ? pool_alloc(owner, new_size, NULL) : memory_pool_alloc(pool, new_size);
+    if (!new_ptr) {
+        return NULL;
+    }
+
+    // 复制数据
+    bulk_copy(new_ptr, ptr, usable_old_size, use_streaming(pool, mode, usable_old_size));
+    
+    // 释放旧内存
+    // 直接释放旧块（若为 size-class 将自动回到其私有空闲链）
+    memory_pool_free(pool, ptr);
+    
+    return new_ptr;
+}
+
+// 重置内存池
+void memory_pool_reset(memory_pool_t* pool) {
+    if (!pool) return;
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_RESET, 0);
+
+    memory_pool_t* master = pool_master(pool);
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    // 补充线程在锁外清零已分配的块：先置重置代数为奇数阻止新的补充，再等在途补充结束，
+    // 之后才能重建堆或解除子池映射（在途补充看到代数变化后直接丢弃其块）
+    master->reset_gen++;
+    while (pool->thread_safe && master->zero_refills) {
+        pool_unlock(pool);
+        sched_yield();
+        pool_lock(pool);
+    }
+
+    // slab 块头随堆一起丢弃，先清除 slab 标记，免得残留块头被 slab_find 当作有效 slab
+    for (int i = 0; i < pool->num_classes; i++) {
+        for (mp_slab_t* sl = pool->size_classes[i].slabs; sl; sl = sl->next) {
+            ((memory_block_t*)sl - 1)->flags &= ~MB_FLAG_SLAB;
+        }
+    }
+
+    // 遍历整条链路重置
+    memory_pool_t* p = pool;
+    while (p) {
+        p->used_size = 0;
+        memory_block_t* initial_block = (memory_block_t*)pool_heap(p);
+        initial_block->u.next = 0;
+        initial_block->size = p->pool_size;
+    initial_block->magic = MP_MAKE_BLOCK_MAGIC(p, initial_block);
+        initial_block->flags = MB_FLAG_FREE;
+        p->free_list = blk_link(link_base(p), initial_block);
+        if (p == master) {
+            // 重建 master 根（先清空 rb_root）
+            p->rb_root = 0;
+            rb_init_node(initial_block);
+            rb_insert(p, initial_block); // becomes root
+        } else {
+            // 将子池初始块插入 master 的树
+            rb_init_node(initial_block);
+            rb_insert(master, initial_block);
+        }
+        MP_LOG("reset pool=%p size=%zu", (void*)p, p->pool_size);
+        for (int i = 0; i < p->num_classes; i++) {
+            p->size_classes[i].free_blocks = 0;
+            p->size_classes[i].slabs = NULL; // slab 所在的通用块随堆一起重置
+            p->size_classes[i].block_count = 0;
+            p->size_classes[i].used_count = 0;
+        }
+        if (p != master) child_mark_idle(p);
+        p = p->next;
+    }
+    master->profile.current_used = 0;
+    for (int i = 0; i < master->num_zero_reserves; i++) {
+        master->zero_reserves[i].head = NULL; // 储备块随堆一起重置
+        master->zero_reserves[i].count = 0;
+    }
+    release_idle_children(master, false);
+    master->reset_gen++;
+    if (master->num_zero_reserves) zero_refiller_kick(master);
+
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+    for (int n = 0; n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(master, n);
+        if (arena) memory_pool_reset(arena);
+    }
+    if (tr) trace_end(tr, pool, &rec, NULL, NULL);
+}
+
+// 请求结束：一次性释放所有 MP_HINT_REQUEST 分配（段保留供下一个请求复用），master 与其他 arena 不受影响
+void memory_pool_reset_requests(memory_pool_t* pool) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return;
+    }
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_RESET_REQUESTS, 0);
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    memory_pool_t* arena = __atomic_load_n(&master->request_arena, __ATOMIC_ACQUIRE);
+    if (arena) memory_pool_reset(arena);
+    if (tr) trace_end(tr, pool, &rec, NULL, NULL);
+    set_error(POOL_OK);
+}
+
+// 判断指针是否为紧凑 slab 中的对象
+bool memory_pool_is_packed(memory_pool_t* pool, void* ptr) {
+    if (!pool || !ptr || !pool->config.packed_size_classes) return false;
+    if (pool->thread_safe) pool_lock(pool);
+    bool packed = slab_usable_size(pool, ptr) != 0;
+    if (pool->thread_safe) pool_unlock(pool);
+    return packed;
+}
+
+// 检查指针是否属于内存池
+bool memory_pool_contains(memory_pool_t* pool, void* ptr) {
+    if (!pool || !ptr) return false;
+    memory_pool_t* p = pool;
+    while (p) {
+        if (pool_contains(p, ptr)) return true;
+        p = p->next;
+    }
+    return side_arena_owner(pool, ptr) != NULL;
+}
+
+// 获取块大小
+size_t memory_pool_get_block_size(memory_pool_t* pool, void* ptr) {
+    if (!pool || !ptr || !memory_pool_contains(pool, ptr)) {
+        return 0;
+    }
+
+    // 紧凑对象：返回对象步长（无块头）
+    if (pool->config.packed_size_classes) {
+        if (pool->thread_safe) pool_lock(pool);
+        size_t packed = slab_usable_size(pool, ptr);
+        if (pool->thread_safe) pool_unlock(pool);
+        if (packed) return packed;
+    }
+
+    memory_block_t* block = (memory_block_t*)((char*)ptr - sizeof(memory_block_t));
+    
+    if (!validate_block(block)) {
+        return 0;
+    }
+
+    return block->size;
+}
+
+// 预缺页：优先 MADV_POPULATE_WRITE（一次系统调用，不改动内容），不支持时逐页触摸。
+// 触摸使用值为 0 的原子 OR：触发写缺页但不改写任何字节，因此不会破坏块头或并发写入的用户数据。
+static void prefault_range(void* addr, size_t len, bool touch_only) {
+    if (!len) return;
+    if (!touch_only && madvise(addr, len, MADV_POPULATE_WRITE) == 0) return;
+    char* base = (char*)addr;
+    for (size_t off = 0; off < len; off += PAGE_SIZE) {
+        __atomic_fetch_or(base + off, (char)0, __ATOMIC_RELAXED);
+    }
+}
+
+typedef struct warmup_range {
+    char* addr;
+    size_t len;
+} warmup_range_t;
+
+// 预热对窗口内 ranges 拼接而成的 [begin, end) 部分
+static void warmup_slice(const warmup_range_t* ranges, size_t nranges, size_t begin, size_t end, bool touch_only) {
+    size_t off = 0;
+    for (size_t i = 0; i < nranges && off < end; i++) {
+        size_t lo = begin > off ? begin : off;
+        size_t hi = end < off + ranges[i].len ? end : off + ranges[i].len;
+        if (lo < hi) prefault_range(ranges[i].addr + (lo - off), hi - lo, touch_only);
+        off += ranges[i].len;
+    }
+}
+
+// 预热线程组：工作线程整个预热过程只创建一次，每个窗口由调用线程发布（round 递增），
+// 各线程按 slot 取自己的份额，全部完成后（pending 归零）调用线程才释放池锁进入下一窗口
+typedef struct warmup_crew {
+    pthread_mutex_t lock;
+    pthread_cond_t go;
+    pthread_cond_t done;
+    const warmup_range_t* ranges;
+    size_t nranges;
+    size_t total;
+    size_t share;
+    bool touch_only;
+    uint64_t round;
+    int pending;
+    bool quit;
+} warmup_crew_t;
+
+typedef struct warmup_worker_arg {
+    warmup_crew_t* crew;
+    int slot;
+} warmup_worker_arg_t;
+
+static void warmup_run_slot(const warmup_crew_t* crew, int slot) {
+    size_t begin = crew->share * (size_t)slot;
+    size_t end = begin + crew->share;
+    if (begin > crew->total) begin = crew->total;
+    if (end > crew->total) end = crew->total;
+    warmup_slice(crew->ranges, crew->nranges, begin, end, crew->touch_only);
+}
+
+static void* warmup_worker(void* arg) {
+    warmup_worker_arg_t* a = (warmup_worker_arg_t*)arg;
+    warmup_crew_t* crew = a->crew;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&crew->lock);
+    for (;;) {
+        while (!crew->quit && crew->round == seen) pthread_cond_wait(&crew->go, &crew->lock);
+        if (crew->quit) break;
+        seen = crew->round;
+        // 窗口参数在本轮 pending 归零前保持不变，可不持锁读取
+        pthread_mutex_unlock(&crew->lock);
+        warmup_run_slot(crew, a->slot);
+        pthread_mutex_lock(&crew->lock);
+        if (--crew->pending == 0) pthread_cond_signal(&crew->done);
+    }
+    pthread_mutex_unlock(&crew->lock);
+    return NULL;
+}
+
+// 每个预热线程单轮负责的字节数：每轮持锁处理一个窗口后释放锁，其他线程的分配不会被整段预热阻塞
+#define MP_WARMUP_CHUNK (8u * 1024 * 1024)
+
+// 预热进度：段序号 + 段内偏移。窗口之间会释放锁，段可能被回收或新增，
+// 按序号重新定位，不依赖链上累计偏移（链按序号升序，回收的段不会使后续段错位）
+typedef struct warmup_cursor {
+    uint64_t serial;
+    size_t offset;
+} warmup_cursor_t;
+
+// 从游标处收集至多 len 字节的各段区间并推进游标，返回窗口内实际字节数。调用方持锁
+static size_t warmup_window(memory_pool_t* pool, warmup_cursor_t* cur, size_t len, warmup_range_t** ranges, size_t* cap, size_t* nranges) {
+    size_t total = 0;
+    *nranges = 0;
+    for (memory_pool_t* p = pool; p && total < len; p = p->next) {
+        if (p->seg_serial < cur->serial) continue;
+        size_t lo = p->seg_serial == cur->serial ? cur->offset : 0;
+        if (lo >= p->pool_size) continue;
+        size_t hi = p->pool_size - lo > len - total ? lo + (len - total) : p->pool_size;
+        if (*nranges == *cap) {
+            size_t ncap = *cap ? *cap * 2 : 4;
+            warmup_range_t* r = realloc(*ranges, ncap * sizeof(**ranges));
+            if (!r) return (size_t)-1;
+            *ranges = r;
+            *cap = ncap;
+        }
+        (*ranges)[*nranges].addr = pool_heap(p) + lo;
+        (*ranges)[*nranges].len = hi - lo;
+        (*nranges)++;
+        total += hi - lo;
+        cur->serial = p->seg_serial;
+        cur->offset = hi;
+    }
+    return total;
+}
+
+// 内存预热（可限定字节数、多线程并行）
+bool memory_pool_warmup_ex(memory_pool_t* pool, const mp_warmup_options_t* opts) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    mp_warmup_options_t o = { .max_bytes = 0, .threads = 1, .touch_only = false };
+    if (opts) o = *opts;
+    int nthreads = o.threads > 1 ? o.threads : 1;
+    // 不为用不到的窗口份额启动线程
+    if (o.max_bytes && (size_t)nthreads > (o.max_bytes - 1) / MP_WARMUP_CHUNK + 1) {
+        nthreads = (int)((o.max_bytes - 1) / MP_WARMUP_CHUNK + 1);
+    }
+
+    warmup_crew_t crew = { .touch_only = o.touch_only };
+    pthread_mutex_init(&crew.lock, NULL);
+    pthread_cond_init(&crew.go, NULL);
+    pthread_cond_init(&crew.done, NULL);
+    warmup_worker_arg_t* args = malloc((size_t)nthreads * sizeof(*args));
+    pthread_t* tids = malloc((size_t)nthreads * sizeof(*tids));
+    bool ok = args && tids;
+    // 线程创建失败时按已启动的线程数切分，调用线程始终占 slot 0
+    int started = 0;
+    for (int i = 1; ok && i < nthreads; i++) {
+        args[i].crew = &crew;
+        args[i].slot = i;
+        if (pthread_create(&tids[i], NULL, warmup_worker, &args[i]) != 0) break;
+        started = i;
+    }
+    int workers = started + 1;
+
+    warmup_range_t* ranges = NULL;
+    size_t cap = 0;
+    warmup_cursor_t cur = { .serial = 0, .offset = 0 };
+    size_t done = 0;
+    while (ok) {
+        size_t window = MP_WARMUP_CHUNK * (size_t)workers;
+        if (o.max_bytes && window > o.max_bytes - done) window = o.max_bytes - done;
+        if (!window) break;
+        // 持锁处理一个窗口：避免空闲子池在预热过程中被解除映射；窗口之间释放锁
+        if (pool->thread_safe) {
+            pool_lock(pool);
+        }
+        size_t nranges;
+        size_t total = warmup_window(pool, &cur, window, &ranges, &cap, &nranges);
+        if (total == (size_t)-1) {
+            ok = false;
+            total = 0;
+        }
+        if (total) {
+            // 按页切分给各线程
+            crew.ranges = ranges;
+            crew.nranges = nranges;
+            crew.total = total;
+            crew.share = align_size((total + (size_t)workers - 1) / (size_t)workers, PAGE_SIZE);
+            pthread_mutex_lock(&crew.lock);
+            crew.round++;
+            crew.pending = started;
+            pthread_cond_broadcast(&crew.go);
+            pthread_mutex_unlock(&crew.lock);
+            warmup_run_slot(&crew, 0);
+            pthread_mutex_lock(&crew.lock);
+            while (crew.pending) pthread_cond_wait(&crew.done, &crew.lock);
+            pthread_mutex_unlock(&crew.lock);
+        }
+        if (pool->thread_safe) {
+            pool_unlock(pool);
+        }
+        done += total;
+        if (total < window) break; // 已到链尾
+    }
+    pthread_mutex_lock(&crew.lock);
+    crew.quit = true;
+    pthread_cond_broadcast(&crew.go);
+    pthread_mutex_unlock(&crew.lock);
+    for (int i = 1; i <= started; i++) pthread_join(tids[i], NULL);
+    pthread_cond_destroy(&crew.done);
+    pthread_cond_destroy(&crew.go);
+    pthread_mutex_destroy(&crew.lock);
+    MP_LOG("warmup pool=%p bytes=%zu threads=%d", (void*)pool, done, workers);
+    free(ranges); free(args); free(tids);
+    if (!ok) {
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    set_error(POOL_OK);
+    return true;
+}
+
+// 内存预热
+void memory_pool_warmup(memory_pool_t* pool) {
+    memory_pool_warmup_ex(pool, NULL);
+}
+
+// 主动回收：把满足条件的空闲内存归还给系统
+size_t memory_pool_trim(memory_pool_t* pool, unsigned flags) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return 0;
+    }
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    size_t released = trim_locked(master, flags);
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+    for (int n = 0; n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(master, n);
+        if (arena) released += memory_pool_trim(arena, flags);
+    }
+    set_error(POOL_OK);
+    return released;
+}
+
+// 把 size-class 私有空闲链上的块与空的紧凑 slab 交还通用堆，返回交还的字节数。调用方持锁。
+static size_t shrink_class_reserves(memory_pool_t* master) {
+    size_t returned = 0;
+    for (int i = 0; i < master->num_classes; i++) {
+        size_class_pool_t* cls = &master->size_classes[i];
+        const uintptr_t lb = link_base(master);
+        memory_block_t* b = blk_at(lb, cls->free_blocks);
+        cls->free_blocks = 0;
+        while (b) {
+            memory_block_t* next = blk_at(lb, b->u.next);
+            memory_pool_t* owner = master;
+            while (owner && !pool_contains(owner, b)) owner = owner->next;
+            if (owner) {
+                // u 被私有链占用，prev_size 已失效：不做反向合并，最后统一整理
+                b->flags &= ~(MB_FLAG_SIZECLASS | MB_FLAG_PREV_FREE);
+                cls->block_count--;
+                returned += b->size;
+                free_block_locked(owner, b);
+            }
+            b = next;
+        }
+        for (mp_slab_t** link = &cls->slabs; *link;) {
+            mp_slab_t* sl = *link;
+            memory_pool_t* owner = sl->used ? NULL : slab_owner(master, sl);
+            if (!owner) { link = &sl->next; continue; }
+            *link = sl->next;
+            cls->block_count -= sl->capacity;
+            returned += ((memory_block_t*)sl - 1)->size;
+            slab_return_block(owner, sl);
+        }
+    }
+    for (int i = 0; i < master->num_zero_reserves; i++) {
+        returned += zero_reserve_release_locked(master, &master->zero_reserves[i], 0);
+    }
+    if (returned) {
+        for (memory_pool_t* p = master; p; p = p->next) merge_free_blocks(p);
+    }
+    MP_LOG("shrink size-class reserves pool=%p returned=%zu", (void*)master, returned);
+    return returned;
+}
+
+// memory_pool_trim 的主体（不含节点 arena）。调用方持锁
+static size_t trim_locked(memory_pool_t* master, unsigned flags) {
+    size_t released = 0;
+    // 先归还 size-class 预留：子池可能因此变空，随后按空闲子池回收
+    if (flags & MP_TRIM_SIZE_CLASSES) shrink_class_reserves(master);
+    if (flags & MP_TRIM_IDLE_CHILDREN) {
+        if (flags & MP_TRIM_FORCE) {
+            // 强制模式下未开启自动回收的池也按 used_size 判定空闲子池
+            for (memory_pool_t* p = master->next; p; p = p->next) {
+                if (p->used_size == 0 && !p->idle_since_ms) {
+                    p->idle_since_ms = 1;
+                    master->idle_children++;
+                }
+            }
+        }
+        released += release_idle_children(master, (flags & MP_TRIM_FORCE) != 0);
+    }
+    if (flags & MP_TRIM_PAGES) {
+        // 空闲块内部的整页交还内核，随后读出为零，由 MB_FLAG_ZEROED 记录供 calloc 复用
+        for (memory_pool_t* p = master; p; p = p->next) {
+            if (p->seg_flags & MP_SEG_HUGETLB) continue; // hugetlb 只能按大页粒度释放
+            if (p->seg_flags & MP_SEG_LOCKED) continue;  // 锁定段保持常驻，不能交还
+            for (memory_block_t* b = blk_at(link_base(p), p->free_list); b; b = blk_at(link_base(p), b->u.next)) {
+                char* lo = zeroed_pages_lo(b);
+                char* hi = zeroed_pages_hi(b);
+                if (lo >= hi || (b->flags & MB_FLAG_ZEROED)) continue;
+                // 共享文件映射上 DONTNEED 只丢弃页表，重读仍是文件内容；需 MADV_REMOVE 打洞
+                int advice = (p->seg_flags & MP_SEG_FILE) ? MADV_REMOVE : MADV_DONTNEED;
+                if (madvise(lo, (size_t)(hi - lo), advice) == 0) {
+                    b->flags |= MB_FLAG_ZEROED;
+                    released += (size_t)(hi - lo);
+                }
+            }
+        }
+    }
+    if (flags & (MP_TRIM_COLD | MP_TRIM_PAGEOUT)) {
+        // 冷数据段整体提示内核：内容保留，只改变页面在回收中的优先级（旧内核返回 EINVAL，忽略）
+        for (memory_pool_t* p = master; p; p = p->next) {
+            if (!(p->seg_flags & MP_SEG_COLD)) continue;
+            if (flags & MP_TRIM_PAGEOUT) {
+                size_t before = segment_resident_bytes(p);
+                if (madvise(pool_heap(p), p->pool_size, MADV_PAGEOUT) != 0) continue;
+                size_t after = segment_resident_bytes(p);
+                if (before > after) released += before - after;
+            } else {
+                madvise(pool_heap(p), p->pool_size, MADV_COLD);
+            }
+        }
+    }
+    return released;
+}
+
+// ---- 系统内存压力监视 ----
+// 轮询而非 PSI 触发器（poll POLLPRI）：触发器对非特权进程有窗口限制，且无法用普通文件替换数据源
+#define MP_PRESSURE_DEFAULT_INTERVAL_MS 1000
+#define MP_PRESSURE_DEFAULT_AVG10       10.0
+#define MP_PRESSURE_DEFAULT_HIGH_RATIO  0.9
+#define MP_PRESSURE_PATH_LEN            512
+
+typedef struct mp_pressure_monitor {
+    memory_pool_t* pool;
+    pthread_t thread;
+    pthread_mutex_t lock;          // 保护 stop 与 stats
+    pthread_cond_t cond;           // 停止时唤醒（CLOCK_MONOTONIC）
+    bool stop;
+    uint32_t interval_ms;
+    double some_avg10;
+    double high_ratio;
+    char psi_path[MP_PRESSURE_PATH_LEN];   // 空串 = 不读 PSI
+    char cgroup_dir[MP_PRESSURE_PATH_LEN]; // 空串 = 不读 memory.high
+    mp_pressure_monitor_stats_t stats;
+} mp_pressure_monitor_t;
+
+// 读取 PSI 文件中 "some avg10=" 的值
+static bool read_psi_some_avg10(const char* path, double* avg10) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[256];
+    bool ok = false;
+    while (!ok && fgets(line, sizeof(line), f)) {
+        ok = sscanf(line, "some avg10=%lf", avg10) == 1;
+    }
+    fclose(f);
+    return ok;
+}
+
+// 读取 cgroup 中的字节数文件；"max" 或不可读返回 false
+static bool read_cgroup_bytes(const char* dir, const char* name, size_t* out) {
+    char path[MP_PRESSURE_PATH_LEN + 32];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    unsigned long long v;
+    bool ok = fscanf(f, "%llu", &v) == 1;
+    fclose(f);
+    if (ok) *out = (size_t)v;
+    return ok;
+}
+
+// 由 /proc/self/cgroup 的 cgroup v2 条目（"0::/path"）推得本进程的 cgroup 目录
+static bool cgroup_self_dir(char* buf, size_t len) {
+    FILE* f = fopen("/proc/self/cgroup", "r");
+    if (!f) return false;
+    char line[MP_PRESSURE_PATH_LEN];
+    bool ok = false;
+    while (!ok && fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "0::", 3) != 0) continue;
+        line[strcspn(line, "\n")] = '\0';
+        ok = snprintf(buf, len, "/sys/fs/cgroup%s", line + 3) < (int)len;
+    }
+    fclose(f);
+    return ok;
+}
+
+// 单次检测：PSI some avg10 超过阈值，或 memory.current 接近 memory.high
+static bool pressure_detected(mp_pressure_monitor_t* m, double* avg10) {
+    bool pressure = false;
+    *avg10 = -1.0;
+    if (m->psi_path[0] && read_psi_some_avg10(m->psi_path, avg10) && *avg10 >= m->some_avg10) pressure = true;
+    size_t high, current;
+    if (m->cgroup_dir[0] && read_cgroup_bytes(m->cgroup_dir, "memory.high", &high) &&
+        read_cgroup_bytes(m->cgroup_dir, "memory.current", &current) &&
+        (double)current >= (double)high * m->high_ratio) {
+        pressure = true;
+    }
+    return pressure;
+}
+
+static void* pressure_monitor_main(void* arg) {
+    mp_pressure_monitor_t* m = (mp_pressure_monitor_t*)arg;
+    pthread_mutex_lock(&m->lock);
+    while (!m->stop) {
+        pthread_mutex_unlock(&m->lock);
+        double avg10;
+        bool pressure = pressure_detected(m, &avg10);
+        size_t released = pressure ? memory_pool_trim(m->pool, MP_TRIM_ALL) : 0;
+        if (pressure) MP_LOG("memory pressure pool=%p avg10=%.2f released=%zu", (void*)m->pool, avg10, released);
+        pthread_mutex_lock(&m->lock);
+        m->stats.polls++;
+        m->stats.last_some_avg10 = avg10;
+        if (pressure) {
+            m->stats.pressure_events++;
+            m->stats.bytes_released += released;
+        }
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += m->interval_ms / 1000;
+        ts.tv_nsec += (long)(m->interval_ms % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+        while (!m->stop && pthread_cond_timedwait(&m->cond, &m->lock, &ts) != ETIMEDOUT) {}
+    }
+    pthread_mutex_unlock(&m->lock);
+    return NULL;
+}
+
+bool memory_pool_pressure_monitor_start(memory_pool_t* pool, const mp_pressure_monitor_options_t* opts) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    // 后台线程并发修改池：要求线程安全；共享池的结构体中不能保存本进程的线程状态
+    if (!master->thread_safe || (master->seg_flags & MP_SEG_SHARED) || master->monitor) {
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return false;
+    }
+    mp_pressure_monitor_options_t o = { 0 };
+    if (opts) o = *opts;
+    mp_pressure_monitor_t* m = calloc(1, sizeof(*m));
+    if (!m) {
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    m->pool = master;
+    m->interval_ms = o.interval_ms ? o.interval_ms : MP_PRESSURE_DEFAULT_INTERVAL_MS;
+    m->some_avg10 = o.some_avg10 > 0 ? o.some_avg10 : MP_PRESSURE_DEFAULT_AVG10;
+    m->high_ratio = o.high_ratio > 0 ? o.high_ratio : MP_PRESSURE_DEFAULT_HIGH_RATIO;
+    m->stats.last_some_avg10 = -1.0;
+    char cg[MP_PRESSURE_PATH_LEN] = "";
+    bool have_cg = o.cgroup_dir ? snprintf(cg, sizeof(cg), "%s", o.cgroup_dir) < (int)sizeof(cg)
+                                : cgroup_self_dir(cg, sizeof(cg));
+    if (have_cg) snprintf(m->cgroup_dir, sizeof(m->cgroup_dir), "%s", cg);
+    if (o.psi_path) {
+        snprintf(m->psi_path, sizeof(m->psi_path), "%s", o.psi_path);
+    } else {
+        char path[MP_PRESSURE_PATH_LEN];
+        bool fits = snprintf(path, sizeof(path), "%s/memory.pressure", cg) < (int)sizeof(path);
+        const char* psi = (have_cg && fits && access(path, R_OK) == 0) ? path
+                        : access("/proc/pressure/memory", R_OK) == 0 ? "/proc/pressure/memory" : "";
+        snprintf(m->psi_path, sizeof(m->psi_path), "%s", psi);
+    }
+
+    pthread_condattr_t attr;
+    bool ok = pthread_condattr_init(&attr) == 0;
+    if (ok) {
+        ok = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0 && pthread_cond_init(&m->cond, &attr) == 0;
+        pthread_condattr_destroy(&attr);
+    }
+    if (ok && pthread_mutex_init(&m->lock, NULL) != 0) {
+        pthread_cond_destroy(&m->cond);
+        ok = false;
+    }
+    if (!ok) {
+        free(m);
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    pool_lock(master);
+    bool raced = master->monitor != NULL;
+    if (!raced) master->monitor = m;
+    pool_unlock(master);
+    if (raced || pthread_create(&m->thread, NULL, pressure_monitor_main, m) != 0) {
+        if (!raced) {
+            pool_lock(master);
+            master->monitor = NULL;
+            pool_unlock(master);
+        }
+        pthread_mutex_destroy(&m->lock);
+        pthread_cond_destroy(&m->cond);
+        free(m);
+        set_error(raced ? POOL_ERROR_INVALID_POINTER : POOL_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    MP_LOG("pressure monitor pool=%p psi=%s cgroup=%s interval=%u", (void*)master, m->psi_path, m->cgroup_dir, m->interval_ms);
+    set_error(POOL_OK);
+    return true;
+}
+
+void memory_pool_pressure_monitor_stop(memory_pool_t* pool) {
+    if (!pool) return;
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (!master->monitor) return;
+    pool_lock(master);
+    mp_pressure_monitor_t* m = master->monitor;
+    master->monitor = NULL;
+    pool_unlock(master);
+    if (!m) return;
+    pthread_mutex_lock(&m->lock);
+    m->stop = true;
+    pthread_cond_signal(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+    pthread_join(m->thread, NULL);
+    pthread_mutex_destroy(&m->lock);
+    pthread_cond_destroy(&m->cond);
+    free(m);
+}
+
+bool memory_pool_pressure_monitor_get_stats(memory_pool_t* pool, mp_pressure_monitor_stats_t* stats) {
+    if (!pool || !stats) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    bool found = false;
+    if (master->thread_safe) pool_lock(master);
+    mp_pressure_monitor_t* m = master->monitor;
+    if (m) {
+        pthread_mutex_lock(&m->lock);
+        *stats = m->stats;
+        pthread_mutex_unlock(&m->lock);
+        found = true;
+    }
+    if (master->thread_safe) pool_unlock(master);
+    set_error(found ? POOL_OK : POOL_ERROR_INVALID_POINTER);
+    return found;
+}
+
+// 内存碎片整理
+void memory_pool_defragment(memory_pool_t* pool) {
+    if (!pool) return;
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_DEFRAGMENT, 0);
+    uint64_t t0 = latency_begin(pool);
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    memory_pool_t* p = pool;
+    while (p) {
+    merge_free_blocks(p);
+    MP_LOG("defragment pool=%p", (void*)p);
+        p = p->next;
+    }
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+    latency_end(pool, MP_OP_DEFRAGMENT, t0);
+    if (tr) trace_end(tr, pool, &rec, NULL, NULL);
+}
+
+// 合并空闲块
+static void merge_free_blocks(memory_pool_t* pool) {
+    if (!pool->free_list) return;
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    const uintptr_t lb = link_base(pool);
+    memory_block_t* current = blk_at(lb, pool->free_list);
+    while (current) {
+        bool did_merge = false;
+        while (current->u.next && (char*)current + current->size == (char*)blk_at(lb, current->u.next)) {
+            memory_block_t* next_block = blk_at(lb, current->u.next);
+            rb_remove(master, next_block);
+            current->u.next = next_block->u.next;
+            if (!did_merge) { rb_remove(master, current); did_merge = true; }
+            current->size += next_block->size;
+        }
+        if (did_merge) {
+            current->flags &= ~MB_FLAG_ZEROED; // 被吞并块的块头位于零页范围内
+            rb_insert(master, current);
+            set_next_prev_free(pool, current);
+        }
+        current = blk_at(lb, current->u.next);
+    }
+}
+
+// 验证内存池完整性
+bool memory_pool_validate(memory_pool_t* pool) {
+    if (!pool) return false;
+
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    if (pool->poisoned) {
+        if (pool->thread_safe) pool_unlock(pool);
+        return false;
+    }
+
+    memory_pool_t* p = pool;
+    while (p) {
+        bool valid = true;
+        size_t total_free = 0;
+        const uintptr_t lb = link_base(p);
+        memory_block_t* current = blk_at(lb, p->free_list);
+        while (current) {
+            // 需推断所属 pool 获取种子： current 一定位于 p 内
+            if (!validate_block(current) || !MP_CHECK_BLOCK_MAGIC(p, current)) { valid = false; break; }
+            total_free += current->size;
+            current = blk_at(lb, current->u.next);
+        }
+    if (!(valid && (p->used_size + total_free == p->pool_size))) {
+#if MP_DEBUG
+        size_t dbg_total=0; size_t count=0; memory_block_t* c2=blk_at(lb, p->free_list);
+        while(c2){ dbg_total+=c2->size; count++; c2=blk_at(lb, c2->u.next); }
+        MP_LOG("validate fail pool=%p used=%zu free_sum=%zu expect=%zu blocks=%zu", (void*)p, p->used_size, dbg_total, p->pool_size, count);
+#endif
+            if (pool->thread_safe) pool_unlock(pool);
+            return false;
+        }
+        p = p->next;
+    }
+
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    for (int n = 0; n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(master, n);
+        if (arena && !memory_pool_validate(arena)) return false;
+    }
+    return true;
+}
+
+// ---- 文件映射持久化池 ----
+// 池结构体嵌入在文件头中，堆紧随其后；持久化池块头中的链接均为映射内地址（共享池为偏移，见下文）。
+// 重开时优先映射回上次的地址，此时整个堆（含红黑树、size-class 链表）原样可用；
+// 地址被占用时退化为整体重定位：按新基址改写所有元数据指针与地址相关的魔数。
+#define MP_PERSIST_MAGIC   0x314C4F4F50504D4CULL // "LMPPOOL1"
+#define MP_PERSIST_VERSION 1
+
+typedef struct mp_file_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t clean;                // 1 = 上次正常关闭
+    uint64_t file_size;            // 文件总长度
+    uint64_t header_size;          // 头部区域长度（页对齐），堆从此偏移开始
+    uint64_t struct_size;          // sizeof(memory_pool_t)，结构布局变化时拒绝打开
+    uint64_t base_addr;            // 上次映射地址
+    uint64_t root_offset;          // 用户根对象在堆内的偏移（0 = 未设置）
+    memory_pool_t pool;            // 嵌入的池结构体
+} mp_file_header_t;
+
+static inline size_t file_header_size(void) {
+    return align_size(sizeof(mp_file_header_t), PAGE_SIZE);
+}
+
+// 新建：扩展文件并在其中格式化一个空堆（seg_flags 区分持久化池与跨进程共享池）
+static memory_pool_t* file_pool_format(int fd, size_t size, uint32_t seg_flags) {
+    if (size == 0) {
+        set_error(POOL_ERROR_INVALID_SIZE);
+        return NULL;
+    }
+    size_t hdr = file_header_size();
+    size_t heap = align_size(size, PAGE_SIZE);
+    if (ftruncate(fd, (off_t)(hdr + heap)) != 0) {
+        set_error(POOL_ERROR_IO);
+        return NULL;
+    }
+    char* base = mmap(NULL, hdr + heap, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        set_error(POOL_ERROR_IO);
+        return NULL;
+    }
+    mp_file_header_t* fh = (mp_file_header_t*)base;
+    memory_pool_t* pool = &fh->pool;
+    if (seg_flags & MP_SEG_SHARED) {
+        // 共享池的链接、堆与映射起点都相对映射起点保存，各进程可映射在任意地址
+        pool->self_offset = offsetof(mp_file_header_t, pool);
+        pool->pool_start = (void*)hdr;
+        pool->map_base = (void*)0;
+    } else {
+        pool->pool_start = base + hdr;
+        pool->map_base = base;
+    }
+    pool->pool_size = heap;
+    pool->seg_flags = seg_flags;
+    pool->reserved_size = 0;
+    pool->map_size = hdr + heap;
+    pool->fd = (seg_flags & MP_SEG_SHARED) ? -1 : fd; // 共享结构体中不能保存进程私有的描述符
+    pool_config_t cfg = { .pool_size = heap, .thread_safe = true, .alignment = DEFAULT_ALIGNMENT };
+    if (!pool_init(pool, &cfg)) {
+        munmap(base, hdr + heap);
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    fh->version = MP_PERSIST_VERSION;
+    fh->clean = 0;
+    fh->file_size = hdr + heap;
+    fh->header_size = hdr;
+    fh->struct_size = sizeof(memory_pool_t);
+    fh->base_addr = (uint64_t)(uintptr_t)base;
+    fh->root_offset = 0;
+    // 魔数最后写入并单独落盘：格式化中途失败或崩溃的文件魔数为 0，下次打开时重新格式化
+    if (!(seg_flags & MP_SEG_SHARED)) msync(base, hdr + PAGE_SIZE, MS_SYNC);
+    fh->magic = MP_PERSIST_MAGIC;
+    if (!(seg_flags & MP_SEG_SHARED)) msync(base, PAGE_SIZE, MS_SYNC);
+    MP_LOG("file pool format fd=%d heap=%zu base=%p flags=%x", fd, heap, (void*)base, seg_flags);
+    return pool;
+}
+
+#define MP_RELOC(ptr, delta) do { if (ptr) (ptr) = (void*)((char*)(ptr) + (delta)); } while (0)
+#define MP_RELOC_LINK(link, delta) do { if (link) (link) += (mp_link_t)(delta); } while (0)
+
+// 映射地址变化后的整体重定位（单段：文件池不含子池）。持久化池的 link base 为 0，
+// 链接即地址，须逐个改写；共享池的链接相对映射起点，不需要重定位
+static bool persist_relocate(memory_pool_t* pool, char* old_start) {
+    char* start = pool_heap(pool);
+    char* end = start + pool->pool_size;
+    ptrdiff_t delta = start - old_start;
+    // 物理遍历：校验旧地址下的魔数，并按新地址重写
+    for (char* cur = start; cur < end; ) {
+        memory_block_t* b = (memory_block_t*)cur;
+        if (b->size < sizeof(memory_block_t) || b->size > (size_t)(end - cur)) return false;
+        if (b->magic != (pool->magic_seed ^ (uint32_t)(uintptr_t)(cur - delta))) return false;
+        b->magic = MP_MAKE_BLOCK_MAGIC(pool, b);
+        cur += b->size;
+    }
+    MP_RELOC_LINK(pool->free_list, delta);
+    MP_RELOC_LINK(pool->rb_root, delta);
+    for (memory_block_t* b = blk_at(0, pool->free_list); b; b = blk_at(0, b->u.next)) {
+        MP_RELOC_LINK(b->u.next, delta);
+        MP_RELOC_LINK(b->rb_left, delta);
+        MP_RELOC_LINK(b->rb_right, delta);
+        MP_RELOC_LINK(b->rb_parent, delta);
+    }
+    for (int i = 0; i < pool->num_classes; i++) {
+        MP_RELOC_LINK(pool->size_classes[i].free_blocks, delta);
+        for (memory_block_t* b = blk_at(0, pool->size_classes[i].free_blocks); b; b = blk_at(0, b->u.next)) {
+            MP_RELOC_LINK(b->u.next, delta);
+        }
+        MP_RELOC(pool->size_classes[i].slabs, delta);
+        for (struct mp_slab* sl = pool->size_classes[i].slabs; sl; sl = sl->next) {
+            MP_RELOC(sl->next, delta);
+        }
+    }
+    MP_LOG("persist relocate pool=%p delta=%td", (void*)pool, delta);
+    return true;
+}
+
+// 非正常关闭后的恢复：空闲链与红黑树可能停在某次更新的中途，不能直接信任。
+// 先物理遍历校验每个块头，再按块标志重建空闲链、红黑树、PREV_FREE 元数据与 used_size；
+// size-class 私有链与 slab 链逐项校验（越界、魔数不符或成环即视为损坏）。调用方独占该池
+static bool persist_recover(memory_pool_t* pool) {
+    const uintptr_t lb = link_base(pool);
+    char* start = pool_heap(pool);
+    char* end = start + pool->pool_size;
+    size_t nblocks = 0;
+    for (char* cur = start; cur < end; ) {
+        memory_block_t* b = (memory_block_t*)cur;
+        if (b->size < sizeof(memory_block_t) || b->size > (size_t)(end - cur) || !MP_CHECK_BLOCK_MAGIC(pool, b)) {
+            MP_LOG("persist recover: bad block %p", (void*)b);
+            return false;
+        }
+        nblocks++;
+        cur += b->size;
+    }
+    for (int i = 0; i < pool->num_classes; i++) {
+        size_t steps = 0;
+        for (memory_block_t* b = blk_at(lb, pool->size_classes[i].free_blocks); b; b = blk_at(lb, b->u.next)) {
+            if ((char*)b < start || (char*)b >= end || ++steps > nblocks ||
+                !MP_CHECK_BLOCK_MAGIC(pool, b) || !(b->flags & MB_FLAG_SIZECLASS)) {
+                MP_LOG("persist recover: bad size-class list %d", i);
+                return false;
+            }
+        }
+        steps = 0;
+        for (mp_slab_t* sl = pool->size_classes[i].slabs; sl; sl = sl->next) {
+            if ((char*)sl < start || (char*)sl >= end || ++steps > nblocks ||
+                sl->magic != (MP_SLAB_MAGIC ^ pool->magic_seed)) {
+                MP_LOG("persist recover: bad slab list %d", i);
+                return false;
+            }
+        }
+    }
+    pool->free_list = 0;
+    pool->rb_root = 0;
+    memory_block_t* tail = NULL;
+    size_t free_bytes = 0;
+    bool prev_free = false;
+    for (char* cur = start; cur < end; ) {
+        memory_block_t* b = (memory_block_t*)cur;
+        bool general_free = (b->flags & MB_FLAG_FREE) && !(b->flags & MB_FLAG_SIZECLASS);
+        if (general_free) {
+            b->flags &= ~MB_FLAG_PREV_FREE;
+            rb_init_node(b);
+            rb_insert(pool, b);
+            b->u.next = 0;
+            if (tail) tail->u.next = blk_link(lb, b);
+            else pool->free_list = blk_link(lb, b);
+            tail = b;
+            free_bytes += b->size;
+        } else if (!(b->flags & MB_FLAG_SIZECLASS)) {
+            // size-class 块的 u 是私有链链接，不写 prev_size
+            if (prev_free) {
+                b->flags |= MB_FLAG_PREV_FREE;
+                b->u.prev_size = tail->size; // 前一物理块即刚挂入的空闲块
+            } else {
+                b->flags &= ~MB_FLAG_PREV_FREE;
+            }
+        }
+        prev_free = general_free;
+        cur += b->size;
+    }
+    pool->used_size = pool->pool_size - free_bytes;
+    MP_LOG("persist recover pool=%p blocks=%zu free=%zu", (void*)pool, nblocks, free_bytes);
+    return true;
+}
+
+// 读取并校验文件头
+static bool read_file_header(int fd, size_t file_size, mp_file_header_t* h) {
+    return pread(fd, h, sizeof(*h), 0) == (ssize_t)sizeof(*h) &&
+           h->magic == MP_PERSIST_MAGIC && h->version == MP_PERSIST_VERSION &&
+           h->struct_size == sizeof(memory_pool_t) && h->header_size == file_header_size() &&
+           h->file_size == file_size;
+}
+
+// 重开已有文件
+static memory_pool_t* persist_open(int fd, size_t file_size) {
+    mp_file_header_t h;
+    if (!read_file_header(fd, file_size, &h) || (h.pool.seg_flags & MP_SEG_SHARED)) {
+        set_error(POOL_ERROR_CORRUPTION);
+        return NULL;
+    }
+    int fixed = 0;
+#ifdef MAP_FIXED_NOREPLACE
+    fixed = MAP_FIXED_NOREPLACE;
+#endif
+    char* base = mmap((void*)(uintptr_t)h.base_addr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED | fixed, fd, 0);
+    if (base == MAP_FAILED && fixed) {
+        base = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (base == MAP_FAILED) {
+        set_error(POOL_ERROR_IO);
+        return NULL;
+    }
+    mp_file_header_t* fh = (mp_file_header_t*)base;
+    memory_pool_t* pool = &fh->pool;
+    char* old_start = (char*)pool->pool_start; // 持久化池保存绝对地址
+    // 进程相关字段重新建立
+    pool->pool_start = base + h.header_size;
+    pool->map_base = base;
+    pool->map_size = file_size;
+    pool->fd = fd;
+    pool->next = NULL;
+    pool->master = pool;
+    pool->self_offset = (uintptr_t)pool; // 旧链接按 old_start 重定位为本次映射的绝对地址
+    pool->idle_since_ms = 0;
+    pool->idle_children = 0;
+    memset(pool->numa_arenas, 0, sizeof(pool->numa_arenas));
+    pool->pressure_cb = NULL;
+    pool->pressure_user = NULL;
+    pool->in_pressure_cb = false;
+    pool->monitor = NULL;
+    pool->zero_refiller = NULL;
+    pool->reset_gen = 0;
+    pool->zero_refills = 0;
+    pool->latency = NULL;
+    pool->trace = NULL;
+    pool->cold_arena = NULL;
+    pool->short_arena = NULL;
+    pool->request_arena = NULL;
+    pool->arena_hint = MP_HINT_NONE;
+    pool->budget = NULL;
+    if ((uintptr_t)base != h.base_addr && !persist_relocate(pool, old_start)) {
+        munmap(base, file_size);
+        set_error(POOL_ERROR_CORRUPTION);
+        return NULL;
     }
-
-    // 前缀回收
-    if (prefix >= MIN_BLOCK_SIZE) {
-        memory_block_t* pre = (memory_block_t*)raw;
-        pre->size = prefix;
-    pre->magic = MP_MAKE_BLOCK_MAGIC(owner, pre);
-        pre->flags = MB_FLAG_FREE;
-        pre->u.next = NULL;
-        insert_free_block(owner, pre);
-        set_next_prev_free(owner, pre);
-        pre->flags &= ~MB_FLAG_PREV_FREE; // 物理首块或其前驱不一定空闲
+    fh->base_addr = (uint64_t)(uintptr_t)base;
+    if (pool->thread_safe && pthread_mutex_init(&pool->mutex, NULL) != 0) {
+        munmap(base, file_size);
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return NULL;
     }
-
-    // 设置对齐后的使用块头
-    aligned_block->size = used_total;
-    aligned_block->magic = MP_MAKE_BLOCK_MAGIC(owner, aligned_block);
-    aligned_block->flags &= ~MB_FLAG_FREE; // allocated
-    if (prefix >= MIN_BLOCK_SIZE) {
-        aligned_block->flags |= MB_FLAG_PREV_FREE;
-    aligned_block->u.prev_size = ((memory_block_t*)raw)->size;
-    } else {
-        aligned_block->flags &= ~MB_FLAG_PREV_FREE;
+    // 未正常关闭（进程崩溃）时校验全部块头并重建空闲结构，随后必须通过完整性校验
+    bool was_clean = fh->clean != 0;
+    fh->clean = 0;
+    if (!was_clean && (!persist_recover(pool) || !memory_pool_validate(pool))) {
+        if (pool->thread_safe) pthread_mutex_destroy(&pool->mutex);
+        munmap(base, file_size);
+        set_error(POOL_ERROR_CORRUPTION);
+        return NULL;
     }
-    aligned_block->u.next = NULL;
+    MP_LOG("persist open fd=%d base=%p clean=%d", fd, (void*)base, (int)was_clean);
+    return pool;
+}
 
-    // 尾部回收
-    if (suffix >= MIN_BLOCK_SIZE) {
-        memory_block_t* suf = (memory_block_t*)((char*)aligned_block + used_total);
-        suf->size = suffix;
-    suf->magic = MP_MAKE_BLOCK_MAGIC(owner, suf);
-        suf->flags = MB_FLAG_FREE;
-        suf->u.next = NULL;
-        insert_free_block(owner, suf);
-        set_next_prev_free(owner, suf);
+// 创建或重新打开文件映射持久化池
+memory_pool_t* memory_pool_create_persistent(const char* path, size_t size) {
+    if (!path) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return NULL;
     }
-    else {
-        // 没有尾部自由块，则需要清理下一物理块的 PREV_FREE（前驱已分配 & 无新自由块）
-        clear_next_prev_free(owner, aligned_block);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        set_error(POOL_ERROR_IO);
+        return NULL;
     }
-
-    owner->used_size += used_total;
-    MP_LOG("alloc_aligned pool=%p user=%p size=%zu align=%zu used_total=%zu", (void*)owner, (void*)((char*)aligned_block + sizeof(memory_block_t)), (size_t)size, (size_t)alignment, (size_t)used_total);
-
-    if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+    // 独占锁：同一文件同时被两次打开时，第二次会映射到别处并重定位，改坏正在使用的映射。
+    // 锁随描述符关闭（persist_close）释放，进程崩溃时由内核释放
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        MP_LOG("persistent pool %s is in use (errno=%d)", path, errno);
+        close(fd);
+        set_error(POOL_ERROR_IO);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        set_error(POOL_ERROR_IO);
+        return NULL;
+    }
+    // 魔数为 0：上次格式化未完成，按空文件重新格式化
+    uint64_t magic = 0;
+    bool unformatted = st.st_size == 0 ||
+                       (pread(fd, &magic, sizeof(magic), 0) == (ssize_t)sizeof(magic) && magic == 0);
+    memory_pool_t* pool = unformatted ? file_pool_format(fd, size, MP_SEG_FILE) : persist_open(fd, (size_t)st.st_size);
+    if (!pool) {
+        if (unformatted && ftruncate(fd, 0) != 0) MP_LOG("truncate after failed format failed (errno=%d)", errno);
+        close(fd);
+        return NULL;
     }
-
     set_error(POOL_OK);
-    return (char*)aligned_block + sizeof(memory_block_t);
+    return pool;
 }
 
-// 分配并清零
-void* memory_pool_calloc(memory_pool_t* pool, size_t count, size_t size) {
-    if (!pool || count == 0 || size == 0) {
-        set_error(POOL_ERROR_INVALID_SIZE);
+// ---- 跨进程共享池 ----
+// 与持久化池共用文件布局；池结构体（含 robust 互斥锁）位于共享映射内。
+// 块头链接与池内地址字段都保存为相对映射起点的偏移，各进程可映射在任意地址，进程间以偏移传递对象。
+
+// 在共享对象上格式化新池；成功后描述符不再需要
+static memory_pool_t* shared_create_on_fd(int fd, size_t size) {
+    memory_pool_t* pool = file_pool_format(fd, size, MP_SEG_FILE | MP_SEG_SHARED);
+    if (pool) set_error(POOL_OK);
+    return pool;
+}
+
+// 创建具名共享池（shm_open），name 形如 "/my_pool"，已存在时失败
+memory_pool_t* memory_pool_create_shared(const char* name, size_t size) {
+    if (!name) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return NULL;
+    }
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        set_error(POOL_ERROR_IO);
         return NULL;
     }
+    memory_pool_t* pool = shared_create_on_fd(fd, size);
+    close(fd);
+    if (!pool) shm_unlink(name);
+    return pool;
+}
 
-    // 检查溢出
-    if (count > SIZE_MAX / size) {
-        set_error(POOL_ERROR_INVALID_SIZE);
+// 创建匿名共享池（memfd），*fd_out 由调用方持有，可经 fork 或 SCM_RIGHTS 传给其他进程
+memory_pool_t* memory_pool_create_shared_fd(size_t size, int* fd_out) {
+    if (!fd_out) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return NULL;
+    }
+    int fd = memfd_create("libmempool", MFD_CLOEXEC);
+    if (fd < 0) {
+        set_error(POOL_ERROR_IO);
+        return NULL;
+    }
+    memory_pool_t* pool = shared_create_on_fd(fd, size);
+    if (!pool) {
+        close(fd);
         return NULL;
     }
+    *fd_out = fd;
+    return pool;
+}
 
-    size_t total_size = count * size;
-    void* ptr = memory_pool_alloc(pool, total_size);
-    
-    if (ptr) {
-        memset(ptr, 0, total_size);
+// 映射到任意地址：池内元数据均为偏移，不依赖创建者的映射地址
+memory_pool_t* memory_pool_attach_shared_fd(int fd) {
+    struct stat st;
+    mp_file_header_t h;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        set_error(POOL_ERROR_IO);
+        return NULL;
     }
-    
-    return ptr;
+    if (!read_file_header(fd, (size_t)st.st_size, &h) || !(h.pool.seg_flags & MP_SEG_SHARED)) {
+        set_error(POOL_ERROR_CORRUPTION);
+        return NULL;
+    }
+    char* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        set_error(POOL_ERROR_IO);
+        return NULL;
+    }
+    MP_LOG("shared attach fd=%d base=%p", fd, (void*)base);
+    set_error(POOL_OK);
+    return &((mp_file_header_t*)base)->pool;
 }
 
-// 插入空闲块到链表中（按地址排序，便于合并）
-static void insert_free_block(memory_pool_t* pool, memory_block_t* block) {
-    if (block->flags & MB_FLAG_SIZECLASS) {
-        // size-class 块不进入通用空闲链
-        return;
+memory_pool_t* memory_pool_attach_shared(const char* name) {
+    if (!name) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return NULL;
     }
-    // 标记为空闲（通用）
-    block->flags |= MB_FLAG_FREE;
-    // 插入主池 RB 树（按 size 排序）
-    memory_pool_t* master = pool->master ? pool->master : pool;
-    rb_insert(master, block);
-    if (!pool->free_list || block < pool->free_list) {
-        block->u.next = pool->free_list;
-        pool->free_list = block;
-        return;
+    int fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        set_error(POOL_ERROR_IO);
+        return NULL;
     }
-    memory_block_t* current = pool->free_list;
-    while (current->u.next && current->u.next < block) {
-        current = current->u.next;
+    memory_pool_t* pool = memory_pool_attach_shared_fd(fd);
+    close(fd);
+    return pool;
+}
+
+// 删除具名共享池的名字；已映射的进程不受影响
+bool memory_pool_unlink_shared(const char* name) {
+    if (!name || shm_unlink(name) != 0) {
+        set_error(name ? POOL_ERROR_IO : POOL_ERROR_NULL_POINTER);
+        return false;
     }
-    block->u.next = current->u.next;
-    current->u.next = block;
+    set_error(POOL_OK);
+    return true;
 }
 
-// 释放内存
-void memory_pool_free(memory_pool_t* pool, void* ptr) {
-    if (!pool || !ptr) {
+// 关闭文件池：打上正常关闭标记后解除映射
+static void persist_close(memory_pool_t* pool) {
+    mp_file_header_t* fh = (mp_file_header_t*)pool_map(pool);
+    int fd = pool->fd;
+    fh->clean = 1;
+    munmap(pool_map(pool), pool->map_size);
+    close(fd);
+}
+
+// 将文件池内容同步落盘
+bool memory_pool_sync(memory_pool_t* pool) {
+    if (!pool) {
         set_error(POOL_ERROR_NULL_POINTER);
-        return;
+        return false;
+    }
+    if (!(pool->seg_flags & MP_SEG_FILE)) {
+        set_error(POOL_OK);
+        return true;
+    }
+    if (msync(pool_map(pool), pool->map_size, MS_SYNC) != 0) {
+        set_error(POOL_ERROR_IO);
+        return false;
     }
+    set_error(POOL_OK);
+    return true;
+}
 
-    // 检查指针是否在池范围内
-    // 找到所属池
-    memory_pool_t* owner = pool;
-    while (owner && !pool_contains(owner, ptr)) owner = owner->next;
-    if (!owner) { set_error(POOL_ERROR_INVALID_POINTER); return; }
+// 指针 <-> 主段内偏移（偏移 0 为首块头，不会是用户指针，用作 NULL）
+size_t memory_pool_ptr_to_offset(memory_pool_t* pool, const void* ptr) {
+    if (!pool || !ptr || !pool_contains(pool, (void*)ptr)) return 0;
+    return (size_t)((const char*)ptr - pool_heap(pool));
+}
 
-    memory_block_t* block = (memory_block_t*)((char*)ptr - sizeof(memory_block_t));
+void* memory_pool_offset_to_ptr(memory_pool_t* pool, size_t offset) {
+    if (!pool || offset == 0 || offset >= pool->pool_size) return NULL;
+    return pool_heap(pool) + offset;
+}
 
-    // 验证块的完整性
-    if (!validate_block(block) || !MP_CHECK_BLOCK_MAGIC(owner, block)) {
-        set_error(POOL_ERROR_CORRUPTION);
-        return;
+// 持久化池的根对象：重开后据此找回数据
+bool memory_pool_set_root(memory_pool_t* pool, void* ptr) {
+    if (!pool || !(pool->seg_flags & MP_SEG_FILE)) {
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return false;
+    }
+    size_t off = memory_pool_ptr_to_offset(pool, ptr);
+    if (ptr && !off) {
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return false;
+    }
+    ((mp_file_header_t*)pool_map(pool))->root_offset = off;
+    set_error(POOL_OK);
+    return true;
+}
+
+void* memory_pool_get_root(memory_pool_t* pool) {
+    if (!pool || !(pool->seg_flags & MP_SEG_FILE)) return NULL;
+    return memory_pool_offset_to_ptr(pool, (size_t)((mp_file_header_t*)pool_map(pool))->root_offset);
+}
+
+// 统计透明大页实际覆盖：扫描 /proc/self/smaps，累加与池段重叠 VMA 的 AnonHugePages
+static size_t thp_backed_bytes(memory_pool_t* pool) {
+    FILE* f = fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+    char line[256];
+    size_t total = 0;
+    size_t vma_len = 0, overlap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long start, end;
+        size_t kb;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            vma_len = end - start;
+            overlap = 0;
+            for (memory_pool_t* p = pool; p; p = p->next) {
+                uintptr_t s = (uintptr_t)pool_heap(p), e = s + p->pool_size;
+                uintptr_t lo = s > start ? s : start, hi = e < end ? e : end;
+                if (lo < hi) overlap += hi - lo;
+            }
+        } else if (overlap && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+            // VMA 可能与相邻映射合并，按重叠比例折算
+            size_t bytes = kb * 1024;
+            total += (overlap >= vma_len) ? bytes : (size_t)((double)bytes * overlap / vma_len);
+        }
     }
+    fclose(f);
+    return total;
+}
 
+// 大页覆盖统计
+bool memory_pool_get_huge_page_stats(memory_pool_t* pool, mp_huge_page_stats_t* stats) {
+    if (!pool || !stats) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    memset(stats, 0, sizeof(*stats));
     if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
+        pool_lock(pool);
     }
-
-    // 若为 size-class 块，改用 fixed 释放逻辑（不触发合并）
-    if (block->flags & MB_FLAG_SIZECLASS) {
-        if (pool->thread_safe) pthread_mutex_unlock(&pool->mutex);
-        memory_pool_free_fixed(owner, ptr);
-        return;
+    for (memory_pool_t* p = pool; p; p = p->next) {
+        stats->segments++;
+        stats->total_bytes += p->pool_size;
+        if (p->seg_flags & MP_SEG_HUGETLB) stats->hugetlb_bytes += p->pool_size;
+        if (p->seg_flags & MP_SEG_THP) stats->thp_advised_bytes += p->pool_size;
+    }
+    if (stats->thp_advised_bytes) stats->thp_backed_bytes = thp_backed_bytes(pool);
+    if (pool->thread_safe) {
+        pool_unlock(pool);
     }
+    set_error(POOL_OK);
+    return true;
+}
 
-    // 双重释放检测（仅适用于通用 free；固定大小池内部释放由 free_fixed）
-    if (block->flags & MB_FLAG_FREE) {
-        if (pool->thread_safe) pthread_mutex_unlock(&pool->mutex);
-        set_error(POOL_ERROR_DOUBLE_FREE);
-        MP_LOG("double free detected blk=%p", (void*)block);
-        return;
+// ---- 内存占用报告 ----
+// 段内常驻字节：mincore 分批查询，避免为大段一次分配整张向量
+static size_t segment_resident_bytes(memory_pool_t* p) {
+    unsigned char vec[1024];
+    char* base = pool_heap(p);
+    size_t pages = p->pool_size / PAGE_SIZE;
+    size_t resident = 0;
+    for (size_t off = 0; off < pages; off += sizeof(vec)) {
+        size_t n = pages - off < sizeof(vec) ? pages - off : sizeof(vec);
+        if (mincore(base + off * PAGE_SIZE, n * PAGE_SIZE, vec) != 0) return 0;
+        for (size_t i = 0; i < n; i++) resident += vec[i] & 1;
     }
-    owner->used_size -= block->size;
-    MP_LOG("free pool=%p user=%p blk_size=%zu", (void*)owner, ptr, (size_t)block->size);
+    return resident * PAGE_SIZE;
+}
 
-    // 重写合并逻辑：先计算最终合并后的块大小，再一次性插入空闲结构（避免红黑树中途 size 变化破坏有序性）
-    memory_block_t* base = block; // 最终要插入的块
-    // bool merged_backward = false; // 已不再需要
-    if (block->flags & MB_FLAG_PREV_FREE) {
-        memory_block_t* prev = (memory_block_t*)((char*)block - block->u.prev_size);
-        if (validate_block(prev) && (prev->flags & MB_FLAG_FREE) && (char*)prev + prev->size == (char*)block) {
-            // 从自由结构中移除 prev（它本就在 free_list 和 RB 中）
-            MP_LOG("free coalesce backward prev=%p size=%zu with blk=%p size=%zu", (void*)prev, (size_t)prev->size, (void*)block, (size_t)block->size);
-            remove_free_block(owner, prev);
-            prev->size += block->size;
-            base = prev;
+// 物理遍历一个段的块：统计空闲 / 已分配与块头开销（调用方持锁）
+static void segment_report(memory_pool_t* p, mp_segment_report_t* sr, size_t* free_blocks,
+                           size_t* allocated_blocks, size_t* header_bytes) {
+    memset(sr, 0, sizeof(*sr));
+    sr->start = pool_heap(p);
+    sr->committed_bytes = p->pool_size;
+    sr->reserved_bytes = p->reserved_size > p->pool_size ? p->reserved_size - p->pool_size : 0;
+    sr->resident_bytes = segment_resident_bytes(p);
+    sr->seg_flags = p->seg_flags;
+    char* end = pool_heap(p) + p->pool_size;
+    for (char* cur = pool_heap(p); cur < end;) {
+        memory_block_t* b = (memory_block_t*)cur;
+        if (b->size < sizeof(memory_block_t) || b->size > (size_t)(end - cur)) break;
+        if (b->flags & MB_FLAG_FREE) {
+            sr->free_bytes += b->size;
+            if (b->size > sr->largest_free_block) sr->largest_free_block = b->size;
+            (*free_blocks)++;
         } else {
-            block->flags &= ~MB_FLAG_PREV_FREE; // 清理无效标记，按未合并处理
+            sr->used_bytes += b->size;
+            *header_bytes += sizeof(memory_block_t);
+            (*allocated_blocks)++;
         }
+        cur += b->size;
     }
+}
 
-    // 向前（后继）合并：不断吸收紧邻的自由块
-    while (1) {
-        memory_block_t* nxt = next_physical_block(owner, base);
-        if (!nxt || (nxt->flags & MB_FLAG_SIZECLASS) || !(nxt->flags & MB_FLAG_FREE) || (char*)base + base->size != (char*)nxt) break;
-        remove_free_block(owner, nxt); // detach nxt (包括 RB)
-    MP_LOG("free coalesce forward base=%p new_size=%zu absorb nxt=%p size=%zu", (void*)base, (size_t)(base->size + nxt->size), (void*)nxt, (size_t)nxt->size);
-        base->size += nxt->size;
+// 累加一条链（master 及其子池）；调用方持 master 锁
+static void chain_memory_report(memory_pool_t* master, mp_memory_report_t* r) {
+    for (memory_pool_t* p = master; p; p = p->next) {
+        mp_segment_report_t sr;
+        segment_report(p, &sr, &r->free_blocks, &r->allocated_blocks, &r->header_bytes);
+        r->segments++;
+        r->committed_bytes += sr.committed_bytes;
+        r->reserved_bytes += sr.reserved_bytes;
+        r->resident_bytes += sr.resident_bytes;
+        r->used_bytes += sr.used_bytes;
+        r->free_bytes += sr.free_bytes;
+        if (sr.largest_free_block > r->largest_free_block) r->largest_free_block = sr.largest_free_block;
+        for (int i = 0; i < p->num_classes; i++) {
+            size_class_pool_t* sc = &p->size_classes[i];
+            for (memory_block_t* b = blk_at(link_base(p), sc->free_blocks); b; b = blk_at(link_base(p), b->u.next)) r->size_class_reserve_bytes += b->size;
+            for (mp_slab_t* sl = sc->slabs; sl; sl = sl->next) {
+                r->size_class_reserve_bytes += (size_t)(sl->capacity - sl->used) * sl->obj_size;
+                r->header_bytes += sl->objects_offset;
+            }
+        }
     }
+    for (int i = 0; i < master->num_zero_reserves; i++) {
+        for (void* z = master->zero_reserves[i].head; z; z = *(void**)z) {
+            r->zero_reserve_bytes += ((memory_block_t*)((char*)z - sizeof(memory_block_t)))->size;
+        }
+    }
+}
 
-    // 现在 base 还未在 RB/链表内（若 backward 合并则已移除；若未 backward 合并则是新释放块，不在结构中）
-    base->flags |= MB_FLAG_FREE;
-    base->flags &= ~MB_FLAG_PREV_FREE; // 自身作为自由块不需要该标记
-    base->u.next = NULL;
-    insert_free_block(owner, base); // 一次性按新 size 插入
-    set_next_prev_free(owner, base); // 设置其后继的 PREV_FREE
-
+bool memory_pool_get_memory_report(memory_pool_t* pool, mp_memory_report_t* report) {
+    if (!pool || !report) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    memset(report, 0, sizeof(*report));
+    memory_pool_t* master = pool->master ? pool->master : pool;
     if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+        pool_lock(pool);
+    }
+    chain_memory_report(master, report);
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+    for (int n = 0; n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(master, n);
+        if (!arena) continue;
+        if (arena->thread_safe) pool_lock(arena);
+        chain_memory_report(arena, report);
+        if (arena->thread_safe) pool_unlock(arena);
+    }
+    if (report->free_bytes) {
+        report->fragmentation = 1.0 - (double)report->largest_free_block / (double)report->free_bytes;
     }
-
     set_error(POOL_OK);
+    return true;
 }
 
-// 重新分配内存
-void* memory_pool_realloc(memory_pool_t* pool, void* ptr, size_t new_size) {
+size_t memory_pool_get_segment_reports(memory_pool_t* pool, mp_segment_report_t* out, size_t max) {
     if (!pool) {
         set_error(POOL_ERROR_NULL_POINTER);
+        return 0;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    size_t count = 0;
+    for (memory_pool_t* p = master; p; p = p->next, count++) {
+        if (!out || count >= max) continue;
+        size_t free_blocks = 0, allocated_blocks = 0, header_bytes = 0;
+        segment_report(p, &out[count], &free_blocks, &allocated_blocks, &header_bytes);
+    }
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+    set_error(POOL_OK);
+    return count;
+}
+
+// ---- 堆遍历 ----
+// 通用已分配块带 MB_FLAG_SLAB 且用户区是有效的紧凑 slab 时返回该 slab。调用方持锁
+static mp_slab_t* walk_slab_of(memory_pool_t* master, memory_block_t* b) {
+    mp_slab_t* s = (mp_slab_t*)(b + 1);
+    if (!(b->flags & MB_FLAG_SLAB) || b->size < sizeof(memory_block_t) + sizeof(mp_slab_t) ||
+        s->magic != (MP_SLAB_MAGIC ^ master->magic_seed)) {
         return NULL;
     }
+    return s;
+}
 
-    if (!ptr) {
-        return memory_pool_alloc(pool, new_size);
+// 一次遍历内 size-class 私有空闲链上的块（未交给调用方）：按地址排序，逐块二分查找
+typedef struct walk_cached_set {
+    memory_block_t** blocks;
+    size_t count;
+} walk_cached_set_t;
+
+static int walk_ptr_cmp(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)*(memory_block_t* const*)a;
+    uintptr_t y = (uintptr_t)*(memory_block_t* const*)b;
+    return x < y ? -1 : x > y;
+}
+
+// 收集全部类私有空闲链并排序；内存不足返回 false。调用方持锁
+static bool walk_cached_collect(memory_pool_t* master, walk_cached_set_t* set) {
+    const uintptr_t lb = link_base(master);
+    size_t n = 0;
+    for (int i = 0; i < master->num_classes; i++) {
+        for (memory_block_t* c = blk_at(lb, master->size_classes[i].free_blocks); c; c = blk_at(lb, c->u.next)) n++;
     }
+    set->blocks = NULL;
+    set->count = 0;
+    if (!n) return true;
+    set->blocks = malloc(n * sizeof(*set->blocks));
+    if (!set->blocks) return false;
+    for (int i = 0; i < master->num_classes; i++) {
+        for (memory_block_t* c = blk_at(lb, master->size_classes[i].free_blocks); c; c = blk_at(lb, c->u.next)) set->blocks[set->count++] = c;
+    }
+    qsort(set->blocks, set->count, sizeof(*set->blocks), walk_ptr_cmp);
+    return true;
+}
 
-    if (new_size == 0) {
-        memory_pool_free(pool, ptr);
-        return NULL;
+static bool walk_class_cached(const walk_cached_set_t* set, memory_block_t* b) {
+    size_t lo = 0, hi = set->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (set->blocks[mid] == b) return true;
+        if ((uintptr_t)set->blocks[mid] < (uintptr_t)b) lo = mid + 1;
+        else hi = mid;
     }
+    return false;
+}
 
-    // 获取当前块大小
-    size_t old_size = memory_pool_get_block_size(pool, ptr);
-    if (old_size == 0) {
-        set_error(POOL_ERROR_INVALID_POINTER);
-        return NULL;
+// 遍历一条链（master 及其子池）。返回 false 表示回调要求停止或发现损坏（*corrupt 区分）。调用方持 master 锁
+static bool walk_chain(memory_pool_t* master, const walk_cached_set_t* cached, mp_walk_callback_t cb, void* ctx,
+                       size_t* count, bool* corrupt) {
+    for (memory_pool_t* p = master; p; p = p->next) {
+        char* end = pool_heap(p) + p->pool_size;
+        for (memory_block_t* b = (memory_block_t*)pool_heap(p); b; b = next_physical_block(p, b)) {
+            if (!validate_block(b) || b->size > (size_t)(end - (char*)b) || !MP_CHECK_BLOCK_MAGIC(p, b)) {
+                MP_LOG("walk: corrupt block seg=%p blk=%p size=%zu", (void*)p, (void*)b, (size_t)b->size);
+                *corrupt = true;
+                return false;
+            }
+            mp_block_info_t info = { b, b + 1, b->size, MP_BLOCK_ALLOCATED, true, p };
+            if (b->flags & MB_FLAG_SIZECLASS) {
+                info.state = MP_BLOCK_SIZE_CLASS;
+                info.in_use = !walk_class_cached(cached, b);
+            } else if (b->flags & MB_FLAG_FREE) {
+                info.state = MP_BLOCK_FREE;
+                info.in_use = false;
+            } else {
+                mp_slab_t* s = walk_slab_of(master, b);
+                if (s) {
+                    info.state = MP_BLOCK_SIZE_CLASS;
+                    info.in_use = s->used > 0;
+                }
+            }
+            (*count)++;
+            if (!cb(&info, ctx)) return false;
+        }
+    }
+    return true;
+}
+
+size_t memory_pool_walk(memory_pool_t* pool, mp_walk_callback_t callback, void* ctx) {
+    if (!pool || !callback) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return 0;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    size_t count = 0;
+    bool corrupt = false;
+    if (master->thread_safe) {
+        pool_lock(master);
+    }
+    walk_cached_set_t cached;
+    if (!walk_cached_collect(master, &cached)) {
+        if (master->thread_safe) {
+            pool_unlock(master);
+        }
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return 0;
     }
-
-    // 如果新大小小于等于当前大小，直接返回
-    size_t usable_old_size = old_size - sizeof(memory_block_t);
-    if (new_size <= usable_old_size) {
-        return ptr;
+    bool more = walk_chain(master, &cached, callback, ctx, &count, &corrupt);
+    if (master->thread_safe) {
+        pool_unlock(master);
     }
-
-    // 分配新内存
-    void* new_ptr = memory_pool_alloc(pool, new_size);
-    if (!new_ptr) {
-        return NULL;
+    free(cached.blocks);
+    // arena 不建固定大小类，没有缓存块
+    walk_cached_set_t none = { NULL, 0 };
+    for (int n = 0; more && n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(master, n);
+        if (!arena) continue;
+        if (arena->thread_safe) pool_lock(arena);
+        more = walk_chain(arena, &none, callback, ctx, &count, &corrupt);
+        if (arena->thread_safe) pool_unlock(arena);
     }
+    set_error(corrupt ? POOL_ERROR_CORRUPTION : POOL_OK);
+    return count;
+}
 
-    // 复制数据
-    memcpy(new_ptr, ptr, usable_old_size);
-    
-    // 释放旧内存
-    // 直接释放旧块（若为 size-class 将自动回到其私有空闲链）
-    memory_pool_free(pool, ptr);
-    
-    return new_ptr;
+// ---- 运行统计 ----
+// 空闲红黑树深度（树高受 2*log2(n+1) 约束，递归深度有界）
+static size_t rb_depth(uintptr_t lb, const memory_block_t* n) {
+    if (!n) return 0;
+    size_t l = rb_depth(lb, RB_LEFT(n));
+    size_t r = rb_depth(lb, RB_RIGHT(n));
+    return 1 + (l > r ? l : r);
 }
 
-// 重置内存池
-void memory_pool_reset(memory_pool_t* pool) {
-    if (!pool) return;
+// 累加一个 arena（master 及其子池）的计数到 st。调用方持该 arena 的锁
+static void chain_stats(memory_pool_t* master, mp_pool_stats_t* st) {
+    const mp_usage_profile_t* pr = &master->profile;
+    st->allocations += pr->alloc_requests;
+    st->frees += master->heap_frees;
+    st->bytes_in_use += pr->current_used;
+    st->peak_bytes += pr->peak_used;
+    st->merge_fallbacks += master->merge_sweeps;
+    st->child_pools_created += pr->child_pools_created;
+    st->class_fallbacks += master->class_fallbacks;
+    const uintptr_t lb = link_base(master);
+    size_t depth = rb_depth(lb, RB_ROOT(master));
+    if (depth > st->rb_tree_depth) st->rb_tree_depth = depth;
+    for (memory_pool_t* p = master; p; p = p->next) {
+        st->chain_length++;
+        for (memory_block_t* b = blk_at(link_base(p), p->free_list); b; b = blk_at(link_base(p), b->u.next)) st->free_blocks++;
+    }
+}
 
+bool memory_pool_get_stats_sized(memory_pool_t* pool, mp_pool_stats_t* stats, size_t size) {
+    if (!pool || !stats) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    if (size < offsetof(mp_pool_stats_t, allocations)) {
+        set_error(POOL_ERROR_INVALID_SIZE);
+        return false;
+    }
+    mp_pool_stats_t st;
+    memset(&st, 0, sizeof(st));
+    memory_pool_t* master = pool->master ? pool->master : pool;
     if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
+        pool_lock(pool);
     }
-
-    // 遍历整条链路重置
-    memory_pool_t* p = pool;
-    while (p) {
-        p->used_size = 0;
-        memory_block_t* initial_block = (memory_block_t*)p->pool_start;
-        initial_block->u.next = NULL;
-        initial_block->size = p->pool_size;
-    initial_block->magic = MP_MAKE_BLOCK_MAGIC(p, initial_block);
-        initial_block->flags = MB_FLAG_FREE;
-        p->free_list = initial_block;
-        if (p == pool->master) {
-            // 重建 master 根（先清空 rb_root）
-            p->rb_root = NULL;
-            initial_block->rb_left = initial_block->rb_right = initial_block->rb_parent = NULL; RB_SET_RED(initial_block);
-            rb_insert(p, initial_block); // becomes root
-        } else {
-            // 将子池初始块插入 master 的树
-            initial_block->rb_left = initial_block->rb_right = initial_block->rb_parent = NULL; RB_SET_RED(initial_block);
-            rb_insert(pool->master, initial_block);
-        }
-        MP_LOG("reset pool=%p size=%zu", (void*)p, p->pool_size);
-        for (int i = 0; i < p->num_classes; i++) {
-            p->size_classes[i].free_blocks = NULL;
-            p->size_classes[i].used_count = 0;
-        }
-        p = p->next;
+    chain_stats(master, &st);
+    st.num_classes = master->num_classes;
+    for (int i = 0; i < master->num_classes; i++) {
+        const size_class_pool_t* cls = &master->size_classes[i];
+        st.classes[i].size = master->class_sizes[i];
+        st.classes[i].hits = cls->hits;
+        st.classes[i].misses = cls->misses;
+        st.classes[i].used_count = cls->used_count;
+        st.classes[i].block_count = cls->block_count;
     }
-
     if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+        pool_unlock(pool);
     }
+    for (int n = 0; n < MP_SIDE_ARENAS; n++) {
+        memory_pool_t* arena = side_arena(master, n);
+        if (!arena) continue;
+        if (arena->thread_safe) pool_lock(arena);
+        chain_stats(arena, &st);
+        if (arena->thread_safe) pool_unlock(arena);
+        st.arenas++;
+    }
+    // 按调用方编译时的结构大小写出：旧调用方得到其版本的前缀，新字段只追加在末尾
+    st.version = MP_STATS_VERSION;
+    st.struct_size = (uint32_t)(size < sizeof(st) ? size : sizeof(st));
+    memcpy(stats, &st, st.struct_size);
+    set_error(POOL_OK);
+    return true;
 }
 
-// 检查指针是否属于内存池
-bool memory_pool_contains(memory_pool_t* pool, void* ptr) {
-    if (!pool || !ptr) return false;
-    memory_pool_t* p = pool;
-    while (p) {
-        if (pool_contains(p, ptr)) return true;
-        p = p->next;
+// ---- 延迟直方图接口 ----
+bool memory_pool_latency_enable(memory_pool_t* pool, bool enable) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+#if MEMPOOL_LATENCY
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (master->seg_flags & MP_SEG_SHARED) { // 直方图在本进程堆上，指针无法跨进程共享
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return false;
+    }
+    if (master->thread_safe) pool_lock(master);
+    struct mp_latency* lat = master->latency;
+    if (!lat && enable) {
+        // 直方图只分配不释放（直到 destroy）：关闭后锁外仍在记录的线程可安全写完
+        lat = calloc(1, sizeof(*lat));
+        if (lat) __atomic_store_n(&master->latency, lat, __ATOMIC_RELEASE);
+    }
+    if (lat) __atomic_store_n(&lat->enabled, enable, __ATOMIC_RELAXED);
+    if (master->thread_safe) pool_unlock(master);
+    if (enable && !lat) {
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return false;
     }
+    set_error(POOL_OK);
+    return true;
+#else
+    (void)enable;
+    set_error(POOL_ERROR_INVALID_POINTER); // 编译时已移除（MEMPOOL_LATENCY=0）
     return false;
+#endif
 }
 
-// 获取块大小
-size_t memory_pool_get_block_size(memory_pool_t* pool, void* ptr) {
-    if (!pool || !ptr || !memory_pool_contains(pool, ptr)) {
-        return 0;
+bool memory_pool_latency_snapshot(memory_pool_t* pool, mp_latency_histogram_t out[MP_OP_COUNT], bool reset) {
+    if (!pool || !out) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
     }
-
-    memory_block_t* block = (memory_block_t*)((char*)ptr - sizeof(memory_block_t));
-    
-    if (!validate_block(block)) {
-        return 0;
+    memset(out, 0, sizeof(mp_latency_histogram_t) * MP_OP_COUNT);
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    struct mp_latency* lat = __atomic_load_n(&master->latency, __ATOMIC_ACQUIRE);
+    if (lat) {
+        // 逐字段读取（reset 时原子交换为 0）：并发记录可能落在快照与清零之间，但不会丢失或重复
+        for (int op = 0; op < MP_OP_COUNT; op++) {
+            mp_latency_histogram_t* h = &lat->ops[op];
+            uint64_t* src = (uint64_t*)h;
+            uint64_t* dst = (uint64_t*)&out[op];
+            for (size_t i = 0; i < sizeof(*h) / sizeof(uint64_t); i++) {
+                dst[i] = reset ? __atomic_exchange_n(&src[i], 0, __ATOMIC_RELAXED)
+                               : __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+            }
+        }
     }
+    set_error(POOL_OK);
+    return true;
+}
 
-    return block->size;
+// 桶 i 覆盖的最大值（纳秒）
+static uint64_t latency_bucket_high(int i) {
+    if (i < 8) return (uint64_t)i;
+    int msb = i / 8 + 2;
+    uint64_t lo = (uint64_t)(8 + i % 8) << (msb - 3);
+    return lo + ((uint64_t)1 << (msb - 3)) - 1;
 }
 
-// 内存预热
-void memory_pool_warmup(memory_pool_t* pool) {
-    if (!pool) return;
-    memory_pool_t* p = pool;
-    while (p) {
-        // 之前版本在每个页面的起始地址写入 0，用于预触发物理页分配。
-        // 但第一个页面的起始地址正是第一个空闲大块的块头（magic 位于偏移0），
-        // 会把动态魔数首字节清零导致 memory_pool_validate 失败。
-        // 修复：逐页触摸时，第一页避开块头（跳到 sizeof(memory_block_t) 偏移），
-        // 其余页仍写入页首；这样仍然保证每页至少被一次写访问而不破坏头部。
-        volatile char* base = (char*)p->pool_start;
-        for (size_t page_off = 0; page_off < p->pool_size; page_off += PAGE_SIZE) {
-            size_t touch_off = page_off;
-            if (page_off == 0) {
-                size_t skip = sizeof(memory_block_t);
-                if (skip >= p->pool_size) break; // 极小池保护
-                touch_off = skip; // 跳过首块头部
-            }
-            base[touch_off] = 0;
+uint64_t memory_pool_latency_percentile(const mp_latency_histogram_t* h, double q) {
+    if (!h || !h->count) return 0;
+    if (q <= 0) return h->min_ns;
+    if (q >= 1) return h->max_ns;
+    uint64_t rank = (uint64_t)(q * (double)h->count);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < MP_LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t v = latency_bucket_high(i);
+            return v < h->max_ns ? v : h->max_ns;
         }
-        p = p->next;
     }
+    return h->max_ns;
 }
 
-// 内存碎片整理
-void memory_pool_defragment(memory_pool_t* pool) {
-    if (!pool) return;
-    if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
+bool memory_pool_trace_start(memory_pool_t* pool, const char* path) {
+    if (!pool || !path) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
     }
-    memory_pool_t* p = pool;
-    while (p) {
-    merge_free_blocks(p);
-    MP_LOG("defragment pool=%p", (void*)p);
-        p = p->next;
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (master->seg_flags & MP_SEG_SHARED) { // 对象编号表在本进程堆上，其他进程的调用无法记录
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return false;
     }
-    if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+    if (master->thread_safe) pool_lock(master);
+    struct mp_trace* tr = master->trace;
+    if (!tr) {
+        // 记录器只分配不释放（直到 destroy）：停止后锁外检查 enabled 的线程仍可安全读取
+        tr = calloc(1, sizeof(*tr));
+        if (tr && pthread_mutex_init(&tr->lock, NULL) != 0) {
+            free(tr);
+            tr = NULL;
+        }
+        if (tr) __atomic_store_n(&master->trace, tr, __ATOMIC_RELEASE);
+    }
+    if (master->thread_safe) pool_unlock(master);
+    if (!tr) {
+        set_error(POOL_ERROR_OUT_OF_MEMORY);
+        return false;
     }
-}
 
-// 合并空闲块
-static void merge_free_blocks(memory_pool_t* pool) {
-    if (!pool->free_list) return;
-    memory_pool_t* master = pool->master ? pool->master : pool;
-    memory_block_t* current = pool->free_list;
-    while (current) {
-        bool did_merge = false;
-        while (current->u.next && (char*)current + current->size == (char*)current->u.next) {
-            memory_block_t* next_block = current->u.next;
-            rb_remove(master, next_block);
-            current->u.next = next_block->u.next;
-            if (!did_merge) { rb_remove(master, current); did_merge = true; }
-            current->size += next_block->size;
+    pthread_mutex_lock(&tr->lock);
+    pool_error_t err = POOL_ERROR_INVALID_POINTER; // 已在记录
+    if (!tr->out) {
+        mp_trace_slot_t* slots = calloc(MP_TRACE_MIN_SLOTS, sizeof(*slots));
+        FILE* out = slots ? fopen(path, "wb") : NULL;
+        err = slots ? POOL_ERROR_IO : POOL_ERROR_OUT_OF_MEMORY;
+        if (out) {
+            mp_trace_header_t h;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, MP_TRACE_MAGIC, sizeof(MP_TRACE_MAGIC));
+            h.version = MP_TRACE_VERSION;
+            h.record_size = sizeof(mp_trace_record_t);
+            h.pool_size = master->config.pool_size;
+            h.flags = master->thread_safe ? MP_TRACE_F_THREAD_SAFE : 0;
+            if (fwrite(&h, sizeof(h), 1, out) != 1) {
+                fclose(out);
+                out = NULL;
+            }
         }
-        if (did_merge) {
-            rb_insert(master, current);
-            set_next_prev_free(pool, current);
+        if (out) {
+            free(tr->slots);
+            tr->slots = slots;
+            tr->cap = MP_TRACE_MIN_SLOTS;
+            tr->count = 0;
+            tr->out = out;
+            tr->failed = false;
+            tr->next_id = 0;
+            tr->session++;
+            tr->t0 = now_ns();
+            __atomic_store_n(&tr->enabled, true, __ATOMIC_RELAXED);
+            err = POOL_OK;
+        } else {
+            free(slots);
         }
-        current = current->u.next;
     }
+    pthread_mutex_unlock(&tr->lock);
+    set_error(err);
+    return err == POOL_OK;
 }
 
-// 验证内存池完整性
-bool memory_pool_validate(memory_pool_t* pool) {
-    if (!pool) return false;
+bool memory_pool_trace_stop(memory_pool_t* pool) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    struct mp_trace* tr = __atomic_load_n(&master->trace, __ATOMIC_ACQUIRE);
+    bool ok = true;
+    if (tr) {
+        pthread_mutex_lock(&tr->lock); // 等待正在记录的调用写完
+        __atomic_store_n(&tr->enabled, false, __ATOMIC_RELAXED);
+        ok = !tr->failed;
+        if (tr->out && fclose(tr->out) != 0) ok = false;
+        tr->out = NULL;
+        free(tr->slots);
+        tr->slots = NULL;
+        tr->cap = tr->count = 0;
+        pthread_mutex_unlock(&tr->lock);
+    }
+    set_error(ok ? POOL_OK : POOL_ERROR_IO);
+    return ok;
+}
 
+// 设置内存压力回调
+bool memory_pool_set_pressure_callback(memory_pool_t* pool, mp_pressure_callback_t cb, void* user_data) {
+    if (!pool) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (master->seg_flags & MP_SEG_SHARED) {
+        set_error(POOL_ERROR_INVALID_POINTER);
+        return false;
+    }
     if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
+        pool_lock(pool);
     }
-
-    memory_pool_t* p = pool;
-    while (p) {
-        bool valid = true;
-        size_t total_free = 0;
-        memory_block_t* current = p->free_list;
-        while (current) {
-            // 需推断所属 pool 获取种子： current 一定位于 p 内
-            if (!validate_block(current) || !MP_CHECK_BLOCK_MAGIC(p, current)) { valid = false; break; }
-            total_free += current->size;
-            current = current->u.next;
-        }
-    if (!(valid && (p->used_size + total_free == p->pool_size))) {
-#if MP_DEBUG
-        size_t dbg_total=0; size_t count=0; memory_block_t* c2=p->free_list;
-        while(c2){ dbg_total+=c2->size; count++; c2=c2->u.next; }
-        MP_LOG("validate fail pool=%p used=%zu free_sum=%zu expect=%zu blocks=%zu", (void*)p, p->used_size, dbg_total, p->pool_size, count);
-#endif
-            if (pool->thread_safe) pthread_mutex_unlock(&pool->mutex);
-            return false;
-        }
-        p = p->next;
+    master->pressure_cb = cb;
+    master->pressure_user = user_data;
+    if (pool->thread_safe) {
+        pool_unlock(pool);
     }
+    set_error(POOL_OK);
+    return true;
+}
 
+// 使用画像快照（段数与映射总量读取时汇总）
+bool memory_pool_get_usage_profile(memory_pool_t* pool, mp_usage_profile_t* profile) {
+    if (!pool || !profile) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    *profile = master->profile;
+    profile->mapped_bytes = 0;
+    profile->segments = 0;
+    for (memory_pool_t* p = master; p; p = p->next) {
+        profile->mapped_bytes += p->pool_size;
+        profile->segments++;
+    }
     if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+        pool_unlock(pool);
+    }
+    set_error(POOL_OK);
+    return true;
+}
+
+// 建议的 pool_size：峰值用量加 25% 余量，按段粒度取整；尚无分配时沿用当前配置
+static size_t suggested_pool_size(memory_pool_t* master, const mp_usage_profile_t* pr) {
+    if (!pr->peak_used) return master->config.pool_size;
+    return align_size(pr->peak_used + pr->peak_used / 4, segment_granularity(&master->config));
+}
+
+bool memory_pool_suggest_config(memory_pool_t* pool, pool_config_t* out) {
+    mp_usage_profile_t pr;
+    if (!out || !memory_pool_get_usage_profile(pool, &pr)) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
     }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    *out = master->config;
+    out->pool_size = suggested_pool_size(master, &pr);
+    if (out->reserve_size && out->reserve_size < pr.peak_mapped) out->reserve_size = pr.peak_mapped;
+    out->size_class_sizes = NULL;
+    out->num_size_classes = 0;
+    set_error(POOL_OK);
     return true;
 }
 
+// JSON 导出；建议的固定大小类取占请求数 >= 10% 且上界不超过 4 KiB 的直方图桶（取桶上界）
+bool memory_pool_export_profile(memory_pool_t* pool, FILE* out) {
+    mp_usage_profile_t pr;
+    if (!out || !memory_pool_get_usage_profile(pool, &pr)) {
+        set_error(POOL_ERROR_NULL_POINTER);
+        return false;
+    }
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    fprintf(out, "{\n");
+    fprintf(out, "  \"current_used\": %zu,\n  \"peak_used\": %zu,\n", pr.current_used, pr.peak_used);
+    fprintf(out, "  \"mapped_bytes\": %zu,\n  \"peak_mapped\": %zu,\n  \"segments\": %zu,\n",
+            pr.mapped_bytes, pr.peak_mapped, pr.segments);
+    fprintf(out, "  \"growth_events\": %zu,\n  \"in_place_growths\": %zu,\n  \"child_pools_created\": %zu,\n",
+            pr.growth_events, pr.in_place_growths, pr.child_pools_created);
+    fprintf(out, "  \"pressure_events\": %zu,\n  \"hard_limit_rejections\": %zu,\n",
+            pr.pressure_events, pr.hard_limit_rejections);
+    fprintf(out, "  \"alloc_requests\": %zu,\n  \"size_histogram\": [", pr.alloc_requests);
+    bool first = true;
+    for (int b = 0; b < MP_SIZE_HIST_BUCKETS; b++) {
+        if (!pr.size_hist[b]) continue;
+        fprintf(out, "%s\n    {\"min\": %zu, \"count\": %zu}", first ? "" : ",", (size_t)1 << b, pr.size_hist[b]);
+        first = false;
+    }
+    fprintf(out, "%s],\n", first ? "" : "\n  ");
+    fprintf(out, "  \"suggested_config\": {\n    \"pool_size\": %zu,\n    \"size_classes\": [",
+            suggested_pool_size(master, &pr));
+    first = true;
+    int classes = 0;
+    for (int b = 0; b < 12 && classes < MAX_SIZE_CLASSES; b++) {
+        if (!pr.size_hist[b] || pr.size_hist[b] * 10 < pr.alloc_requests) continue;
+        fprintf(out, "%s%zu", first ? "" : ", ", (size_t)1 << (b + 1));
+        first = false;
+        classes++;
+    }
+    fprintf(out, "]\n  }\n}\n");
+    set_error(ferror(out) ? POOL_ERROR_IO : POOL_OK);
+    return !ferror(out);
+}
+
 // 添加固定大小类别
 int memory_pool_add_size_class(memory_pool_t* pool, size_t size, size_t count) {
     if (!pool || size == 0 || count == 0) {
@@ -977,11 +4797,51 @@ int memory_pool_add_size_class(memory_pool_t* pool, size_t size, size_t count) {
         return -1;
     }
 
+    // 紧凑布局：一次切出容纳 count 个对象的 slab
+    if (pool->config.packed_size_classes) {
+        size_t obj_size = align_size(size, pool->alignment);
+        mp_slab_t* slab = slab_create(pool, pool->num_classes, obj_size, count);
+        if (!slab) {
+            set_error(POOL_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        if (pool->thread_safe) {
+            pool_lock(pool);
+        }
+        int idx = pool->num_classes;
+        if (idx >= MAX_SIZE_CLASSES) {
+            ((memory_block_t*)slab - 1)->flags &= ~MB_FLAG_SLAB;
+            if (pool->thread_safe) {
+                pool_unlock(pool);
+            }
+            pool_free(pool, slab);
+            set_error(POOL_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        size_class_pool_t* cls = &pool->size_classes[idx];
+        cls->free_blocks = 0;
+        cls->slabs = NULL;
+        cls->block_size = obj_size;
+        cls->block_count = 0;
+        cls->used_count = 0;
+        cls->hits = 0;
+        cls->misses = 0;
+        slab->class_index = (uint32_t)idx;
+        slab_attach(cls, slab);
+        pool->class_sizes[idx] = size;
+        pool->num_classes++;
+        if (pool->thread_safe) {
+            pool_unlock(pool);
+        }
+        set_error(POOL_OK);
+        return idx;
+    }
+
     // 对齐大小
     size_t aligned_size = align_size(size + sizeof(memory_block_t), pool->alignment);
 
     if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
+        pool_lock(pool);
     }
 
     int class_index = pool->num_classes;
@@ -990,43 +4850,46 @@ int memory_pool_add_size_class(memory_pool_t* pool, size_t size, size_t count) {
     class_pool->block_size = aligned_size;
     class_pool->block_count = count;
     class_pool->used_count = 0;
-    class_pool->free_blocks = NULL;
+    class_pool->hits = 0;
+    class_pool->misses = 0;
+    class_pool->free_blocks = 0;
+    class_pool->slabs = NULL;
 
     // 预分配固定大小的块（暂时释放锁以避免死锁）
     if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+        pool_unlock(pool);
     }
 
     for (size_t i = 0; i < count; i++) {
-        void* ptr = memory_pool_alloc(pool, size);
+        void* ptr = pool_alloc(pool, size, NULL);
         if (!ptr) {
             // 分配失败，清理已分配的块
             if (pool->thread_safe) {
-                pthread_mutex_lock(&pool->mutex);
+                pool_lock(pool);
             }
             
-            memory_block_t* current = class_pool->free_blocks;
+            memory_block_t* current = blk_at(link_base(pool), class_pool->free_blocks);
             while (current) {
-                memory_block_t* next = current->u.next;
+                memory_block_t* next = blk_at(link_base(pool), current->u.next);
                 if (pool->thread_safe) {
-                    pthread_mutex_unlock(&pool->mutex);
+                    pool_unlock(pool);
                 }
                 memory_pool_free(pool, (char*)current + sizeof(memory_block_t));
                 if (pool->thread_safe) {
-                    pthread_mutex_lock(&pool->mutex);
+                    pool_lock(pool);
                 }
                 current = next;
             }
             
             if (pool->thread_safe) {
-                pthread_mutex_unlock(&pool->mutex);
+                pool_unlock(pool);
             }
             return -1;
         }
 
         // 将分配的块加入固定大小池的空闲链表
         if (pool->thread_safe) {
-            pthread_mutex_lock(&pool->mutex);
+            pool_lock(pool);
         }
         
     memory_block_t* block = (memory_block_t*)((char*)ptr - sizeof(memory_block_t));
@@ -1034,30 +4897,116 @@ int memory_pool_add_size_class(memory_pool_t* pool, size_t size, size_t count) {
     block->flags &= ~MB_FLAG_FREE; // 确保未被视为通用空闲
     block->flags |= MB_FLAG_SIZECLASS;
     block->u.next = class_pool->free_blocks; // 复用 u.next 作为 size-class 单链表
-    class_pool->free_blocks = block;
+    class_pool->free_blocks = blk_link(link_base(pool), block);
         
         if (pool->thread_safe) {
-            pthread_mutex_unlock(&pool->mutex);
+            pool_unlock(pool);
         }
     }
 
     if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
+        pool_lock(pool);
     }
 
     pool->class_sizes[class_index] = size;
     pool->num_classes++;
 
     if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+        pool_unlock(pool);
     }
 
     set_error(POOL_OK);
     return class_index;
 }
 
-// 从固定大小池分配
+// 自适应补充数量：按该类当前已用数量的一半批量预留，上限 MP_CLASS_REFILL_MAX
+#define MP_CLASS_REFILL_MAX 4096
+static inline size_t class_refill_count(const size_class_pool_t* cls) {
+    size_t n = cls->used_count / 2;
+    return n > MP_CLASS_REFILL_MAX ? MP_CLASS_REFILL_MAX : n;
+}
+
+// 为非紧凑类批量预留 n 个块挂入其空闲链（调用方不持锁；分配失败即停止）
+static void class_prefill(memory_pool_t* pool, int class_index, size_t n) {
+    size_t user_size = pool->class_sizes[class_index];
+    for (size_t k = 0; k < n; k++) {
+        void* ptr = pool_alloc(pool, user_size, NULL);
+        if (!ptr) break;
+        if (pool->thread_safe) {
+            pool_lock(pool);
+        }
+        size_class_pool_t* cls = &pool->size_classes[class_index];
+        memory_block_t* block = (memory_block_t*)((char*)ptr - sizeof(memory_block_t));
+        block->flags &= ~MB_FLAG_FREE;
+        block->flags |= MB_FLAG_SIZECLASS;
+        block->u.next = cls->free_blocks;
+        cls->free_blocks = blk_link(link_base(pool), block);
+        cls->block_count++;
+        if (pool->thread_safe) {
+            pool_unlock(pool);
+        }
+    }
+}
+
+// 紧凑布局的固定大小分配：当前 slab 全满时切出新的 slab（默认占满 MP_SLAB_BYTES 跨度）
+static void* packed_alloc_fixed(memory_pool_t* pool, size_t size) {
+    if (pool->thread_safe) {
+        pool_lock(pool);
+    }
+    for (int i = 0; i < pool->num_classes; i++) {
+        if (size > pool->class_sizes[i]) continue;
+        size_class_pool_t* cls = &pool->size_classes[i];
+        void* obj = slab_alloc(cls);
+        if (obj) cls->hits++;
+        else cls->misses++;
+        if (!obj) {
+            size_t obj_size = cls->block_size;
+            size_t capacity = slab_capacity_for_span(pool, obj_size, MP_SLAB_BYTES);
+            if (capacity == 0) capacity = 1;
+            if (pool->config.adaptive_sizing) {
+                size_t want = class_refill_count(cls);
+                if (want > capacity) capacity = want;
+            }
+            if (pool->thread_safe) {
+                pool_unlock(pool);
+            }
+            mp_slab_t* slab = slab_create(pool, i, obj_size, capacity);
+            if (!slab) {
+                set_error(POOL_ERROR_OUT_OF_MEMORY);
+                return NULL;
+            }
+            if (pool->thread_safe) {
+                pool_lock(pool);
+            }
+            slab_attach(cls, slab);
+            obj = slab_alloc(cls);
+        }
+        if (pool->thread_safe) {
+            pool_unlock(pool);
+        }
+        set_error(POOL_OK);
+        return obj;
+    }
+    pool->class_fallbacks++;
+    if (pool->thread_safe) {
+        pool_unlock(pool);
+    }
+    // 未找到匹配的固定大小类别，使用普通分配
+    return pool_alloc(pool, size, NULL);
+}
+
 void* memory_pool_alloc_fixed(memory_pool_t* pool, size_t size) {
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_ALLOC_FIXED, size);
+    uint64_t t0 = latency_begin(pool);
+    void* ptr = pool_alloc_fixed(pool, size);
+    latency_end(pool, MP_OP_ALLOC_FIXED, t0);
+    if (tr) trace_end(tr, pool, &rec, NULL, ptr);
+    return ptr;
+}
+
+// 从固定大小池分配
+static void* pool_alloc_fixed(memory_pool_t* pool, size_t size) {
     if (!pool || size == 0) {
         set_error(POOL_ERROR_INVALID_SIZE);
         return NULL;
@@ -1068,8 +5017,17 @@ void* memory_pool_alloc_fixed(memory_pool_t* pool, size_t size) {
     MP_ASSERT(pool->num_classes >= 0 && pool->num_classes <= MAX_SIZE_CLASSES, "invalid num_classes");
 #endif
 
+    if (pool->config.packed_size_classes) {
+        return packed_alloc_fixed(pool, size);
+    }
+
     if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
+        pool_lock(pool);
+    }
+    if (pool->poisoned) {
+        if (pool->thread_safe) pool_unlock(pool);
+        set_error(POOL_ERROR_CORRUPTION);
+        return NULL;
     }
 
     // 查找合适的大小类别
@@ -1078,14 +5036,15 @@ void* memory_pool_alloc_fixed(memory_pool_t* pool, size_t size) {
             size_class_pool_t* class_pool = &pool->size_classes[i];
             
             if (class_pool->free_blocks) {
-                memory_block_t* block = class_pool->free_blocks;
+                memory_block_t* block = blk_at(link_base(pool), class_pool->free_blocks);
                 class_pool->free_blocks = block->u.next;
                 block->flags &= ~MB_FLAG_FREE; // allocated to user (size-class)
                 block->flags |= MB_FLAG_SIZECLASS; // keep classification
                 class_pool->used_count++;
+                class_pool->hits++;
                 
                 if (pool->thread_safe) {
-                    pthread_mutex_unlock(&pool->mutex);
+                    pool_unlock(pool);
                 }
                 
                 set_error(POOL_OK);
@@ -1095,76 +5054,107 @@ void* memory_pool_alloc_fixed(memory_pool_t* pool, size_t size) {
             // 释放锁后按“该类的用户大小”进行一次普通分配，内部会按需链式扩展；
             // 分配出的块大小与该类 block_size 一致，随后计入 used_count。
             size_t class_user_size = pool->class_sizes[i];
+            class_pool->misses++;
             if (pool->thread_safe) {
-                pthread_mutex_unlock(&pool->mutex);
+                pool_unlock(pool);
             }
-            void* ptr = memory_pool_alloc(pool, class_user_size);
+            void* ptr = pool_alloc(pool, class_user_size, NULL);
             if (!ptr) {
                 // memory_pool_alloc 已设置错误码
                 return NULL;
             }
             if (pool->thread_safe) {
-                pthread_mutex_lock(&pool->mutex);
+                pool_lock(pool);
             }
             // 再次获取 class_pool 指针（池可能因链式扩展发生变化，但本池结构仍有效）
             class_pool = &pool->size_classes[i];
             class_pool->used_count++;
 #if MP_DEBUG
-            // 确认得到的块大小与该类内部块大小一致
+            // 确认得到的块不小于该类内部块大小（分割剩余不足 MIN_BLOCK_SIZE 时整体并入，块会略大）
             size_t blk_sz = memory_pool_get_block_size(pool, ptr);
-            MP_ASSERT(blk_sz == class_pool->block_size, "alloc_fixed: block size mismatch");
+            MP_ASSERT(blk_sz >= class_pool->block_size, "alloc_fixed: block size mismatch");
 #endif
+            size_t batch = pool->config.adaptive_sizing ? class_refill_count(class_pool) : 0;
             if (pool->thread_safe) {
-                pthread_mutex_unlock(&pool->mutex);
+                pool_unlock(pool);
             }
+            if (batch) class_prefill(pool, i, batch);
             set_error(POOL_OK);
             return ptr;
         }
     }
 
+    pool->class_fallbacks++;
     if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+        pool_unlock(pool);
     }
 
     // 未找到匹配的固定大小类别，使用普通分配（可能链式扩展）一般不会到这里。
-    return memory_pool_alloc(pool, size);
+    return pool_alloc(pool, size, NULL);
 }
 
 // 释放到固定大小池
 void memory_pool_free_fixed(memory_pool_t* pool, void* ptr) {
+    mp_trace_record_t rec;
+    struct mp_trace* tr = trace_begin(pool, &rec, MP_TRACE_FREE_FIXED, 0);
+    pool_free_fixed(pool, ptr);
+    if (tr) trace_end(tr, pool, &rec, ptr, NULL);
+}
+
+static void pool_free_fixed(memory_pool_t* pool, void* ptr) {
     if (!pool || !ptr) {
         set_error(POOL_ERROR_NULL_POINTER);
         return;
     }
 
+    if (pool->config.packed_size_classes) {
+        // 紧凑对象与普通块都交给 memory_pool_free：前者按侧表释放，后者走通用路径
+        memory_pool_free(pool, ptr);
+        return;
+    }
+
     memory_block_t* block = (memory_block_t*)((char*)ptr - sizeof(memory_block_t));
     
-    if (!validate_block(block) || !MP_CHECK_BLOCK_MAGIC(pool, block)) {
+    if (!validate_block(block)) {
         set_error(POOL_ERROR_CORRUPTION);
         return;
     }
 
-    if (pool->thread_safe) {
-        pthread_mutex_lock(&pool->mutex);
+    // 固定类归 master 所有，但补充块可能切自任一子池：持 master 锁找到所在段后按该段校验魔数
+    memory_pool_t* master = pool->master ? pool->master : pool;
+    if (master->thread_safe) {
+        pool_lock(master);
+    }
+    if (master->poisoned) {
+        if (master->thread_safe) pool_unlock(master);
+        set_error(POOL_ERROR_CORRUPTION);
+        return;
+    }
+    memory_pool_t* owner = master;
+    while (owner && !pool_contains(owner, ptr)) owner = owner->next;
+    if (!owner || !MP_CHECK_BLOCK_MAGIC(owner, block)) {
+        if (master->thread_safe) pool_unlock(master);
+        set_error(POOL_ERROR_CORRUPTION);
+        return;
     }
 
     // 检查是否属于某个固定大小类别
 #if MP_DEBUG
-    MP_ASSERT(pool->num_classes >= 0 && pool->num_classes <= MAX_SIZE_CLASSES, "invalid num_classes");
+    MP_ASSERT(master->num_classes >= 0 && master->num_classes <= MAX_SIZE_CLASSES, "invalid num_classes");
 #endif
-    for (int i = 0; i < pool->num_classes; i++) {
-        if (block->size == pool->size_classes[i].block_size) {
-            size_class_pool_t* class_pool = &pool->size_classes[i];
+    for (int i = 0; i < master->num_classes; i++) {
+        if (block->size == master->size_classes[i].block_size) {
+            size_class_pool_t* class_pool = &master->size_classes[i];
             
             // 将块返回到固定大小池
             block->flags &= ~MB_FLAG_FREE; // returning to private free list
             block->flags |= MB_FLAG_SIZECLASS;
             block->u.next = class_pool->free_blocks;
-            class_pool->free_blocks = block;
+            class_pool->free_blocks = blk_link(link_base(master), block);
             class_pool->used_count--;
             
-            if (pool->thread_safe) {
-                pthread_mutex_unlock(&pool->mutex);
+            if (master->thread_safe) {
+                pool_unlock(master);
             }
             
             set_error(POOL_OK);
@@ -1172,8 +5162,8 @@ void memory_pool_free_fixed(memory_pool_t* pool, void* ptr) {
         }
     }
 
-    if (pool->thread_safe) {
-        pthread_mutex_unlock(&pool->mutex);
+    if (master->thread_safe) {
+        pool_unlock(master);
     }
 
     // 不属于任何 size-class：清除 SIZECLASS 标记后走普通释放
@@ -1181,5 +5171,5 @@ void memory_pool_free_fixed(memory_pool_t* pool, void* ptr) {
     MP_LOG("free_fixed: block size %zu not matching any class -> general free", (size_t)block->size);
 #endif
     block->flags &= ~MB_FLAG_SIZECLASS;
-    memory_pool_free(pool, ptr);
+    memory_pool_free(master, ptr);
 }